@@ -1066,11 +1066,12 @@ bool GPX2VideoStream::Video::read(void) {
 	video_time = av_div_q(av_make_q(1000 * frame_time_, 1), stream_->frameRate());
 
 	frame = decoder_->retrieveVideo(video_time, buffer);
-	frame->index_ = index;
 
 	if (!frame)
 		return false;
 
+	frame->index_ = index;
+
 	// next frame
 //	frame_time_ += 1;
 
@@ -10,6 +10,7 @@
 
 #include "log_i.h"
 #include "datetime.h"
+#include "blend.h"
 #include "videowidget.h"
 
 
@@ -41,7 +42,8 @@ static unsigned int indices[] = {
  */
 
 GPX2VideoWidget::Buffer::Buffer(void) 
-	: data_(NULL) {
+	: data_(NULL)
+	, bgra_(false) {
 }
 
 
@@ -85,6 +87,16 @@ void GPX2VideoWidget::Buffer::setData(int index, uint8_t *data) {
 }
 
 
+const bool& GPX2VideoWidget::Buffer::isBGRA(void) const {
+	return bgra_;
+}
+
+
+void GPX2VideoWidget::Buffer::setBGRA(bool bgra) {
+	bgra_ = bgra;
+}
+
+
 /**
  * Widget
  */
@@ -363,6 +375,7 @@ printf("WIDGET::DRAW %s - updated: %s\n",
 
 		buffer->setTimestamp(data.timestamp());
 		buffer->setData(index, buffer_[index]);
+		buffer->setBGRA(Blend::isBGRA(overlay->spec()));
 
 		// Update buffer
 		overlay->get_pixels(OIIO::ROI(), 
@@ -672,7 +685,7 @@ printf("WIDGET::LOADING TEXTURE...\n");
 				GL_RGBA, 
 				overlay_width_,
 				overlay_height_,
-				0, GL_RGBA, GL_UNSIGNED_BYTE, NULL); //m_tex_buffer.data());
+				0, buffer->isBGRA() ? GL_BGRA : GL_RGBA, GL_UNSIGNED_BYTE, NULL); //m_tex_buffer.data());
 #endif
 	}
 	else {
@@ -695,7 +708,7 @@ printf("WIDGET::LOADING TEXTURE...\n");
 				0, 0,
 				overlay_width_,
 				overlay_height_,
-				GL_RGBA, GL_UNSIGNED_BYTE, NULL); //m_tex_buffer.data());
+				buffer->isBGRA() ? GL_BGRA : GL_RGBA, GL_UNSIGNED_BYTE, NULL); //m_tex_buffer.data());
 #endif
 	}
 
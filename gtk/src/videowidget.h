@@ -33,11 +33,17 @@ private:
 		uint8_t * data(void);
 		void setData(int index, uint8_t *data);
 
+		// Pixels in B, G, R, A order (cairo drawn widget)
+		const bool& isBGRA(void) const;
+		void setBGRA(bool bgra);
+
 	private:
 		uint64_t timestamp_;
 
 		int index_;
 		uint8_t *data_;
+
+		bool bgra_;
 	};
 
 public:
@@ -77,6 +77,14 @@ void GPXApplication::Task::finish(void) {
 		log_warn("Task '%s' isn't running!", name().c_str());
 }
 
+void GPXApplication::Task::fail(void) {
+//	printf("Task '%s' failure\n", name().c_str());
+
+	app_.setExitStatus(EXIT_FAILURE);
+
+	finish();
+}
+
 void GPXApplication::Task::reset(void) {
 //	printf("Task '%s' reset\n", name().c_str());
 
@@ -91,6 +99,7 @@ GPXApplication::GPXApplication(struct event_base *evbase)
 //	setLogLevel(AV_LOG_INFO);
 	setLogLevel(0);
 	setProgressInfo(false);
+	setExitStatus(EXIT_SUCCESS);
 
 	init();
 }
@@ -136,6 +145,20 @@ void GPXApplication::setProgressInfo(bool enable) {
 }
 
 
+int GPXApplication::exitStatus(void) {
+	log_call();
+
+	return exit_status_;
+}
+
+
+void GPXApplication::setExitStatus(int status) {
+	log_call();
+
+	exit_status_ = status;
+}
+
+
 const std::string GPXApplication::version(void) {
 	log_call();
 
@@ -2,6 +2,8 @@
 #define __GPX2VIDEO__APPLICATION_H__
 
 #include <list>
+#include <string>
+#include <vector>
 #include <algorithm>
 #include <cstdlib>
 #include <cstdint>
@@ -93,6 +95,7 @@ public:
 		void schedule(void);
 		void complete(void);
 		void finish(void);
+		void fail(void);
 		void reset(void);
 
 	private:
@@ -135,11 +138,22 @@ public:
 	bool progressInfo(void);
 	void setProgressInfo(bool enable);
 
+	int exitStatus(void);
+	void setExitStatus(int status);
+
 	static const std::string version(void);
 
 	Settings& settings(void);
 	void setSettings(const Settings &settings);
 
+	const std::vector<std::string>& arguments(void) const {
+		return arguments_;
+	}
+
+	void setArguments(int argc, char *argv[]) {
+		arguments_.assign(argv, argv + argc);
+	}
+
 	Command& command(void) {
 		return command_;
 	}
@@ -208,9 +222,15 @@ private:
 
 	bool progress_info_;
 
+	// Process exit status (a task failure skips next tasks)
+	int exit_status_;
+
 	Command command_;
 	Settings settings_;
 
+	// Command line (to spawn segment renderers)
+	std::vector<std::string> arguments_;
+
 	std::list<Task *> tasks_;
 };
 
@@ -0,0 +1,559 @@
+#include <iostream>
+#include <vector>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_BLEND_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAVE_BLEND_NEON
+#endif
+
+#include "log_i.h"
+#include "blend.h"
+
+
+typedef void (*over8_t)(uint8_t *dst, const uint8_t *src, int n);
+typedef void (*over16_t)(uint16_t *dst, const uint16_t *src, int n);
+
+
+/**
+ * Scalar kernels
+ */
+
+static inline uint32_t div255(uint32_t v) {
+	// Exact rounded v / 255 for v <= 255 * 255
+	v += 128;
+	return (v + (v >> 8)) >> 8;
+}
+
+
+static inline uint32_t div65535(uint32_t v) {
+	// Exact rounded v / 65535 for v <= 65535 * 65535
+	v += 32768;
+	return (v + (v >> 16)) >> 16;
+}
+
+
+static void over8_scalar(uint8_t *dst, const uint8_t *src, int n) {
+	for (int i=0; i<n; i++, dst+=4, src+=4) {
+		uint32_t ia = 255 - src[3];
+
+		if (ia == 255)
+			continue;
+
+		for (int c=0; c<4; c++)
+			dst[c] = MIN(255, src[c] + div255(dst[c] * ia));
+	}
+}
+
+
+static void over16_scalar(uint16_t *dst, const uint16_t *src, int n) {
+	for (int i=0; i<n; i++, dst+=4, src+=4) {
+		uint32_t ia = 65535 - src[3];
+
+		if (ia == 65535)
+			continue;
+
+		for (int c=0; c<4; c++)
+			dst[c] = MIN(65535, src[c] + div65535(dst[c] * ia));
+	}
+}
+
+
+// RGBA source over RGB destination (no alpha)
+template <typename T>
+static void over_rgb(T *dst, const T *src, int n, uint32_t max) {
+	for (int i=0; i<n; i++, dst+=3, src+=4) {
+		uint32_t ia = max - src[3];
+
+		if (ia == max)
+			continue;
+
+		for (int c=0; c<3; c++)
+			dst[c] = MIN(max, src[c] + ((uint64_t) dst[c] * ia + (max >> 1)) / max);
+	}
+}
+
+
+/**
+ * x86 kernels
+ */
+
+#ifdef HAVE_BLEND_X86
+__attribute__((target("sse4.1")))
+static inline __m128i over8_sse4_px(__m128i s, __m128i d) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c255 = _mm_set1_epi16(255);
+	const __m128i c128 = _mm_set1_epi16(128);
+
+	__m128i s_lo = _mm_cvtepu8_epi16(s);
+	__m128i s_hi = _mm_unpackhi_epi8(s, zero);
+	__m128i d_lo = _mm_cvtepu8_epi16(d);
+	__m128i d_hi = _mm_unpackhi_epi8(d, zero);
+
+	// Broadcast alpha on each pixel channels
+	__m128i a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, 0xff), 0xff);
+	__m128i a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, 0xff), 0xff);
+
+	__m128i t_lo = _mm_add_epi16(_mm_mullo_epi16(d_lo, _mm_sub_epi16(c255, a_lo)), c128);
+	__m128i t_hi = _mm_add_epi16(_mm_mullo_epi16(d_hi, _mm_sub_epi16(c255, a_hi)), c128);
+
+	t_lo = _mm_srli_epi16(_mm_add_epi16(t_lo, _mm_srli_epi16(t_lo, 8)), 8);
+	t_hi = _mm_srli_epi16(_mm_add_epi16(t_hi, _mm_srli_epi16(t_hi, 8)), 8);
+
+	return _mm_packus_epi16(_mm_add_epi16(s_lo, t_lo), _mm_add_epi16(s_hi, t_hi));
+}
+
+
+__attribute__((target("sse4.1")))
+static void over8_sse4(uint8_t *dst, const uint8_t *src, int n) {
+	int i = 0;
+
+	// 4 pixels per loop
+	for (; i+4<=n; i+=4, dst+=16, src+=16) {
+		__m128i s = _mm_loadu_si128((const __m128i *) src);
+
+		// Fully transparent
+		if (_mm_testz_si128(s, s))
+			continue;
+
+		__m128i d = _mm_loadu_si128((const __m128i *) dst);
+
+		_mm_storeu_si128((__m128i *) dst, over8_sse4_px(s, d));
+	}
+
+	over8_scalar(dst, src, n - i);
+}
+
+
+__attribute__((target("sse4.1")))
+static void over16_sse4(uint16_t *dst, const uint16_t *src, int n) {
+	int i = 0;
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c65535 = _mm_set1_epi32(65535);
+	const __m128i c32768 = _mm_set1_epi32(32768);
+
+	// 2 pixels per loop
+	for (; i+2<=n; i+=2, dst+=8, src+=8) {
+		__m128i s = _mm_loadu_si128((const __m128i *) src);
+
+		if (_mm_testz_si128(s, s))
+			continue;
+
+		__m128i d = _mm_loadu_si128((const __m128i *) dst);
+
+		__m128i s_lo = _mm_cvtepu16_epi32(s);
+		__m128i s_hi = _mm_unpackhi_epi16(s, zero);
+		__m128i d_lo = _mm_cvtepu16_epi32(d);
+		__m128i d_hi = _mm_unpackhi_epi16(d, zero);
+
+		__m128i a_lo = _mm_shuffle_epi32(s_lo, 0xff);
+		__m128i a_hi = _mm_shuffle_epi32(s_hi, 0xff);
+
+		__m128i t_lo = _mm_add_epi32(_mm_mullo_epi32(d_lo, _mm_sub_epi32(c65535, a_lo)), c32768);
+		__m128i t_hi = _mm_add_epi32(_mm_mullo_epi32(d_hi, _mm_sub_epi32(c65535, a_hi)), c32768);
+
+		t_lo = _mm_srli_epi32(_mm_add_epi32(t_lo, _mm_srli_epi32(t_lo, 16)), 16);
+		t_hi = _mm_srli_epi32(_mm_add_epi32(t_hi, _mm_srli_epi32(t_hi, 16)), 16);
+
+		_mm_storeu_si128((__m128i *) dst, _mm_packus_epi32(_mm_add_epi32(s_lo, t_lo), _mm_add_epi32(s_hi, t_hi)));
+	}
+
+	over16_scalar(dst, src, n - i);
+}
+
+
+__attribute__((target("avx2")))
+static void over8_avx2(uint8_t *dst, const uint8_t *src, int n) {
+	int i = 0;
+
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i c255 = _mm256_set1_epi16(255);
+	const __m256i c128 = _mm256_set1_epi16(128);
+
+	// 8 pixels per loop (unpack & pack work per 128 bits lane)
+	for (; i+8<=n; i+=8, dst+=32, src+=32) {
+		__m256i s = _mm256_loadu_si256((const __m256i *) src);
+
+		if (_mm256_testz_si256(s, s))
+			continue;
+
+		__m256i d = _mm256_loadu_si256((const __m256i *) dst);
+
+		__m256i s_lo = _mm256_unpacklo_epi8(s, zero);
+		__m256i s_hi = _mm256_unpackhi_epi8(s, zero);
+		__m256i d_lo = _mm256_unpacklo_epi8(d, zero);
+		__m256i d_hi = _mm256_unpackhi_epi8(d, zero);
+
+		__m256i a_lo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_lo, 0xff), 0xff);
+		__m256i a_hi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_hi, 0xff), 0xff);
+
+		__m256i t_lo = _mm256_add_epi16(_mm256_mullo_epi16(d_lo, _mm256_sub_epi16(c255, a_lo)), c128);
+		__m256i t_hi = _mm256_add_epi16(_mm256_mullo_epi16(d_hi, _mm256_sub_epi16(c255, a_hi)), c128);
+
+		t_lo = _mm256_srli_epi16(_mm256_add_epi16(t_lo, _mm256_srli_epi16(t_lo, 8)), 8);
+		t_hi = _mm256_srli_epi16(_mm256_add_epi16(t_hi, _mm256_srli_epi16(t_hi, 8)), 8);
+
+		_mm256_storeu_si256((__m256i *) dst, _mm256_packus_epi16(_mm256_add_epi16(s_lo, t_lo), _mm256_add_epi16(s_hi, t_hi)));
+	}
+
+	over8_sse4(dst, src, n - i);
+}
+
+
+__attribute__((target("avx2")))
+static void over16_avx2(uint16_t *dst, const uint16_t *src, int n) {
+	int i = 0;
+
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i c65535 = _mm256_set1_epi32(65535);
+	const __m256i c32768 = _mm256_set1_epi32(32768);
+
+	// 4 pixels per loop
+	for (; i+4<=n; i+=4, dst+=16, src+=16) {
+		__m256i s = _mm256_loadu_si256((const __m256i *) src);
+
+		if (_mm256_testz_si256(s, s))
+			continue;
+
+		__m256i d = _mm256_loadu_si256((const __m256i *) dst);
+
+		__m256i s_lo = _mm256_unpacklo_epi16(s, zero);
+		__m256i s_hi = _mm256_unpackhi_epi16(s, zero);
+		__m256i d_lo = _mm256_unpacklo_epi16(d, zero);
+		__m256i d_hi = _mm256_unpackhi_epi16(d, zero);
+
+		__m256i a_lo = _mm256_shuffle_epi32(s_lo, 0xff);
+		__m256i a_hi = _mm256_shuffle_epi32(s_hi, 0xff);
+
+		__m256i t_lo = _mm256_add_epi32(_mm256_mullo_epi32(d_lo, _mm256_sub_epi32(c65535, a_lo)), c32768);
+		__m256i t_hi = _mm256_add_epi32(_mm256_mullo_epi32(d_hi, _mm256_sub_epi32(c65535, a_hi)), c32768);
+
+		t_lo = _mm256_srli_epi32(_mm256_add_epi32(t_lo, _mm256_srli_epi32(t_lo, 16)), 16);
+		t_hi = _mm256_srli_epi32(_mm256_add_epi32(t_hi, _mm256_srli_epi32(t_hi, 16)), 16);
+
+		_mm256_storeu_si256((__m256i *) dst, _mm256_packus_epi32(_mm256_add_epi32(s_lo, t_lo), _mm256_add_epi32(s_hi, t_hi)));
+	}
+
+	over16_sse4(dst, src, n - i);
+}
+#endif
+
+
+/**
+ * ARM kernels
+ */
+
+#ifdef HAVE_BLEND_NEON
+static inline uint8x8_t over8_neon_ch(uint8x8_t s, uint8x8_t d, uint8x8_t ia) {
+	uint16x8_t t = vmull_u8(d, ia);
+
+	// Rounded t / 255
+	return vqadd_u8(s, vraddhn_u16(t, vrshrq_n_u16(t, 8)));
+}
+
+
+static void over8_neon(uint8_t *dst, const uint8_t *src, int n) {
+	int i = 0;
+
+	// 8 pixels per loop, deinterleaved channels
+	for (; i+8<=n; i+=8, dst+=32, src+=32) {
+		uint8x8x4_t s = vld4_u8(src);
+		uint8x8x4_t d = vld4_u8(dst);
+
+		uint8x8_t ia = vmvn_u8(s.val[3]);
+
+		d.val[0] = over8_neon_ch(s.val[0], d.val[0], ia);
+		d.val[1] = over8_neon_ch(s.val[1], d.val[1], ia);
+		d.val[2] = over8_neon_ch(s.val[2], d.val[2], ia);
+		d.val[3] = over8_neon_ch(s.val[3], d.val[3], ia);
+
+		vst4_u8(dst, d);
+	}
+
+	over8_scalar(dst, src, n - i);
+}
+
+
+static inline uint16x4_t over16_neon_ch(uint16x4_t s, uint16x4_t d, uint16x4_t ia) {
+	uint32x4_t t = vmull_u16(d, ia);
+
+	// Rounded t / 65535
+	return vqadd_u16(s, vraddhn_u32(t, vrshrq_n_u32(t, 16)));
+}
+
+
+static void over16_neon(uint16_t *dst, const uint16_t *src, int n) {
+	int i = 0;
+
+	// 4 pixels per loop
+	for (; i+4<=n; i+=4, dst+=16, src+=16) {
+		uint16x4x4_t s = vld4_u16(src);
+		uint16x4x4_t d = vld4_u16(dst);
+
+		uint16x4_t ia = vmvn_u16(s.val[3]);
+
+		d.val[0] = over16_neon_ch(s.val[0], d.val[0], ia);
+		d.val[1] = over16_neon_ch(s.val[1], d.val[1], ia);
+		d.val[2] = over16_neon_ch(s.val[2], d.val[2], ia);
+		d.val[3] = over16_neon_ch(s.val[3], d.val[3], ia);
+
+		vst4_u16(dst, d);
+	}
+
+	over16_scalar(dst, src, n - i);
+}
+#endif
+
+
+/**
+ * Runtime dispatch
+ */
+
+static Blend::ISA blend_isa = Blend::ISAScalar;
+static over8_t blend_over8 = over8_scalar;
+static over16_t blend_over16 = over16_scalar;
+
+static std::once_flag blend_once;
+
+
+static bool isSupported(Blend::ISA isa) {
+	switch (isa) {
+	case Blend::ISAScalar:
+		return true;
+
+#ifdef HAVE_BLEND_X86
+	case Blend::ISASSE4:
+		return __builtin_cpu_supports("sse4.1");
+
+	case Blend::ISAAVX2:
+		return __builtin_cpu_supports("avx2");
+#endif
+
+#ifdef HAVE_BLEND_NEON
+	case Blend::ISANEON:
+		return true;
+#endif
+
+	default:
+		break;
+	}
+
+	return false;
+}
+
+
+static void select(Blend::ISA isa) {
+	blend_isa = isa;
+
+	switch (isa) {
+#ifdef HAVE_BLEND_X86
+	case Blend::ISASSE4:
+		blend_over8 = over8_sse4;
+		blend_over16 = over16_sse4;
+		break;
+
+	case Blend::ISAAVX2:
+		blend_over8 = over8_avx2;
+		blend_over16 = over16_avx2;
+		break;
+#endif
+
+#ifdef HAVE_BLEND_NEON
+	case Blend::ISANEON:
+		blend_over8 = over8_neon;
+		blend_over16 = over16_neon;
+		break;
+#endif
+
+	case Blend::ISAScalar:
+	default:
+		blend_isa = Blend::ISAScalar;
+		blend_over8 = over8_scalar;
+		blend_over16 = over16_scalar;
+		break;
+	}
+}
+
+
+static void init(void) {
+	std::call_once(blend_once, [] {
+		const Blend::ISA isas[] = { Blend::ISAAVX2, Blend::ISASSE4, Blend::ISANEON, Blend::ISAScalar };
+
+		// Best supported instruction set
+		for (Blend::ISA isa : isas) {
+			if (isSupported(isa)) {
+				select(isa);
+				break;
+			}
+		}
+
+		log_info("Blend: use %s kernels", Blend::isa2string(blend_isa));
+	});
+}
+
+
+Blend::ISA Blend::isa(void) {
+	init();
+
+	return blend_isa;
+}
+
+
+bool Blend::setISA(Blend::ISA isa) {
+	init();
+
+	if (!isSupported(isa))
+		return false;
+
+	select(isa);
+
+	return true;
+}
+
+
+const char * Blend::isa2string(Blend::ISA isa) {
+	switch (isa) {
+	case ISAScalar:
+		return "scalar";
+	case ISASSE4:
+		return "sse4.1";
+	case ISAAVX2:
+		return "avx2";
+	case ISANEON:
+		return "neon";
+	default:
+		break;
+	}
+
+	return "unknown";
+}
+
+
+void Blend::over8(uint8_t *dst, const uint8_t *src, int n) {
+	init();
+
+	blend_over8(dst, src, n);
+}
+
+
+void Blend::over16(uint16_t *dst, const uint16_t *src, int n) {
+	init();
+
+	blend_over16(dst, src, n);
+}
+
+
+bool Blend::isBGRA(const OIIO::ImageSpec &spec) {
+	return (spec.nchannels >= 3) && (spec.channelnames.size() >= 3)
+		&& (spec.channelnames[0] == "B") && (spec.channelnames[2] == "R");
+}
+
+
+// Source row in the destination channels order & depth
+template <typename S, typename D>
+static void convert(D *dst, const S *src, int n, bool swap, uint32_t factor) {
+	const int r = swap ? 2 : 0;
+	const int b = swap ? 0 : 2;
+
+	for (int i=0; i<n; i++, dst+=4, src+=4) {
+		dst[0] = src[r] * factor;
+		dst[1] = src[1] * factor;
+		dst[2] = src[b] * factor;
+		dst[3] = src[3] * factor;
+	}
+}
+
+
+bool Blend::over(OIIO::ImageBuf &dst, const OIIO::ImageBuf &src, OIIO::ROI roi) {
+	int width;
+
+	bool swap;
+	bool expand;
+
+	OIIO::ROI area;
+
+	const OIIO::ImageSpec &dst_spec = dst.spec();
+	const OIIO::ImageSpec &src_spec = src.spec();
+
+	OIIO::TypeDesc::BASETYPE dst_type = (OIIO::TypeDesc::BASETYPE) dst_spec.format.basetype;
+	OIIO::TypeDesc::BASETYPE src_type = (OIIO::TypeDesc::BASETYPE) src_spec.format.basetype;
+
+	std::vector<uint8_t> row;
+
+	init();
+
+	// BGRA (cairo bitmap) over RGB(A), or the reverse
+	swap = (src_spec.nchannels == 4) && (isBGRA(src_spec) != isBGRA(dst_spec));
+
+	// Only RGBA 8/16 bits sources over RGB(A) 8/16 bits destination in memory
+	if ((src_spec.nchannels != 4) || (src_spec.alpha_channel != 3)
+		|| ((dst_spec.nchannels != 3) && (dst_spec.nchannels != 4))
+		|| ((dst_type != OIIO::TypeDesc::UINT8) && (dst_type != OIIO::TypeDesc::UINT16))
+		|| ((src_type != OIIO::TypeDesc::UINT8) && (src_type != dst_type))
+		|| (dst.localpixels() == NULL) || (src.localpixels() == NULL)) {
+		// OIIO blends channels by index
+		if (swap) {
+			int channelorder[] = { 2, 1, 0, 3 };
+			float channelvalues[] = { };
+			std::string channelnames[] = { isBGRA(dst_spec) ? "B" : "R", "G", isBGRA(dst_spec) ? "R" : "B", "A" };
+
+			OIIO::ImageBuf buf = OIIO::ImageBufAlgo::channels(src, 4, channelorder, channelvalues, channelnames);
+
+			return OIIO::ImageBufAlgo::over(dst, buf, dst, roi);
+		}
+
+		return OIIO::ImageBufAlgo::over(dst, src, dst, roi);
+	}
+
+	// Dirty area: src & dst data windows intersection
+	area = OIIO::roi_intersection(dst.roi(), src.roi());
+
+	if (roi.defined())
+		area = OIIO::roi_intersection(area, roi);
+
+	if ((area.width() <= 0) || (area.height() <= 0))
+		return true;
+
+	width = area.width();
+
+	// 8 bits source over 16 bits destination, expand each row
+	expand = (src_type == OIIO::TypeDesc::UINT8) && (dst_type == OIIO::TypeDesc::UINT16);
+
+	// Swap or expand each row in cache, no full bitmap pass
+	if (expand || swap)
+		row.resize(width * 4 * ((dst_type == OIIO::TypeDesc::UINT16) ? 2 : 1));
+
+	for (int y=area.ybegin; y<area.yend; y++) {
+		void *d = dst.pixeladdr(area.xbegin, y);
+		const void *s = src.pixeladdr(area.xbegin, y);
+
+		if (expand)
+			convert<uint8_t, uint16_t>((uint16_t *) row.data(), (const uint8_t *) s, width, swap, 257);
+		else if (swap && (dst_type == OIIO::TypeDesc::UINT16))
+			convert<uint16_t, uint16_t>((uint16_t *) row.data(), (const uint16_t *) s, width, swap, 1);
+		else if (swap)
+			convert<uint8_t, uint8_t>(row.data(), (const uint8_t *) s, width, swap, 1);
+
+		if (!row.empty())
+			s = row.data();
+
+		if (dst_spec.nchannels == 3) {
+			if (dst_type == OIIO::TypeDesc::UINT8)
+				over_rgb<uint8_t>((uint8_t *) d, (const uint8_t *) s, width, 255);
+			else
+				over_rgb<uint16_t>((uint16_t *) d, (const uint16_t *) s, width, 65535);
+		}
+		else if (dst_type == OIIO::TypeDesc::UINT8)
+			blend_over8((uint8_t *) d, (const uint8_t *) s, width);
+		else
+			blend_over16((uint16_t *) d, (const uint16_t *) s, width);
+	}
+
+	return true;
+}
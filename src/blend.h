@@ -0,0 +1,45 @@
+#ifndef __GPX2VIDEO__BLEND_H__
+#define __GPX2VIDEO__BLEND_H__
+
+#include <cstdint>
+
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+
+
+/**
+ * Premultiplied alpha "over" blending
+ *
+ *   dst = src + dst * (1 - src.alpha)
+ *
+ * 8 & 16 bits RGBA kernels, SIMD implementation selected at runtime.
+ */
+class Blend {
+public:
+	enum ISA {
+		ISAScalar,
+		ISASSE4,
+		ISAAVX2,
+		ISANEON,
+
+		ISACount
+	};
+
+	static ISA isa(void);
+	static bool setISA(ISA isa);
+	static const char * isa2string(ISA isa);
+
+	// Channels stored as B, G, R, A (cairo bitmap)
+	static bool isBGRA(const OIIO::ImageSpec &spec);
+
+	// Blend src over dst, only on src, dst & roi intersection. Fallback to
+	// OIIO if formats aren't supported. BGRA & RGBA may be mixed.
+	static bool over(OIIO::ImageBuf &dst, const OIIO::ImageBuf &src, OIIO::ROI roi=OIIO::ROI());
+
+	// RGBA rows
+	static void over8(uint8_t *dst, const uint8_t *src, int n);
+	static void over16(uint16_t *dst, const uint16_t *src, int n);
+};
+
+#endif
@@ -1,5 +1,15 @@
+#include <vector>
+#include <algorithm>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pwd.h>
+
 #include "log_i.h"
 #include "utils.h"
+#include "tilestore.h"
 #include "cache.h"
 
 
@@ -10,6 +20,7 @@ Cache::Cache(GPXApplication &app)
 
 
 Cache::~Cache() {
+	TileStore::close();
 }
 
 
@@ -22,11 +33,24 @@ Cache * Cache::create(GPXApplication &app) {
 }
 
 
+std::string Cache::path(void) {
+	const char *home = std::getenv("HOME");
+
+	if (home == NULL) {
+		struct passwd *pw = getpwuid(getuid());
+
+		home = (pw != NULL) ? pw->pw_dir : "/tmp";
+	}
+
+	return std::string(home) + "/.gpx2video/cache";
+}
+
+
 void Cache::init(void) {
 	log_call();
 
 	// Create gpx2video cache directories
-	path_ = std::getenv("HOME") + std::string("/.gpx2video/cache");
+	path_ = path();
 	Utils::mkpath(path_, 0700);
 }
 
@@ -39,16 +63,103 @@ bool Cache::start(void) {
 
 	log_notice("Cache initialization...");
 
-	if (app_.command() != GPXApplication::CommandClear)
+	if (app_.command() == GPXApplication::CommandClear) {
+		Utils::rmpath(path_);
 		goto done;
+	}
 
-	Utils::rmpath(path_);
+	// Map tiles store
+	TileStore::open(path_, StoreSize);
+
+	// Map & track mosaics
+	trimMosaics();
 
 done:
 	return true;
 }
 
 
+size_t Cache::mosaicSize(const std::string &path) {
+	DIR *dir;
+
+	size_t size = 0;
+
+	struct stat st;
+	struct dirent *entry;
+
+	if ((dir = ::opendir(path.c_str())) == NULL)
+		return 0;
+
+	// Mosaic is a flat directory of surface tiles
+	while ((entry = ::readdir(dir)) != NULL) {
+		std::string s = path + "/" + entry->d_name;
+
+		if (entry->d_name[0] == '.')
+			continue;
+
+		if ((stat(s.c_str(), &st) == 0) && S_ISREG(st.st_mode))
+			size += st.st_size;
+	}
+
+	::closedir(dir);
+
+	return size;
+}
+
+
+void Cache::trimMosaics(void) {
+	DIR *dir;
+
+	size_t size = 0;
+	size_t nb_dropped = 0;
+
+	struct stat st;
+	struct dirent *entry;
+
+	std::string path = path_ + "/mosaic";
+
+	std::vector<std::pair<time_t, std::string> > mosaics;
+
+	if ((dir = ::opendir(path.c_str())) == NULL)
+		return;
+
+	while ((entry = ::readdir(dir)) != NULL) {
+		std::string s = path + "/" + entry->d_name;
+
+		if (entry->d_name[0] == '.')
+			continue;
+
+		if ((stat(s.c_str(), &st) == 0) && S_ISDIR(st.st_mode))
+			mosaics.push_back(std::make_pair(st.st_mtime, s));
+	}
+
+	::closedir(dir);
+
+	// Most recently used first
+	std::sort(mosaics.begin(), mosaics.end(), [](const std::pair<time_t, std::string> &a,
+		const std::pair<time_t, std::string> &b) {
+		return a.first > b.first;
+	});
+
+	// Mosaic size depends on the map size, so count alone doesn't bound the disk usage.
+	// Last used mosaic is always kept.
+	for (size_t i=0; i<mosaics.size(); i++) {
+		size_t n = mosaicSize(mosaics[i].second);
+
+		if ((i > 0) && ((i >= MosaicCount) || (size + n > MosaicSize))) {
+			Utils::rmpath(mosaics[i].second);
+			nb_dropped++;
+			continue;
+		}
+
+		size += n;
+	}
+
+	if (nb_dropped > 0)
+		log_info("Cache: %lu map mosaic(s) dropped", nb_dropped);
+}
+
+
 bool Cache::run(void) {
 	log_call();
 
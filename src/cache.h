@@ -12,13 +12,18 @@ public:
 
 	static Cache * create(GPXApplication &app);
 
-	const std::string& path(void) const {
-		return path_;
-	}
+	// $HOME/.gpx2video/cache (user home directory if HOME isn't set)
+	static std::string path(void);
 
 	bool start(void);
 	bool run(void);
 
+	// Map tiles store budget
+	static const size_t StoreSize = (size_t) 1024 * 1024 * 1024;
+	// Map mosaics kept (last used), by count and by size
+	static const size_t MosaicCount = 16;
+	static const size_t MosaicSize = (size_t) 512 * 1024 * 1024;
+
 private:
 	GPXApplication &app_;
 
@@ -26,6 +31,10 @@ private:
 
 	void init(void);
 
+	// Drop least recently used map mosaics
+	void trimMosaics(void);
+	size_t mosaicSize(const std::string &path);
+
 	std::string path_;
 };
 
@@ -3,17 +3,28 @@
 #include <string>
 #include <algorithm>
 
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
 #include "log_i.h"
 #include "ffmpegutils.h"
+#include "yuvoverlay.h"
 #include "decoder.h"
 
 
 Decoder::Decoder()
-	: fmt_ctx_(NULL)
+	: demuxer_(NULL)
+	, own_demuxer_(false)
+	, passive_(false)
+	, avstream_(NULL)
 	, codec_ctx_(NULL)
-	, sws_ctx_(NULL)
+	, scaler_(NULL)
+	, scale_threads_(0)
+	, profiler_(NULL)
 	, opts_(NULL) {
 	pts_ = 0;
+	native_video_ = false;
 }
 
 
@@ -226,10 +237,19 @@ bool Decoder::open(StreamPtr stream) {
 	// Set stream
 	stream_ = stream;
 
+	// Packets are read once for all the container streams
+	if ((demuxer_ = stream->container()->demuxer()) == NULL)
+		return false;
+
+	own_demuxer_ = false;
+
 	// Try to open
-	if ((result = open(stream->container()->filename(), stream->index())) == false)
+	if ((result = openCodec(stream->index())) == false)
 		return false;
 
+	if (!passive_)
+		demuxer_->attach(stream->index());
+
 	if (stream->type() == AVMEDIA_TYPE_VIDEO) {
 		// Get a compatible AVPixelFormat
 		ideal_pix_fmt_ = FFmpegUtils::getCompatiblePixelFormat(static_cast<AVPixelFormat>(avstream_->codecpar->format));
@@ -243,14 +263,24 @@ bool Decoder::open(StreamPtr stream) {
 			av_log(NULL, AV_LOG_ERROR, "Failed to find valid native pixel format for %d\n", ideal_pix_fmt_);
 		}
 
+		// Keep decoded frames in native YUV format
+		if (native_video_) {
+			if (YUVOverlay::isSupported(static_cast<AVPixelFormat>(avstream_->codecpar->format)))
+				return true;
+
+			log_warn("Pixel format '%s' not supported by YUV compositing, fallback to RGB",
+				av_get_pix_fmt_name(static_cast<AVPixelFormat>(avstream_->codecpar->format)));
+
+			native_video_ = false;
+		}
+
 		// Init scaler
-		sws_ctx_ = sws_getContext(avstream_->codecpar->width, avstream_->codecpar->height, 
+		scaler_ = Scaler::create(scale_threads_);
+
+		if (!scaler_->init(avstream_->codecpar->width, avstream_->codecpar->height,
 				static_cast<AVPixelFormat>(avstream_->codecpar->format),
-				avstream_->codecpar->width, avstream_->codecpar->height, 
 				ideal_pix_fmt_,
-				SWS_FAST_BILINEAR, NULL, NULL, NULL);
-
-		if (sws_ctx_ == NULL) {
+				SWS_FAST_BILINEAR)) {
 			log_error("Decoder fails to create scale context");
 			return false;
 		}
@@ -261,21 +291,22 @@ bool Decoder::open(StreamPtr stream) {
 
 
 bool Decoder::open(const std::string &filename, const int &index) {
-	int result;
-
-	if ((result = avformat_open_input(&fmt_ctx_, filename.c_str(), NULL, NULL)) < 0) {
-		av_log(NULL, AV_LOG_ERROR, "Cannot open input file '%s'", filename.c_str());
+	// Own demuxer
+	if ((demuxer_ = Demuxer::create(filename)) == NULL)
 		return false;
-	}
 
-	// Get stream information from format
-	if ((result = avformat_find_stream_info(fmt_ctx_, NULL)) < 0) {
-		av_log(NULL, AV_LOG_ERROR, "Cannot find stream information\n");
-		return false;
-	}
+	own_demuxer_ = true;
+
+	return openCodec(index);
+}
+
+
+bool Decoder::openCodec(const int &index) {
+	int result;
 
 	// Get reference to correct AVStream
-	avstream_ = fmt_ctx_->streams[index];
+	if ((avstream_ = demuxer_->stream(index)) == NULL)
+		return false;
 
 	// Find decoder
 	const AVCodec *decoder = avcodec_find_decoder(avstream_->codecpar->codec_id);
@@ -326,9 +357,9 @@ void Decoder::close(void) {
 		opts_ = NULL;
 	}
 
-	if (sws_ctx_) {
-		sws_freeContext(sws_ctx_);
-		sws_ctx_ = NULL;
+	if (scaler_) {
+		delete scaler_;
+		scaler_ = NULL;
 	}
 
 	if (codec_ctx_) {
@@ -336,9 +367,13 @@ void Decoder::close(void) {
 		codec_ctx_ = NULL;
 	}
 
-	if (fmt_ctx_) {
-		avformat_close_input(&fmt_ctx_);
-		fmt_ctx_ = NULL;
+	if (demuxer_) {
+		if (own_demuxer_)
+			delete demuxer_;
+		else if (avstream_)
+			demuxer_->detach(avstream_->index);
+
+		demuxer_ = NULL;
 	}
 }
 
@@ -350,7 +385,7 @@ int Decoder::seek(int64_t target_ts) {
 
 	avcodec_flush_buffers(codec_ctx_);
 
-	result = av_seek_frame(fmt_ctx_, avstream_->index, seek_ts, AVSEEK_FLAG_BACKWARD);
+	result = demuxer_->seek(avstream_->index, seek_ts);
 
 	stream_->setEOF(false);
 
@@ -358,6 +393,118 @@ int Decoder::seek(int64_t target_ts) {
 }
 
 
+bool Decoder::keyframes(std::vector<int64_t> &timestamps) {
+	int result;
+	int nb_entries;
+
+	int64_t offset = 0;
+
+	AVPacket *packet;
+
+	Demuxer *demuxer;
+
+	const AVIndexEntry *entry;
+
+	timestamps.clear();
+
+	// Container index (MP4 sample table), file isn't read
+	nb_entries = FFmpegUtils::getIndexEntriesCount(avstream_);
+
+	if (nb_entries > 0) {
+		// Index timestamps are DTS, shift by the first frame delay to get PTS
+		entry = FFmpegUtils::getIndexEntry(avstream_, 0);
+
+		if ((entry != NULL) && (avstream_->start_time != AV_NOPTS_VALUE))
+			offset = avstream_->start_time - entry->timestamp;
+
+		for (int i=0; i<nb_entries; i++) {
+			entry = FFmpegUtils::getIndexEntry(avstream_, i);
+
+			if ((entry != NULL) && (entry->flags & AVINDEX_KEYFRAME))
+				timestamps.push_back(entry->timestamp + offset);
+		}
+
+		std::sort(timestamps.begin(), timestamps.end());
+
+		if (!timestamps.empty()) {
+			log_info("Video keyframes read from the %d samples index", nb_entries);
+			return true;
+		}
+	}
+
+	// No index, scan with a demuxer of its own, so as decoders position isn't changed
+	if ((demuxer = Demuxer::create(stream_->container()->filename())) == NULL)
+		return false;
+
+	packet = av_packet_alloc();
+
+	// Demux only, keyframe PTS (in stream time base units)
+	while ((result = demuxer->read(avstream_->index, packet)) >= 0) {
+		if (packet->flags & AV_PKT_FLAG_KEY) {
+			int64_t ts = (packet->pts != AV_NOPTS_VALUE) ? packet->pts : packet->dts;
+
+			if (ts != AV_NOPTS_VALUE)
+				timestamps.push_back(ts);
+		}
+
+		av_packet_unref(packet);
+	}
+
+	av_packet_free(&packet);
+
+	delete demuxer;
+
+	std::sort(timestamps.begin(), timestamps.end());
+
+	return (result == AVERROR_EOF) && !timestamps.empty();
+}
+
+
+void Decoder::setNativeVideo(bool enable) {
+	native_video_ = enable;
+}
+
+
+const bool& Decoder::isNativeVideo(void) const {
+	return native_video_;
+}
+
+
+void Decoder::setPassive(bool enable) {
+	passive_ = enable;
+}
+
+
+void Decoder::setScaleThreads(int nb_threads) {
+	scale_threads_ = nb_threads;
+}
+
+
+void Decoder::setFramePool(FramePoolPtr pool) {
+	frame_pool_ = pool;
+}
+
+
+void Decoder::setProfiler(Profiler *profiler) {
+	profiler_ = profiler;
+}
+
+
+AVPixelFormat Decoder::pixelFormat(void) const {
+	return static_cast<AVPixelFormat>(avstream_->codecpar->format);
+}
+
+
+AVColorSpace Decoder::colorSpace(void) const {
+	return avstream_->codecpar->color_space;
+}
+
+
+AVColorRange Decoder::colorRange(void) const {
+	return avstream_->codecpar->color_range;
+}
+
+
 const AVCodecID& Decoder::codec(void) const {
 	return avstream_->codecpar->codec_id;
 }
@@ -372,14 +519,8 @@ int Decoder::getFrame(AVPacket *packet, AVFrame *frame) {
 	av_frame_unref(frame);
 
 	while ((result = avcodec_receive_frame(codec_ctx_, frame)) == AVERROR(EAGAIN) && !eof) {
-		// Find next packet in the correct stream index
-		do {
-			// Free buffer in packet if there is one
-			av_packet_unref(packet);
-
-			// Read packet from file
-			result = av_read_frame(fmt_ctx_, packet);
-		} while (packet->stream_index != avstream_->index && result >= 0);
+		// Find next packet in the correct stream index (others are queued)
+		result = demuxer_->read(avstream_->index, packet);
 
 		if (result == AVERROR_EOF) {
 			// Don't break so that receive gets called again, but don't try to read again
@@ -499,6 +640,45 @@ uint8_t * Decoder::retrieveAudioFrameData(const AudioParams &params, const int64
 }
 
 
+AVPacket * Decoder::retrieveAudioPacket(AVRational timecode, int duration) {
+	int result;
+
+	AVPacket *packet = NULL;
+
+	AudioStreamPtr as = std::static_pointer_cast<AudioStream>(stream());
+
+	int64_t target_ts = as->getTimeInTimeBaseUnits(timecode);
+
+	duration = as->getTimeInTimeBaseUnits(av_make_q(duration, 1));
+
+	// Check if PTS is in the range [target_ts:target_ts + duration]
+	if (duration > 0) {
+		if ((1000 * pts_) > (target_ts + duration))
+			return NULL;
+	}
+
+	packet = av_packet_alloc();
+
+	// Next packet, as read from the input
+	result = demuxer_->read(avstream_->index, packet);
+
+	if (result < 0) {
+		// End of stream
+		if (result == AVERROR_EOF)
+			stream_->setEOF(true);
+
+		av_packet_free(&packet);
+
+		return NULL;
+	}
+
+	if (packet->pts != AV_NOPTS_VALUE)
+		pts_ = packet->pts;
+
+	return packet;
+}
+
+
 SampleBufferPtr Decoder::retrieveAudio2(const AudioParams &params, AVRational timecode, int duration) {
 //	uint8_t *data;
 //
@@ -660,6 +840,11 @@ SampleBufferPtr Decoder::retrieveAudioFrameData2(const AudioParams &params, cons
 FramePtr Decoder::retrieveVideo(AVRational timecode, uint8_t *data) {
 //	uint8_t *data;
 	bool allocated;
+	bool pooled = false;
+
+	uint8_t *buffer;
+
+	size_t size = 0;
 
 	double duration;
 
@@ -669,11 +854,37 @@ FramePtr Decoder::retrieveVideo(AVRational timecode, uint8_t *data) {
 
 	int64_t target_ts = vs->getTimeInTimeBaseUnits(timecode);
 
+	AVFrame *avframe = NULL;
+
 	allocated = (data == NULL);
 
 	// Retrieve frame data
-	if ((data = retrieveVideoFrameData(target_ts, data)) == NULL)
-		return NULL;
+	if (native_video_) {
+		if ((avframe = retrieveVideoAVFrame()) == NULL)
+			return NULL;
+
+		data = NULL;
+		allocated = false;
+	}
+	else {
+		// Recycled buffer
+		if ((data == NULL) && (frame_pool_ != NULL)) {
+			size = videoSize();
+
+			if ((data = frame_pool_->acquire(size)) == NULL)
+				return NULL;
+
+			pooled = true;
+		}
+
+		if ((buffer = retrieveVideoFrameData(target_ts, data)) == NULL) {
+			if (pooled)
+				frame_pool_->release(data, size);
+			return NULL;
+		}
+
+		data = buffer;
+	}
 
 	frame_rate = vs->frameRate();
 	duration = (frame_rate.num && frame_rate.den ? av_q2d((AVRational){frame_rate.den, frame_rate.num}) : 0);
@@ -691,7 +902,11 @@ FramePtr Decoder::retrieveVideo(AVRational timecode, uint8_t *data) {
 	// TODO : do better !!!
 	frame->setTimestamp(pts_);
 	frame->setDuration(duration);
-	frame->setData(data, allocated);
+	if (pooled)
+		frame->setData(data, frame_pool_, size);
+	else
+		frame->setData(data, allocated);
+	frame->setAVFrame(avframe);
 	
 	return frame;
 }
@@ -699,7 +914,8 @@ FramePtr Decoder::retrieveVideo(AVRational timecode, uint8_t *data) {
 uint8_t * Decoder::retrieveVideoFrameData(const int64_t& target_ts, uint8_t *data) {
 	int result;
 
-//	uint8_t *data = NULL;
+	// Buffer filled, NULL on EOF or error (caller keeps its own buffer)
+	uint8_t *buffer = NULL;
 
 	AVPacket *packet = av_packet_alloc();
 	AVFrame *frame = av_frame_alloc();
@@ -723,7 +939,7 @@ uint8_t * Decoder::retrieveVideoFrameData(const int64_t& target_ts, uint8_t *dat
 
 		// Store data
 		int linesize = Frame::generateLinesizeBytes(frame->width, native_pix_fmt_, native_nb_channels_);
-		size_t size = VideoParams::getBufferSize(linesize, frame->height, native_pix_fmt_, native_nb_channels_);
+		size_t size = (size_t) linesize * frame->height;
 //printf("linesize = [%d,%d,%d] / dst_linesize = %d / height = %d\n", 
 //		frame->linesize[0], frame->linesize[1], frame->linesize[2], linesize, frame->height);
 //printf("buffsize = %ld\n", size);
@@ -731,14 +947,15 @@ uint8_t * Decoder::retrieveVideoFrameData(const int64_t& target_ts, uint8_t *dat
 		if (data == NULL)
 			data = (uint8_t *) malloc(size * sizeof(uint8_t));
 
-		sws_scale(sws_ctx_,
-			(const uint8_t * const *) frame->data,
+		Profiler::Scope scope(profiler_, "decode.convert");
+
+		scaler_->scale((const uint8_t * const *) frame->data,
 			frame->linesize,
-			0,
-			frame->height,
 			&data,
 			&linesize);
 
+		buffer = data;
+
 		pts_ = frame->pts;
 
 //		printf("  PTS: %ld / TS: %ld ms\n", pts_,
@@ -750,15 +967,39 @@ uint8_t * Decoder::retrieveVideoFrameData(const int64_t& target_ts, uint8_t *dat
 	av_frame_free(&frame);
 	av_packet_free(&packet);
 
-	return data;
+	return buffer;
+}
+
+
+AVFrame * Decoder::retrieveVideoAVFrame(void) {
+	int result;
+
+	AVPacket *packet = av_packet_alloc();
+	AVFrame *frame = av_frame_alloc();
+
+	// Pull from decoder
+	result = getFrame(packet, frame);
+
+	av_packet_free(&packet);
+
+	// Handle errors & EOF
+	if (result < 0) {
+		av_frame_free(&frame);
+		return NULL;
+	}
+
+	pts_ = frame->pts;
+
+	return frame;
 }
 
 
 size_t Decoder::videoSize(void) {
 	VideoStreamPtr vs = std::static_pointer_cast<VideoStream>(stream());
 
+	// Decoded frame buffer, as filled by retrieveVideoFrameData
 	int linesize = Frame::generateLinesizeBytes(vs->width(), native_pix_fmt_, native_nb_channels_);
-	size_t size = VideoParams::getBufferSize(linesize, vs->height(), native_pix_fmt_, native_nb_channels_);
+	size_t size = (size_t) linesize * vs->height();
 
 	return size;
 }
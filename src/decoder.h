@@ -12,9 +12,12 @@ extern "C" {
 }
 
 #include "frame.h"
+#include "framepool.h"
+#include "profiler.h"
 #include "stream.h"
 #include "media.h"
 #include "samplebuffer.h"
+#include "scaler.h"
 
 
 class Decoder {
@@ -32,6 +35,27 @@ public:
 //	int seek(AVRational timecode);
 	int seek(int64_t target_ts);
 
+	bool keyframes(std::vector<int64_t> &timestamps);
+
+	// Keep video frames in native YUV format (see YUVOverlay)
+	void setNativeVideo(bool enable);
+	const bool& isNativeVideo(void) const;
+
+	// Stream info & keyframes only, packets aren't queued for this decoder
+	void setPassive(bool enable);
+
+	// Colour conversion threads (0 => auto)
+	void setScaleThreads(int nb_threads);
+
+	// Draw video frame buffers from a recycling pool
+	void setFramePool(FramePoolPtr pool);
+
+	void setProfiler(Profiler *profiler);
+
+	AVPixelFormat pixelFormat(void) const;
+	AVColorSpace colorSpace(void) const;
+	AVColorRange colorRange(void) const;
+
 	const AVCodecID& codec(void) const;
 
 	size_t videoSize(void);
@@ -39,11 +63,15 @@ public:
 	FramePtr retrieveAudio(const AudioParams &params, AVRational timecode, int duration);
 	uint8_t * retrieveAudioFrameData(const AudioParams &params, const int64_t& target_ts, const int& duration);
 
+	// Compressed audio packet, to be copied (caller frees it)
+	AVPacket * retrieveAudioPacket(AVRational timecode, int duration);
+
 	SampleBufferPtr retrieveAudio2(const AudioParams &params, AVRational timecode, int duration);
 	SampleBufferPtr retrieveAudioFrameData2(const AudioParams &params, const int64_t& target_ts, const int& duration);
 
 	FramePtr retrieveVideo(AVRational timecode, uint8_t *data = NULL);
 	uint8_t * retrieveVideoFrameData(const int64_t& target_ts, uint8_t *data);
+	AVFrame * retrieveVideoAVFrame(void);
 
 protected:
 	StreamPtr stream(void) const {
@@ -51,6 +79,7 @@ protected:
 	}
 
 	bool open(const std::string &filename, const int &index);
+	bool openCodec(const int &index);
 
 private:
 	double getRotation(AVStream* stream);
@@ -63,7 +92,11 @@ private:
 
 	StreamPtr stream_;
 
-	AVFormatContext *fmt_ctx_;
+	// Container demuxer (shared) or own demuxer (probe)
+	Demuxer *demuxer_;
+	bool own_demuxer_;
+
+	bool passive_;
 
 	AVStream *avstream_;
 	AVCodecContext *codec_ctx_;
@@ -72,7 +105,14 @@ private:
 	VideoParams::Format native_pix_fmt_;
 	int native_nb_channels_;
 
-	SwsContext *sws_ctx_;
+	Scaler *scaler_;
+	int scale_threads_;
+
+	bool native_video_;
+
+	FramePoolPtr frame_pool_;
+
+	Profiler *profiler_;
 
 	AVDictionary *opts_;
 
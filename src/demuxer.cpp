@@ -0,0 +1,259 @@
+#include <iostream>
+
+#include "log_i.h"
+#include "demuxer.h"
+
+
+Demuxer::Demuxer()
+	: fmt_ctx_(NULL)
+	, is_seeked_(false)
+	, seek_index_(-1)
+	, is_waiting_(false)
+	, generation_(0) {
+}
+
+
+Demuxer::~Demuxer() {
+	flush();
+
+	if (fmt_ctx_) {
+		avformat_close_input(&fmt_ctx_);
+		fmt_ctx_ = NULL;
+	}
+}
+
+
+Demuxer * Demuxer::create(const std::string &filename) {
+	Demuxer *demuxer = new Demuxer();
+
+	if (!demuxer->open(filename)) {
+		delete demuxer;
+		return NULL;
+	}
+
+	return demuxer;
+}
+
+
+bool Demuxer::open(const std::string &filename) {
+	int result;
+
+	if ((result = avformat_open_input(&fmt_ctx_, filename.c_str(), NULL, NULL)) < 0) {
+		av_log(NULL, AV_LOG_ERROR, "Cannot open input file '%s'", filename.c_str());
+		return false;
+	}
+
+	// Get stream information from format
+	if ((result = avformat_find_stream_info(fmt_ctx_, NULL)) < 0) {
+		av_log(NULL, AV_LOG_ERROR, "Cannot find stream information\n");
+		return false;
+	}
+
+	return true;
+}
+
+
+AVFormatContext * Demuxer::context(void) const {
+	return fmt_ctx_;
+}
+
+
+AVStream * Demuxer::stream(int index) const {
+	if ((index < 0) || (index >= (int) fmt_ctx_->nb_streams))
+		return NULL;
+
+	return fmt_ctx_->streams[index];
+}
+
+
+void Demuxer::attach(int index) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	queues_[index];
+}
+
+
+void Demuxer::detach(int index) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto it = queues_.find(index);
+
+	if (it == queues_.end())
+		return;
+
+	clear(it->second);
+
+	queues_.erase(it);
+	starts_.erase(index);
+
+	cond_drained_.notify_all();
+}
+
+
+bool Demuxer::isSkipped(AVPacket *packet) {
+	auto it = starts_.find(packet->stream_index);
+
+	if (it == starts_.end())
+		return false;
+
+	// Packet ends before the seek timestamp
+	if ((packet->pts != AV_NOPTS_VALUE) && (packet->pts + packet->duration <= it->second))
+		return true;
+
+	starts_.erase(it);
+
+	return false;
+}
+
+
+int Demuxer::read(int index, AVPacket *packet) {
+	int result;
+
+	std::unique_lock<std::mutex> lock(mutex_);
+
+	while (true) {
+		auto it = queues_.find(index);
+
+		// Packet already read
+		if ((it != queues_.end()) && !it->second.packets.empty()) {
+			AVPacket *queued = it->second.packets.front();
+
+			it->second.packets.pop_front();
+			it->second.size -= queued->size;
+
+			av_packet_unref(packet);
+			av_packet_move_ref(packet, queued);
+			av_packet_free(&queued);
+
+			cond_drained_.notify_all();
+
+			return 0;
+		}
+
+		// Another reader waits to queue a packet, keep the file order
+		if (is_waiting_) {
+			cond_drained_.wait(lock);
+			continue;
+		}
+
+		// Free buffer in packet if there is one
+		av_packet_unref(packet);
+
+		// Read packet from file
+		if ((result = av_read_frame(fmt_ctx_, packet)) < 0)
+			break;
+
+		is_seeked_ = false;
+
+		if (isSkipped(packet))
+			continue;
+
+		if (packet->stream_index == index)
+			break;
+
+		// Queue packet for its decoder, drop if none
+		if (!push(lock, packet)) {
+			av_packet_unref(packet);
+			result = AVERROR(ENOBUFS);
+			break;
+		}
+	}
+
+	return result;
+}
+
+
+int Demuxer::seek(int index, int64_t timestamp) {
+	int result;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	// Demuxer already moved by another stream, drop packets till timestamp
+	if (is_seeked_ && (index != seek_index_)) {
+		starts_[index] = timestamp;
+		return 0;
+	}
+
+	result = av_seek_frame(fmt_ctx_, index, timestamp, AVSEEK_FLAG_BACKWARD);
+
+	// Packets read before seek are obsolete
+	flush();
+
+	is_seeked_ = (result >= 0);
+	seek_index_ = index;
+
+	return result;
+}
+
+
+bool Demuxer::push(std::unique_lock<std::mutex> &lock, AVPacket *packet) {
+	AVPacket *queued;
+
+	int index = packet->stream_index;
+
+	auto it = queues_.find(index);
+
+	// None decoder
+	if (it == queues_.end()) {
+		av_packet_unref(packet);
+		return true;
+	}
+
+	// Queue full, wait for its decoder (lock released while waiting)
+	if (it->second.isFull(packet)) {
+		uint64_t generation = generation_;
+
+		is_waiting_ = true;
+
+		bool drained = cond_drained_.wait_for(lock, std::chrono::milliseconds(MaxQueueWait), [this, index, packet, generation] {
+			auto it = queues_.find(index);
+
+			return (it == queues_.end()) || (generation_ != generation) || !it->second.isFull(packet);
+		});
+
+		is_waiting_ = false;
+
+		cond_drained_.notify_all();
+
+		if (!drained) {
+			log_error("Demuxer: stream %d queue full, not read", index);
+			return false;
+		}
+
+		// Detached or seeked while waiting, packet is obsolete
+		if (((it = queues_.find(index)) == queues_.end()) || (generation_ != generation)) {
+			av_packet_unref(packet);
+			return true;
+		}
+	}
+
+	queued = av_packet_alloc();
+
+	av_packet_move_ref(queued, packet);
+
+	it->second.packets.push_back(queued);
+	it->second.size += queued->size;
+
+	return true;
+}
+
+
+void Demuxer::clear(Queue &queue) {
+	for (AVPacket *packet : queue.packets)
+		av_packet_free(&packet);
+
+	queue.packets.clear();
+	queue.size = 0;
+}
+
+
+void Demuxer::flush(void) {
+	for (auto &it : queues_)
+		clear(it.second);
+
+	starts_.clear();
+
+	generation_++;
+
+	cond_drained_.notify_all();
+}
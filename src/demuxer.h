@@ -0,0 +1,99 @@
+#ifndef __GPX2VIDEO__DEMUXER_H__
+#define __GPX2VIDEO__DEMUXER_H__
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <condition_variable>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+
+/**
+ * Media file demuxer
+ *
+ * One demuxer per media container is shared by the video, audio & GPMF
+ * decoders, so the file is read once. Each packet read is dispatched to
+ * the queue of its stream, until the decoder asks for it.
+ *
+ * Decoders run in their own thread, packets are read under lock. Queues
+ * are bounded: once the queue of a stream is full, reading waits for its
+ * decoder to drain it. If it doesn't in time (stream read too late or
+ * never), the read fails, packets aren't dropped.
+ */
+class Demuxer {
+public:
+	virtual ~Demuxer();
+
+	static Demuxer * create(const std::string &filename);
+
+	AVFormatContext * context(void) const;
+	AVStream * stream(int index) const;
+
+	// Queue packets of a stream (read by a decoder)
+	void attach(int index);
+	void detach(int index);
+
+	// Next packet of a stream, packets of the other streams are queued
+	int read(int index, AVPacket *packet);
+
+	// Seek to the timestamp (stream time base), first seek moves the demuxer,
+	// streams seeking next drop their packets before the timestamp
+	int seek(int index, int64_t timestamp);
+
+	// Per stream queue limits
+	static const size_t MaxQueuePackets = 1024;
+	static const size_t MaxQueueSize = 64 * 1024 * 1024;
+
+	// Wait for a full queue to drain (ms)
+	static const int MaxQueueWait = 10000;
+
+private:
+	class Queue {
+	public:
+		Queue()
+			: size(0) {
+		}
+
+		bool isFull(const AVPacket *packet) const {
+			return (packets.size() >= MaxQueuePackets) || (size + packet->size > MaxQueueSize);
+		}
+
+		std::deque<AVPacket *> packets;
+
+		// Bytes queued
+		size_t size;
+	};
+
+	Demuxer();
+
+	bool open(const std::string &filename);
+
+	bool isSkipped(AVPacket *packet);
+	bool push(std::unique_lock<std::mutex> &lock, AVPacket *packet);
+	void clear(Queue &queue);
+	void flush(void);
+
+	std::mutex mutex_;
+	std::condition_variable cond_drained_;
+
+	AVFormatContext *fmt_ctx_;
+
+	std::map<int, Queue> queues_;
+
+	// Packets before the seek timestamp are dropped, per stream
+	std::map<int, int64_t> starts_;
+
+	bool is_seeked_;
+	int seek_index_;
+
+	// A packet waits for its queue to drain & queues flush count
+	bool is_waiting_;
+	uint64_t generation_;
+};
+
+#endif
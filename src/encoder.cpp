@@ -9,7 +9,8 @@ EncoderSettings::EncoderSettings() :
 	video_min_bit_rate_(0),
 	video_max_bit_rate_(0),
 	video_buffer_size_(0),
-	audio_enabled_(false) {
+	audio_enabled_(false),
+	audio_copy_params_(NULL) {
 }
 
 
@@ -136,6 +137,16 @@ void EncoderSettings::setAudioBitrate(const int64_t rate) {
 }
 
 
+const AVCodecParameters * EncoderSettings::audioCopyParameters(void) const {
+	return audio_copy_params_;
+}
+
+
+void EncoderSettings::setAudioCopy(const AVCodecParameters *codecpar) {
+	audio_copy_params_ = codecpar;
+}
+
+
 Encoder::Encoder(const EncoderSettings &settings) : 
 	settings_(settings),
 	open_(false),
@@ -144,7 +155,17 @@ Encoder::Encoder(const EncoderSettings &settings) :
 	video_codec_(NULL),
 	audio_stream_(NULL),
 	audio_codec_(NULL),
-	hw_device_ctx_(NULL) {
+	audio_copy_(false),
+	scaler_(NULL),
+	native_scaler_(NULL),
+	scale_threads_(0),
+	hw_device_ctx_(NULL),
+	video_frame_(NULL),
+	hw_frame_(NULL),
+	thread_mux_(NULL),
+	mux_queue_(MuxQueueSize),
+	mux_failed_(false),
+	profiler_(NULL) {
 	log_call();
 }
 
@@ -159,6 +180,11 @@ const EncoderSettings& Encoder::settings() const {
 }
 
 
+const bool& Encoder::isAudioCopy(void) const {
+	return audio_copy_;
+}
+
+
 Encoder * Encoder::create(const EncoderSettings &settings) {
 	Encoder *encoder = new Encoder(settings);
 
@@ -218,18 +244,35 @@ bool Encoder::open(void) {
 //			(AVPixelFormat) video_codec_->pix_fmt,
 //			0, NULL, NULL, NULL);
 
-		sws_ctx_ = sws_getContext(settings_.videoParams().width(), settings_.videoParams().height(), 
+		scaler_ = Scaler::create(scale_threads_);
+
+		if (!scaler_->init(settings_.videoParams().width(), settings_.videoParams().height(),
 			ideal_pix_fmt,
-			settings_.videoParams().width(), settings_.videoParams().height(), 
 			settings().videoParams().pixelFormat(),
-			0, NULL, NULL, NULL);
-
+			0)) {
+			av_log(NULL, AV_LOG_ERROR, "Failed to create scale context\n");
+			return false;
+		}
 	}
 
 	// Initialize audio stream
 	if (settings().isAudioEnabled()) {
-		if (!this->initializeStream(AVMEDIA_TYPE_AUDIO, &audio_stream_, &audio_codec_, settings_.audioCodec()))
-			return false;
+		const AVCodecParameters *codecpar = settings().audioCopyParameters();
+
+		// Copy audio packets if the container can carry the input codec, else encode
+		if ((codecpar != NULL) && (avformat_query_codec(fmt_ctx_->oformat, codecpar->codec_id, FF_COMPLIANCE_NORMAL) == 1)) {
+			if (!this->initializeCopyStream(&audio_stream_, codecpar))
+				return false;
+
+			audio_copy_ = true;
+		}
+		else {
+			if (codecpar != NULL)
+				log_notice("Audio codec '%s' can't be copied, encode audio", avcodec_get_name(codecpar->codec_id));
+
+			if (!this->initializeStream(AVMEDIA_TYPE_AUDIO, &audio_stream_, &audio_codec_, settings_.audioCodec()))
+				return false;
+		}
 	}
 
 	// Dump info
@@ -253,20 +296,47 @@ bool Encoder::open(void) {
         return false;
     }
 
+	// Output frames reused for each frame
+	video_frame_ = av_frame_alloc();
+	hw_frame_ = av_frame_alloc();
+
+	// Write packets in background
+	mux_queue_.reset();
+	mux_failed_ = false;
+
+	thread_mux_ = new std::thread([this] {
+		mux();
+	});
+
 	open_ = true;
 
 	return true;
 }
 
 
-void Encoder::close(void) {
+bool Encoder::close(void) {
+	bool success = true;
+
 	log_call();
 
 	if (open_) {
 		this->flush();
 
+		// Wait for the pending packets
+		mux_queue_.close();
+
+		thread_mux_->join();
+		delete thread_mux_;
+		thread_mux_ = NULL;
+
+		if (mux_failed_)
+			success = false;
+
 		// Write trailer
-		av_write_trailer(fmt_ctx_);
+		if (av_write_trailer(fmt_ctx_) < 0) {
+			av_log(NULL, AV_LOG_ERROR, "Failed to write output file trailer\n");
+			success = false;
+		}
 
 		if (!(fmt_ctx_->oformat->flags & AVFMT_NOFILE))
 			avio_closep(&fmt_ctx_->pb);
@@ -274,9 +344,14 @@ void Encoder::close(void) {
 		open_ = false;
 	}
 
-	if (sws_ctx_) {
-		sws_freeContext(sws_ctx_);
-		sws_ctx_ = NULL;
+	if (scaler_) {
+		delete scaler_;
+		scaler_ = NULL;
+	}
+
+	if (native_scaler_) {
+		delete native_scaler_;
+		native_scaler_ = NULL;
 	}
 
 	if (video_codec_) {
@@ -294,10 +369,20 @@ void Encoder::close(void) {
 		hw_device_ctx_ = NULL;
 	}
 
+	av_frame_free(&video_frame_);
+	av_frame_free(&hw_frame_);
+
+	for (AVPacket *packet : packets_)
+		av_packet_free(&packet);
+
+	packets_.clear();
+
 	if (fmt_ctx_) {
 		avformat_free_context(fmt_ctx_);
 		fmt_ctx_ = NULL;
 	}
+
+	return success;
 }
 
 
@@ -313,24 +398,116 @@ void Encoder::flush(void) {
 void Encoder::flush(AVCodecContext *codec_ctx, AVStream *stream) {
 	avcodec_send_frame(codec_ctx, NULL);
 
-	AVPacket *packet = av_packet_alloc();
+	AVPacket *packet;
 
 	int result;
 
 	do {
+		packet = getPacket();
+
 		result = avcodec_receive_packet(codec_ctx, packet);
 
-		if (result < 0)
+		if (result < 0) {
+			releasePacket(packet);
 			break;
+		}
 
 		packet->stream_index = stream->index;
 
 		av_packet_rescale_ts(packet, codec_ctx->time_base, stream->time_base);
-		av_interleaved_write_frame(fmt_ctx_, packet);
-		av_packet_unref(packet);
+
+		writePacket(packet);
 	} while (result >= 0);
+}
+
+
+void Encoder::mux(void) {
+	int result;
+
+	AVPacket *packet;
+
+	if (profiler_)
+		profiler_->setThreadName("mux");
+
+	while (mux_queue_.pop(packet)) {
+		{
+			Profiler::Scope scope(profiler_, "mux");
+
+			result = av_interleaved_write_frame(fmt_ctx_, packet);
+		}
+
+		if ((result < 0) && !mux_failed_) {
+			av_log(NULL, AV_LOG_ERROR, "Failed to write packet to output file\n");
+			mux_failed_ = true;
+		}
+
+		releasePacket(packet);
+	}
+}
+
+
+AVPacket * Encoder::getPacket(void) {
+	AVPacket *packet;
+
+	std::lock_guard<std::mutex> lock(packets_mutex_);
+
+	if (packets_.empty())
+		return av_packet_alloc();
+
+	packet = packets_.back();
+	packets_.pop_back();
+
+	return packet;
+}
+
+
+void Encoder::releasePacket(AVPacket *packet) {
+	av_packet_unref(packet);
+
+	std::lock_guard<std::mutex> lock(packets_mutex_);
+
+	packets_.push_back(packet);
+}
+
+
+void Encoder::writePacket(AVPacket *packet) {
+	// Wait if the mux thread is late (bounded queue)
+	if (!mux_queue_.push(packet))
+		releasePacket(packet);
+}
+
+
+bool Encoder::initializeCopyStream(AVStream **stream_ptr, const AVCodecParameters *codecpar) {
+	int result;
+
+	AVStream *stream;
+
+	log_call();
+
+	log_info("Initialize stream in copying '%s' codec", avcodec_get_name(codecpar->codec_id));
+
+	// Create stream
+	stream = avformat_new_stream(fmt_ctx_, NULL);
+
+	if (!stream) {
+		av_log(NULL, AV_LOG_ERROR, "Failed allocating output stream\n");
+		return false;
+	}
+
+	result = avcodec_parameters_copy(stream->codecpar, codecpar);
+
+	if (result < 0) {
+		av_log(NULL, AV_LOG_ERROR, "Failed to copy codec parameters to stream\n");
+		return false;
+	}
+
+	// Let the muxer choose its own tag
+	stream->codecpar->codec_tag = 0;
+	stream->time_base = settings().audioParams().timeBase();
 
-	av_packet_free(&packet);
+	*stream_ptr = stream;
+
+	return true;
 }
 
 
@@ -520,6 +697,21 @@ void Encoder::setRotation(double theta) {
 }
 
 
+void Encoder::setFramePool(FramePoolPtr pool) {
+	frame_pool_ = pool;
+}
+
+
+void Encoder::setProfiler(Profiler *profiler) {
+	profiler_ = profiler;
+}
+
+
+void Encoder::setScaleThreads(int nb_threads) {
+	scale_threads_ = nb_threads;
+}
+
+
 bool Encoder::writeAudio(FramePtr frame, AVRational time) {
 	bool success = false;
 
@@ -537,15 +729,61 @@ bool Encoder::writeAudio(FramePtr frame, AVRational time) {
 }
 
 
+bool Encoder::writeAudioPacket(AVPacket *packet) {
+	AVPacket *output;
+
+	// Output file can't be written anymore
+	if (mux_failed_)
+		return false;
+
+	output = getPacket();
+
+	// Input packet, timestamps in the input stream time base
+	av_packet_move_ref(output, packet);
+
+	output->stream_index = audio_stream_->index;
+	output->pos = -1;
+
+	av_packet_rescale_ts(output, settings().audioParams().timeBase(), audio_stream_->time_base);
+
+	writePacket(output);
+
+	return !mux_failed_;
+}
+
+
 bool Encoder::writeFrame(FramePtr frame, AVRational time) {
 	int result;
 
 	bool success = false;
 
+	int64_t begin;
+
 	int input_linesize;
 	const uint8_t *input_data;
 
-	AVFrame *encoded_frame = av_frame_alloc();
+	AVFrame *native_frame = frame->avFrame();
+	AVFrame *encoded_frame = NULL;
+
+	// Output file can't be written anymore
+	if (mux_failed_)
+		return false;
+
+	// Output frame, reused
+	encoded_frame = video_frame_;
+
+	// Native frame (YUV compositing) yet in the output pixel format
+	if ((native_frame != NULL) && (native_frame->format == settings().videoParams().pixelFormat())) {
+		if (av_frame_ref(encoded_frame, native_frame) < 0) {
+			av_log(NULL, AV_LOG_ERROR, "Failed to reference native frame\n");
+			goto fail;
+		}
+
+		// Let the encoder choose the picture type
+		encoded_frame->pict_type = AV_PICTURE_TYPE_NONE;
+
+		goto encode;
+	}
 
 	// Frame must be video
 	encoded_frame->width = frame->videoParams().width();
@@ -578,7 +816,10 @@ bool Encoder::writeFrame(FramePtr frame, AVRational time) {
 	}
 
 	// Create encoded buffer
-	result = av_frame_get_buffer(encoded_frame, 0);
+	if (frame_pool_ != NULL)
+		result = frame_pool_->getBuffer(encoded_frame);
+	else
+		result = av_frame_get_buffer(encoded_frame, 0);
 	if (result < 0) {
 		av_log(NULL, AV_LOG_ERROR, "Failed to create AVFrame buffer\n");
 		goto fail;
@@ -590,47 +831,85 @@ bool Encoder::writeFrame(FramePtr frame, AVRational time) {
 //		av_log(NULL, AV_LOG_ERROR, "NEED TO CONVERT THIS FRAME\n");
 //	}
 
+	// Native frame, only convert the YUV layout (yuvj420p, nv12...)
+	if (native_frame != NULL) {
+		if (native_scaler_ == NULL)
+			native_scaler_ = Scaler::create(scale_threads_);
+
+		if (!native_scaler_->init(native_frame->width, native_frame->height,
+			(AVPixelFormat) native_frame->format, (AVPixelFormat) encoded_frame->format,
+			SWS_FAST_BILINEAR)) {
+			av_log(NULL, AV_LOG_ERROR, "Failed to create native scale context\n");
+			goto fail;
+		}
+
+		begin = Profiler::now();
+
+		result = native_scaler_->scale((const uint8_t * const *) native_frame->data,
+				native_frame->linesize,
+				encoded_frame->data,
+				encoded_frame->linesize);
+
+		if (profiler_)
+			profiler_->record("encode.convert", begin, Profiler::now());
+
+		if (result < 0) {
+			av_log(NULL, AV_LOG_ERROR, "Failed to scale frame\n");
+			goto fail;
+		}
+
+		goto encode;
+	}
+
 	// Use swscale context to convert formats/linesizes
 	input_data = frame->constData();
 	input_linesize = frame->linesizeBytes();
 
-	result = sws_scale(sws_ctx_,
+	begin = Profiler::now();
+
+	result = scaler_->scale(reinterpret_cast<const uint8_t * const *>(&input_data),
 //	result = sws_scale((frame->videoParams().nbChannels() == VideoParams::RGBAChannelCount) ? alpha_sws_ctx_ : noalpha_sws_ctx_,
-			reinterpret_cast<const uint8_t * const *>(&input_data),
 			&input_linesize,
-			0,
-			frame->videoParams().height(),
 			encoded_frame->data,
 			encoded_frame->linesize);
 //printf("linesize = [%d,%d,%d] / dst_linesize = %d / height = %d\n", 
 //		encoded_frame->linesize[0], encoded_frame->linesize[1], encoded_frame->linesize[2], input_linesize, encoded_frame->height);
 
+	if (profiler_)
+		profiler_->record("encode.convert", begin, Profiler::now());
+
 	if (result < 0) {
 		av_log(NULL, AV_LOG_ERROR, "Failed to scale frame\n");
 		goto fail;
 	}
 
+encode:
 	// TODO	
 	encoded_frame->pts = (uint64_t) round(av_q2d(time) / av_q2d(video_codec_->time_base));
 //	encoded_frame->pts = (uint64_t) round(av_q2d(time));
 
 	// If hardware acceleration using
 	if (video_codec_->hw_frames_ctx != NULL) {
-		AVFrame *hw_frame;
+		if ((av_hwframe_get_buffer(video_codec_->hw_frames_ctx, hw_frame_, 0) < 0)
+			|| (av_hwframe_transfer_data(hw_frame_, encoded_frame, 0) < 0)) {
+			av_log(NULL, AV_LOG_ERROR, "Failed to upload frame to the hardware device\n");
+			av_frame_unref(hw_frame_);
+			goto fail;
+		}
 
-		hw_frame = av_frame_alloc();
-		av_hwframe_get_buffer(video_codec_->hw_frames_ctx, hw_frame, 0);
-		av_hwframe_transfer_data(hw_frame, encoded_frame, 0);
-		av_frame_free(&encoded_frame);
+		av_frame_copy_props(hw_frame_, encoded_frame);
+		av_frame_unref(encoded_frame);
 
-		encoded_frame = hw_frame;
+		encoded_frame = hw_frame_;
 	}
 
 	// Write to encoder
 	success = writeAVFrame(encoded_frame, video_codec_, video_stream_);
 
 fail:
-	av_frame_free(&encoded_frame);
+	// Encoder holds its own reference
+	if (encoded_frame != NULL)
+		av_frame_unref(encoded_frame);
 
 	return success;
 }
@@ -639,6 +918,8 @@ fail:
 bool Encoder::writeAVFrame(AVFrame *frame, AVCodecContext *codec_ctx, AVStream *stream) {
 	int result;
 
+	Profiler::Scope scope(profiler_, (stream == video_stream_) ? "encode" : "encode.audio");
+
 	// Send raw frame to the encoder
 	result = avcodec_send_frame(codec_ctx, frame);
 
@@ -647,16 +928,20 @@ bool Encoder::writeAVFrame(AVFrame *frame, AVCodecContext *codec_ctx, AVStream *
 		return false;
 	}
 
-	AVPacket *packet = av_packet_alloc();
-
 	while (result >= 0) {
+		AVPacket *packet = getPacket();
+
 		result = avcodec_receive_packet(codec_ctx, packet);
 
 		// EAGAIN just means the encoder wants another frame before encoding
-		if ((result == AVERROR(EAGAIN)) || (result == AVERROR_EOF))
+		if ((result == AVERROR(EAGAIN)) || (result == AVERROR_EOF)) {
+			releasePacket(packet);
+			result = 0;
 			break;
+		}
 		else if (result < 0) {
 			av_log(NULL, AV_LOG_ERROR, "Failed to receive packet from decoder");
+			releasePacket(packet);
 			break;
 		}
 
@@ -665,15 +950,10 @@ bool Encoder::writeAVFrame(AVFrame *frame, AVCodecContext *codec_ctx, AVStream *
 
         av_packet_rescale_ts(packet, codec_ctx->time_base, stream->time_base);
 
-		// Mux encoded frame
-        av_interleaved_write_frame(fmt_ctx_, packet);
-
-		// Unref packet in case we're getting another
-		av_packet_unref(packet);
+		// Mux encoded frame (mux thread)
+		writePacket(packet);
 	}
 
-	av_packet_free(&packet);
-
-	return (result < 0) ? false : true;
+	return (result < 0) ? false : !mux_failed_;
 }
 
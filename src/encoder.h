@@ -5,6 +5,10 @@
 #include <memory>
 #include <string>
 #include <list>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -16,6 +20,10 @@ extern "C" {
 #include "audioparams.h"
 #include "videoparams.h"
 #include "frame.h"
+#include "framepool.h"
+#include "profiler.h"
+#include "scaler.h"
+#include "workqueue.h"
 
 
 class EncoderSettings {
@@ -82,6 +90,10 @@ public:
 
 	void setAudioBitrate(const int64_t rate);
 
+	// Copy input audio packets (codec parameters of the input stream)
+	const AVCodecParameters * audioCopyParameters(void) const;
+	void setAudioCopy(const AVCodecParameters *codecpar);
+
 private:
 	std::string filename_;
 
@@ -99,9 +111,17 @@ private:
 	AudioParams audio_params_;
 	ExportCodec::Codec audio_codec_;
 	int64_t audio_bit_rate_;
+	const AVCodecParameters *audio_copy_params_;
 };
 
 
+/**
+ * Audio & video encoder
+ *
+ * Encoded packets are written by a mux thread through a bounded queue, so
+ * encoding doesn't wait for the output file I/O. Output frame & packets
+ * are reused from one frame to the next.
+ */
 class Encoder {
 public:
 	virtual ~Encoder();
@@ -110,18 +130,41 @@ public:
 
 	const EncoderSettings& settings() const;
 
+	// Audio packets are copied, not encoded
+	const bool& isAudioCopy(void) const;
+
 	bool open(void);
-	void close(void);
+	// Returns false if the output file isn't complete (mux or trailer failure)
+	bool close(void);
 
 	bool writeAudio(FramePtr frame, AVRational time);
+	bool writeAudioPacket(AVPacket *packet);
 	bool writeFrame(FramePtr frame, AVRational time);
 
+	// Draw encoded frame buffers from a recycling pool
+	void setFramePool(FramePoolPtr pool);
+
+	void setProfiler(Profiler *profiler);
+
+	// Colour conversion threads (0 => auto)
+	void setScaleThreads(int nb_threads);
+
+	// Encoded packets waiting for the mux thread
+	static const size_t MuxQueueSize = 64;
+
 private:
 	Encoder(const EncoderSettings &settings);
 
+	void mux(void);
+
+	AVPacket * getPacket(void);
+	void releasePacket(AVPacket *packet);
+	void writePacket(AVPacket *packet);
+
 	void flush(void);
 	void flush(AVCodecContext *codec_ctx, AVStream *stream);
 
+	bool initializeCopyStream(AVStream **stream_ptr, const AVCodecParameters *codecpar);
 	bool initializeStream(AVMediaType type, AVStream **stream_ptr, AVCodecContext **codec_context_ptr, const ExportCodec::Codec &codec);
 
 	void setRotation(double theta);
@@ -139,13 +182,34 @@ private:
 
 	AVStream *audio_stream_;
 	AVCodecContext *audio_codec_;
+	bool audio_copy_;
 
-	SwsContext *sws_ctx_;
+	Scaler *scaler_;
 	SwsContext *alpha_sws_ctx_;
 	SwsContext *noalpha_sws_ctx_;
+	Scaler *native_scaler_;
+	int scale_threads_;
 	VideoParams::Format video_conversion_fmt_;
 
 	AVBufferRef *hw_device_ctx_;
+
+	// Output frames, buffers unref once sent to the encoder
+	AVFrame *video_frame_;
+	AVFrame *hw_frame_;
+
+	// Mux thread & free packets
+	std::thread *thread_mux_;
+	WorkQueue<AVPacket *> mux_queue_;
+
+	std::mutex packets_mutex_;
+	std::vector<AVPacket *> packets_;
+
+	// Set by the mux thread, next writes fail
+	std::atomic<bool> mux_failed_;
+
+	FramePoolPtr frame_pool_;
+
+	Profiler *profiler_;
 };
 
 #endif
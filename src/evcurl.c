@@ -488,6 +488,10 @@ void evcurl_set_header(evcurl_task_t *evtaskh, const char *header) {
 
 
 int evcurl_cancel(evcurl_task_t *evtaskh) {
+	// Transfer in progress
+	if (evtaskh->is_running)
+		curl_multi_remove_handle(evtaskh->evcurlh->curlmh, evtaskh->curl);
+
 	evcurl_task_delete(evtaskh);
 
 	return 0;
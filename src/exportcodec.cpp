@@ -19,6 +19,14 @@ std::string ExportCodec::getCodecName(Codec codec) {
 		return "NVidia HEVC";
 	case ExportCodec::CodecQSVHEVC:
 		return "Intel QSV HEVC";
+	case ExportCodec::CodecProRes:
+		return "ProRes 4444";
+	case ExportCodec::CodecVP9:
+		return "VP9";
+	case ExportCodec::CodecQTRLE:
+		return "QuickTime Animation";
+	case ExportCodec::CodecPNG:
+		return "PNG";
 	
 	case ExportCodec::CodecAAC:
 		return "AAC";
@@ -31,3 +39,22 @@ std::string ExportCodec::getCodecName(Codec codec) {
 	return "Unknown";
 }
 
+
+
+AVPixelFormat ExportCodec::getAlphaPixelFormat(Codec codec) {
+	switch (codec) {
+	case ExportCodec::CodecProRes:
+		return AV_PIX_FMT_YUVA444P10LE;
+	case ExportCodec::CodecVP9:
+		return AV_PIX_FMT_YUVA420P;
+	case ExportCodec::CodecQTRLE:
+		return AV_PIX_FMT_ARGB;
+	case ExportCodec::CodecPNG:
+		return AV_PIX_FMT_RGBA;
+
+	default:
+		break;
+	}
+
+	return AV_PIX_FMT_NONE;
+}
@@ -24,6 +24,12 @@ public:
 		CodecNVEncHEVC,
 		CodecQSVHEVC,
 
+		// Video codecs with alpha channel
+		CodecProRes,
+		CodecVP9,
+		CodecQTRLE,
+		CodecPNG,
+
 		// Audio codecs
 		CodecAAC,
 
@@ -31,6 +37,9 @@ public:
 	};
 
 	static std::string getCodecName(Codec codec);
+
+	// Pixel format with alpha, AV_PIX_FMT_NONE if codec doesn't support alpha
+	static AVPixelFormat getAlphaPixelFormat(Codec codec);
 };
 
 #endif
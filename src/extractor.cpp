@@ -13,6 +13,7 @@ extern "C" {
 #include "log_i.h"
 #include "utils.h"
 #include "datetime.h"
+#include "ffmpegutils.h"
 #include "extractor.h"
 
 
@@ -67,6 +68,9 @@ Extractor::Extractor(GPXApplication &app, const ExtractorSettings &settings)
 
 	fmt_ctx_ = NULL;
 	avstream_ = NULL;
+
+	entry_ = 0;
+	nb_entries_ = 0;
 }
 
 
@@ -292,6 +296,21 @@ bool Extractor::open(void) {
 		goto done;
 	}
 
+	// MP4 sample table, GPMF samples are read without demuxing the whole file
+	if (stream->index() < (int) fmt_ctx_->nb_streams) {
+		avstream_ = fmt_ctx_->streams[stream->index()];
+
+		entry_ = 0;
+		nb_entries_ = FFmpegUtils::getIndexEntriesCount(avstream_);
+
+		if (nb_entries_ > 0) {
+			log_info("Read GPMF data from the %d samples index", nb_entries_);
+
+			result = true;
+			goto done;
+		}
+	}
+
 	// Get stream information from format
 	if (avformat_find_stream_info(fmt_ctx_, NULL) < 0) {
 		av_log(NULL, AV_LOG_ERROR, "Cannot find stream information\n");
@@ -316,6 +335,42 @@ void Extractor::close(void) {
 }
 
 
+int Extractor::getIndexedPacket(AVPacket *packet) {
+	int result;
+
+	const AVIndexEntry *entry;
+
+	av_packet_unref(packet);
+
+	while (entry_ < nb_entries_) {
+		entry = FFmpegUtils::getIndexEntry(avstream_, entry_++);
+
+		if ((entry == NULL) || (entry->size <= 0) || (entry->flags & AVINDEX_DISCARD_FRAME))
+			continue;
+
+		// Read sample data only
+		if (avio_seek(fmt_ctx_->pb, entry->pos, SEEK_SET) < 0)
+			return AVERROR(EIO);
+
+		if ((result = av_new_packet(packet, entry->size)) < 0)
+			return result;
+
+		if (avio_read(fmt_ctx_->pb, packet->data, entry->size) != entry->size) {
+			av_packet_unref(packet);
+			return AVERROR(EIO);
+		}
+
+		packet->pts = entry->timestamp;
+		packet->dts = entry->timestamp;
+		packet->stream_index = avstream_->index;
+
+		return 0;
+	}
+
+	return AVERROR_EOF;
+}
+
+
 int Extractor::getPacket(AVPacket *packet) {
 	int result = -1;
 
@@ -323,6 +378,10 @@ int Extractor::getPacket(AVPacket *packet) {
 
 	log_call();
 
+	// GPMF samples index
+	if (nb_entries_ > 0)
+		return getIndexedPacket(packet);
+
 	while (!eof) {
 		do {
 			// Free buffer in packet if there is one
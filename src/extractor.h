@@ -103,6 +103,7 @@ public:
 	void close(void);
 
 	int getPacket(AVPacket *packet);
+	int getIndexedPacket(AVPacket *packet);
 
 	void parse(GPMD &gpmd, uint8_t *buffer, size_t size, std::ofstream &out);
 
@@ -116,6 +117,10 @@ protected:
 
 	AVStream *avstream_;
 
+	// Next GPMF sample in the stream index (MP4 sample table)
+	int entry_;
+	int nb_entries_;
+
 	Extractor(GPXApplication &app, const ExtractorSettings &settings);
 
 	void init(MediaContainer *container);
@@ -1,3 +1,6 @@
+#include <cstring>
+
+#include "log_i.h"
 #include "ffmpegutils.h"
 
 
@@ -17,6 +20,14 @@ const AVCodec * FFmpegUtils::getEncoder(ExportCodec::Codec codec) {
 		return avcodec_find_encoder_by_name("hevc_nvenc");
 	case ExportCodec::CodecQSVHEVC:
 		return avcodec_find_encoder_by_name("hevc_qsv");
+	case ExportCodec::CodecProRes:
+		return avcodec_find_encoder_by_name("prores_ks");
+	case ExportCodec::CodecVP9:
+		return avcodec_find_encoder_by_name("libvpx-vp9");
+	case ExportCodec::CodecQTRLE:
+		return avcodec_find_encoder(AV_CODEC_ID_QTRLE);
+	case ExportCodec::CodecPNG:
+		return avcodec_find_encoder(AV_CODEC_ID_PNG);
 	
 	case ExportCodec::CodecAAC:
 		return avcodec_find_encoder(AV_CODEC_ID_AAC);
@@ -174,3 +185,158 @@ uint8_t *FFmpegUtils::getSideData(AVStream* stream, enum AVPacketSideDataType ty
 #endif
 }
 
+
+int FFmpegUtils::getIndexEntriesCount(AVStream* stream) {
+#ifdef HAVE_FFMPEG_INDEX_ENTRY
+	return avformat_index_get_entries_count(stream);
+#else
+	return stream->nb_index_entries;
+#endif
+}
+
+
+const AVIndexEntry *FFmpegUtils::getIndexEntry(AVStream* stream, int index) {
+#ifdef HAVE_FFMPEG_INDEX_ENTRY
+	return avformat_index_get_entry(stream, index);
+#else
+	if ((index < 0) || (index >= stream->nb_index_entries))
+		return NULL;
+
+	return &stream->index_entries[index];
+#endif
+}
+
+
+
+/**
+ * Concat media files with the same streams layout (stream copy)
+ *
+ * Packets keep their timestamps, so segments rendered from the same source
+ * are joined as is. Overlapping packets (audio frames around the split
+ * points) are dropped.
+ */
+bool FFmpegUtils::concat(const std::vector<std::string> &inputs, const std::string &output) {
+	bool success = false;
+
+	AVPacket *packet = NULL;
+
+	AVFormatContext *ifmt_ctx = NULL;
+	AVFormatContext *ofmt_ctx = NULL;
+
+	std::vector<int64_t> last_dts;
+
+	if (inputs.empty())
+		goto fail;
+
+	if (avformat_alloc_output_context2(&ofmt_ctx, NULL, NULL, output.c_str()) < 0) {
+		log_error("Failed to allocate '%s' output context", output.c_str());
+		goto fail;
+	}
+
+	packet = av_packet_alloc();
+
+	for (size_t i=0; i<inputs.size(); i++) {
+		if (avformat_open_input(&ifmt_ctx, inputs[i].c_str(), NULL, NULL) < 0) {
+			log_error("Cannot open '%s' segment file", inputs[i].c_str());
+			goto fail;
+		}
+
+		if (avformat_find_stream_info(ifmt_ctx, NULL) < 0) {
+			log_error("Cannot find '%s' stream information", inputs[i].c_str());
+			goto fail;
+		}
+
+		if (i == 0) {
+			// Output streams from the first segment
+			for (unsigned int j=0; j<ifmt_ctx->nb_streams; j++) {
+				AVStream *in = ifmt_ctx->streams[j];
+				AVStream *out = avformat_new_stream(ofmt_ctx, NULL);
+
+				if (out == NULL)
+					goto fail;
+
+				if (avcodec_parameters_copy(out->codecpar, in->codecpar) < 0)
+					goto fail;
+
+				out->codecpar->codec_tag = 0;
+				out->time_base = in->time_base;
+
+				av_dict_copy(&out->metadata, in->metadata, 0);
+
+#ifndef HAVE_FFMPEG_API_SIDE_DATA
+				// Keep rotation
+				uint8_t *matrix = getSideData(in, AV_PKT_DATA_DISPLAYMATRIX);
+
+				if (matrix != NULL)
+					memcpy(newSideData(out, AV_PKT_DATA_DISPLAYMATRIX, sizeof(int32_t) * 9), matrix, sizeof(int32_t) * 9);
+#endif
+			}
+
+			last_dts.assign(ofmt_ctx->nb_streams, AV_NOPTS_VALUE);
+
+			if (!(ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+				if (avio_open(&ofmt_ctx->pb, output.c_str(), AVIO_FLAG_WRITE) < 0) {
+					log_error("Could not open output file '%s'", output.c_str());
+					goto fail;
+				}
+			}
+
+			if (avformat_write_header(ofmt_ctx, NULL) < 0) {
+				log_error("Error occurred when opening output file '%s'", output.c_str());
+				goto fail;
+			}
+		}
+		else if (ifmt_ctx->nb_streams != ofmt_ctx->nb_streams) {
+			log_error("Segment '%s' streams mismatch", inputs[i].c_str());
+			goto fail;
+		}
+
+		while (av_read_frame(ifmt_ctx, packet) >= 0) {
+			int index = packet->stream_index;
+
+			AVStream *in = ifmt_ctx->streams[index];
+			AVStream *out = ofmt_ctx->streams[index];
+
+			av_packet_rescale_ts(packet, in->time_base, out->time_base);
+			packet->pos = -1;
+
+			// Segments overlap
+			if ((packet->dts != AV_NOPTS_VALUE) && (last_dts[index] != AV_NOPTS_VALUE)
+				&& (packet->dts <= last_dts[index])
+				&& (out->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)) {
+				av_packet_unref(packet);
+				continue;
+			}
+
+			if (packet->dts != AV_NOPTS_VALUE)
+				last_dts[index] = packet->dts;
+
+			if (av_interleaved_write_frame(ofmt_ctx, packet) < 0) {
+				log_error("Failed to write '%s' packet", output.c_str());
+				goto fail;
+			}
+		}
+
+		avformat_close_input(&ifmt_ctx);
+	}
+
+	av_write_trailer(ofmt_ctx);
+
+	success = true;
+
+fail:
+	if (packet)
+		av_packet_free(&packet);
+
+	if (ifmt_ctx)
+		avformat_close_input(&ifmt_ctx);
+
+	if (ofmt_ctx) {
+		if (!(ofmt_ctx->oformat->flags & AVFMT_NOFILE) && ofmt_ctx->pb)
+			avio_closep(&ofmt_ctx->pb);
+
+		avformat_free_context(ofmt_ctx);
+	}
+
+	return success;
+}
@@ -32,6 +32,10 @@ extern "C" {
 #define HAVE_FFMPEG_API_SIDE_DATA
 #endif
 
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 78, 100)
+#define HAVE_FFMPEG_INDEX_ENTRY
+#endif
+
 
 class FFmpegUtils {
 public:
@@ -47,6 +51,12 @@ public:
 
 	static uint8_t *newSideData(AVStream* stream, enum AVPacketSideDataType type, size_t size);
 	static uint8_t *getSideData(AVStream* stream, enum AVPacketSideDataType type);
+
+	// Stream samples index (ie: MP4 sample table)
+	static int getIndexEntriesCount(AVStream* stream);
+	static const AVIndexEntry *getIndexEntry(AVStream* stream, int index);
+
+	static bool concat(const std::vector<std::string> &inputs, const std::string &output);
 };
 
 #endif
@@ -11,13 +11,21 @@
 
 
 Frame::Frame() :
-	data_(NULL) {
+	allocated_(false),
+	data_(NULL),
+	size_(0),
+	avframe_(NULL) {
 }
 
 
 Frame::~Frame() {
-	if (allocated_ && (data_ != NULL))
+	if (pool_ != NULL)
+		pool_->release(data_, size_);
+	else if (allocated_ && (data_ != NULL))
 		free(data_);
+
+	if (avframe_ != NULL)
+		av_frame_free(&avframe_);
 }
 
 
@@ -86,20 +94,58 @@ const uint8_t * Frame::constData(void) const {
 void Frame::setData(uint8_t *data, bool allocated) {
 	data_ = data;
 	allocated_ = allocated;
+
+	pool_ = NULL;
+	size_ = 0;
+}
+
+
+void Frame::setData(uint8_t *data, FramePoolPtr pool, size_t size) {
+	data_ = data;
+	allocated_ = true;
+
+	pool_ = pool;
+	size_ = size;
+}
+
+
+AVFrame * Frame::avFrame(void) const {
+	return avframe_;
+}
+
+
+void Frame::setAVFrame(AVFrame *frame) {
+	if (avframe_ != NULL)
+		av_frame_free(&avframe_);
+
+	avframe_ = frame;
 }
 
 
 OIIO::ImageBuf Frame::toImageBuf(void) const {
-	// OIIO Convert frame to imagebuf
-	OIIO::ImageBuf buffer(OIIO::ImageSpec(this->width(), this->height(), 
-		this->nbChannels(), OIIOUtils::getOIIOBaseTypeFromFormat(this->format())));
+	OIIO::ImageSpec spec(this->width(), this->height(), 
+		this->nbChannels(), OIIOUtils::getOIIOBaseTypeFromFormat(this->format()));
+
+	// Wrap frame data (no copy), imagebuf doesn't own the buffer
+#if OIIO_VERSION >= OIIO_MAKE_VERSION(2,3,0)
+	return OIIO::ImageBuf(spec, data_, OIIO::AutoStride, this->linesizeBytes());
+#else
+	if ((OIIO::stride_t) spec.scanline_bytes() == this->linesizeBytes())
+		return OIIO::ImageBuf(spec, data_);
+
+	// Padded lines, fallback to a copy
+	OIIO::ImageBuf buffer(spec);
 	OIIOUtils::frameToBuffer(this, &buffer);
 
 	return buffer;
+#endif
 }
 
 
 void Frame::fromImageBuf(OIIO::ImageBuf &buffer) {
+	// Nothing to do if buffer wraps frame data
+	if (buffer.localpixels() == data_)
+		return;
+
 	OIIOUtils::bufferToFrame(&buffer, this);
 }
-
@@ -15,6 +15,7 @@ extern "C" {
 #include <OpenImageIO/imagebufalgo.h>
 
 #include "videoparams.h"
+#include "framepool.h"
 
 
 class Frame;
@@ -29,6 +30,7 @@ public:
 
 	static FramePtr create(void);
 
+	// Returned imagebuf wraps frame data, frame must outlive it
 	OIIO::ImageBuf toImageBuf(void) const;
 	void fromImageBuf(OIIO::ImageBuf &buffer);
 
@@ -70,6 +72,13 @@ public:
 
 	void setData(uint8_t *data, bool allocated=true);
 
+	// Buffer returned to the pool as the frame is released
+	void setData(uint8_t *data, FramePoolPtr pool, size_t size);
+
+	// Native decoded frame (YUV compositing), owned by the frame
+	AVFrame * avFrame(void) const;
+	void setAVFrame(AVFrame *frame);
+
 	int index_;
 
 private:
@@ -83,6 +92,11 @@ private:
 
 	bool allocated_;
 	uint8_t *data_;
+
+	FramePoolPtr pool_;
+	size_t size_;
+
+	AVFrame *avframe_;
 };
 
 #endif
@@ -0,0 +1,148 @@
+#include <iostream>
+#include <memory>
+#include <cstdlib>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+#include "log_i.h"
+#include "framepool.h"
+
+
+class FramePoolSlab {
+public:
+	FramePoolPtr pool;
+	size_t size;
+};
+
+
+FramePool::FramePool(size_t capacity)
+	: capacity_(capacity)
+	, nb_hits_(0)
+	, nb_misses_(0)
+	, nb_bytes_(0) {
+}
+
+
+FramePool::~FramePool() {
+	for (auto &it : buffers_) {
+		for (uint8_t *data : it.second)
+			free(data);
+	}
+
+	buffers_.clear();
+}
+
+
+FramePoolPtr FramePool::create(size_t capacity) {
+	FramePoolPtr pool;
+
+	pool = std::make_shared<FramePool>(capacity);
+
+	return pool;
+}
+
+
+void FramePool::setCapacity(size_t capacity) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	capacity_ = capacity;
+}
+
+
+uint8_t * FramePool::acquire(size_t size) {
+	void *data = NULL;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		std::vector<uint8_t *> &buffers = buffers_[size];
+
+		if (!buffers.empty()) {
+			data = buffers.back();
+			buffers.pop_back();
+
+			nb_hits_++;
+
+			return (uint8_t *) data;
+		}
+
+		nb_misses_++;
+		nb_bytes_ += size;
+	}
+
+	// Released with free() if not recycled
+	if (posix_memalign(&data, Alignment, size) != 0) {
+		log_error("Frame pool fails to allocate %lu bytes", size);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		nb_bytes_ -= size;
+
+		return NULL;
+	}
+
+	return (uint8_t *) data;
+}
+
+
+void FramePool::release(uint8_t *data, size_t size) {
+	if (data == NULL)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		std::vector<uint8_t *> &buffers = buffers_[size];
+
+		if (buffers.size() < capacity_) {
+			buffers.push_back(data);
+			return;
+		}
+
+		nb_bytes_ -= size;
+	}
+
+	free(data);
+}
+
+
+int FramePool::getBuffer(AVFrame *frame) {
+	int size;
+
+	uint8_t *data;
+
+	FramePoolSlab *slab;
+
+	size = av_image_get_buffer_size((AVPixelFormat) frame->format, frame->width, frame->height, Alignment);
+
+	if (size < 0)
+		return size;
+
+	if ((data = acquire(size)) == NULL)
+		return AVERROR(ENOMEM);
+
+	slab = new FramePoolSlab();
+	slab->pool = shared_from_this();
+	slab->size = size;
+
+	frame->buf[0] = av_buffer_create(data, size, FramePool::freeBuffer, slab, 0);
+
+	if (frame->buf[0] == NULL) {
+		release(data, size);
+		delete slab;
+		return AVERROR(ENOMEM);
+	}
+
+	return av_image_fill_arrays(frame->data, frame->linesize, data,
+		(AVPixelFormat) frame->format, frame->width, frame->height, Alignment);
+}
+
+
+void FramePool::freeBuffer(void *opaque, uint8_t *data) {
+	FramePoolSlab *slab = (FramePoolSlab *) opaque;
+
+	slab->pool->release(data, slab->size);
+
+	delete slab;
+}
@@ -0,0 +1,72 @@
+#ifndef __GPX2VIDEO__FRAMEPOOL_H__
+#define __GPX2VIDEO__FRAMEPOOL_H__
+
+#include <map>
+#include <vector>
+#include <mutex>
+#include <memory>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/buffer.h>
+}
+
+
+class FramePool;
+
+using FramePoolPtr = std::shared_ptr<FramePool>;
+
+
+/**
+ * Recycling frame buffer pool
+ *
+ * Frame buffers are aligned slabs, keyed on their size (width x height x
+ * pixel format). Released buffers are kept for the next frames, up to
+ * 'capacity' free buffers per size.
+ */
+class FramePool : public std::enable_shared_from_this<FramePool> {
+public:
+	FramePool(size_t capacity);
+	virtual ~FramePool();
+
+	static FramePoolPtr create(size_t capacity=8);
+
+	void setCapacity(size_t capacity);
+
+	uint8_t * acquire(size_t size);
+	void release(uint8_t *data, size_t size);
+
+	// Allocate AVFrame planes (format, width & height set), buffer comes
+	// back to the pool when the last reference is dropped
+	int getBuffer(AVFrame *frame);
+
+	uint64_t hits(void) const {
+		return nb_hits_;
+	}
+
+	uint64_t misses(void) const {
+		return nb_misses_;
+	}
+
+	// Allocated memory, used & free buffers
+	size_t size(void) const {
+		return nb_bytes_;
+	}
+
+	static const size_t Alignment = 64;
+
+private:
+	static void freeBuffer(void *opaque, uint8_t *data);
+
+	std::mutex mutex_;
+
+	size_t capacity_;
+
+	std::map<size_t, std::vector<uint8_t *> > buffers_;
+
+	uint64_t nb_hits_;
+	uint64_t nb_misses_;
+	size_t nb_bytes_;
+};
+
+#endif
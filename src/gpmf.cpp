@@ -6,12 +6,17 @@
 #include <byteswap.h>
 
 #include "log_i.h"
+#include "ffmpegutils.h"
 #include "gpmf.h"
 #include "datetime.h"
 
 
 GPMFDecoder::GPMFDecoder()
-	: fmt_ctx_(NULL) {
+	: demuxer_(NULL)
+	, avstream_(NULL)
+	, is_indexed_(false)
+	, entry_(0)
+	, nb_entries_(0) {
 	n_ = -1;
 	pts_ = 0;
 }
@@ -30,35 +35,43 @@ GPMFDecoder * GPMFDecoder::create(void) {
 
 
 bool GPMFDecoder::open(StreamPtr stream) {
+	// Packets are read once for all the container streams
+	return open(stream, stream->container()->demuxer());
+}
+
+
+bool GPMFDecoder::open(StreamPtr stream, Demuxer *demuxer, bool indexed) {
 	bool result;
 
 	// Set stream
 	stream_ = stream;
 
+	if ((demuxer_ = demuxer) == NULL)
+		return false;
+
+	is_indexed_ = indexed;
+
 	// Try to open
-	if ((result = open(stream->container()->filename(), stream->index())) == false)
+	if ((result = open(stream->index())) == false)
 		return false;
 
 	return true;
 }
 
 
-bool GPMFDecoder::open(const std::string &filename, const int &index) {
-	int result;
-
-	if ((result = avformat_open_input(&fmt_ctx_, filename.c_str(), NULL, NULL)) < 0) {
-		av_log(NULL, AV_LOG_ERROR, "Cannot open input file '%s'", filename.c_str());
+bool GPMFDecoder::open(const int &index) {
+	// Get reference to correct AVStream
+	if ((avstream_ = demuxer_->stream(index)) == NULL)
 		return false;
-	}
 
-	// Get stream information from format
-	if ((result = avformat_find_stream_info(fmt_ctx_, NULL)) < 0) {
-		av_log(NULL, AV_LOG_ERROR, "Cannot find stream information\n");
-		return false;
-	}
+	demuxer_->attach(index);
 
-	// Get reference to correct AVStream
-	avstream_ = fmt_ctx_->streams[index];
+	// MP4 sample table, GPMF samples are read without demuxing the whole file
+	entry_ = 0;
+	nb_entries_ = is_indexed_ ? FFmpegUtils::getIndexEntriesCount(avstream_) : 0;
+
+	if (nb_entries_ > 0)
+		log_info("Read GPMF data from the %d samples index", nb_entries_);
 
 	// Get first packet
 	AVRational null = av_make_q(0, 1);
@@ -69,18 +82,56 @@ bool GPMFDecoder::open(const std::string &filename, const int &index) {
 }
 
 
+int GPMFDecoder::getIndexedPacket(AVPacket *packet) {
+	int result;
+
+	const AVIndexEntry *entry;
+
+	AVIOContext *pb = demuxer_->context()->pb;
+
+	av_packet_unref(packet);
+
+	while (entry_ < nb_entries_) {
+		entry = FFmpegUtils::getIndexEntry(avstream_, entry_++);
+
+		if ((entry == NULL) || (entry->size <= 0) || (entry->flags & AVINDEX_DISCARD_FRAME))
+			continue;
+
+		// Read sample data only
+		if (avio_seek(pb, entry->pos, SEEK_SET) < 0)
+			return AVERROR(EIO);
+
+		if ((result = av_new_packet(packet, entry->size)) < 0)
+			return result;
+
+		if (avio_read(pb, packet->data, entry->size) != entry->size) {
+			av_packet_unref(packet);
+			return AVERROR(EIO);
+		}
+
+		packet->pts = entry->timestamp;
+		packet->dts = entry->timestamp;
+		packet->stream_index = avstream_->index;
+
+		return 0;
+	}
+
+	return AVERROR_EOF;
+}
+
+
 int GPMFDecoder::getPacket(AVPacket *packet) {
 	int result = -1;
 
 	bool eof = false;
 
+	// GPMF samples index
+	if (nb_entries_ > 0)
+		return getIndexedPacket(packet);
+
 	while (!eof) {
-		do {
-			// Free buffer in packet if there is one
-			av_packet_unref(packet);
-		
-			result = av_read_frame(fmt_ctx_, packet);
-		} while (packet->stream_index != avstream_->index && result >= 0);
+		// Read packet of the GPMF stream (others are queued)
+		result = demuxer_->read(avstream_->index, packet);
 
 		if (result == AVERROR_EOF) {
 			// Don't break so that receive gets called again, but don't try to read again
@@ -102,13 +153,38 @@ int GPMFDecoder::getPacket(AVPacket *packet) {
 
 
 void GPMFDecoder::close(void) {
-	if (fmt_ctx_) {
-		avformat_close_input(&fmt_ctx_);
-		fmt_ctx_ = NULL;
+	if (demuxer_) {
+		if (avstream_)
+			demuxer_->detach(avstream_->index);
+
+		demuxer_ = NULL;
 	}
 }
 
 
+int GPMFDecoder::seek(int64_t target_ts) {
+	int result = 0;
+
+	AVRational null = av_make_q(0, 1);
+
+	int64_t seek_ts = av_rescale_q(target_ts, AV_TIME_BASE_Q, avstream_->time_base);
+
+	if (nb_entries_ > 0)
+		entry_ = std::max(0, av_index_search_timestamp(avstream_, seek_ts, AVSEEK_FLAG_BACKWARD));
+	else
+		result = demuxer_->seek(avstream_->index, seek_ts);
+
+	// Prime from the sample at the seek point, else the first time factor
+	// would be computed from the file start
+	pts_ = 0;
+	next_data_ = GPMFData();
+
+	retrieveData(next_data_, null);
+
+	return result;
+}
+
+
 bool GPMFDecoder::retrieveData(GPMFData &data, AVRational timecode) {
 	bool eof;
 
@@ -114,9 +114,15 @@ public:
 	static GPMFDecoder * create(void);
 
 	bool open(StreamPtr stream);
+	// Indexed: samples read from the container index, demuxer of its own only
+	// (file position is moved)
+	bool open(StreamPtr stream, Demuxer *demuxer, bool indexed=false);
 	int getPacket(AVPacket *packet);
 	void close(void);
 
+	// Seek (AV_TIME_BASE units), next data is read from the seek point
+	int seek(int64_t target_ts);
+
 	bool retrieveData(GPMFData &data, AVRational timecode);
 	AVPacket * retrievePacketData(const int64_t& target_ts, bool& eof);
 	bool parseData(GPMFData &data, uint8_t *buffer, size_t size);
@@ -126,17 +132,24 @@ protected:
 		return stream_;
 	}
 
-	bool open(const std::string &filename, const int &index);
+	bool open(const int &index);
+	int getIndexedPacket(AVPacket *packet);
 
 private:
 	GPMFDecoder();
 
 	StreamPtr stream_;
 
-	AVFormatContext *fmt_ctx_;
+	// Container demuxer (shared)
+	Demuxer *demuxer_;
 
 	AVStream *avstream_;
 
+	// Container index reading
+	bool is_indexed_;
+	int entry_;
+	int nb_entries_;
+
 	uint64_t n_;
 	int64_t pts_;
 
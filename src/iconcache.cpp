@@ -0,0 +1,276 @@
+#include <iostream>
+#include <cmath>
+
+#include "log_i.h"
+#include "iconcache.h"
+
+
+std::mutex IconCache::mutex_;
+
+std::map<std::string, RsvgHandle *> IconCache::handles_;
+
+std::map<std::string, IconCache::Icon> IconCache::icons_;
+std::list<std::string> IconCache::lru_;
+size_t IconCache::size_ = 0;
+
+uint64_t IconCache::nb_hits_ = 0;
+uint64_t IconCache::nb_misses_ = 0;
+
+
+RsvgHandle * IconCache::handle(const std::string &filename) {
+	GError *error = NULL;
+
+	RsvgHandle *handle;
+
+	auto it = handles_.find(filename);
+
+	if (it != handles_.end())
+		return it->second;
+
+	// load svg data
+	handle = rsvg_handle_new_from_file(filename.c_str(), &error);
+
+	if (!handle) {
+		log_error("Load svg image '%s' error: %s",
+				filename.c_str(),
+				error ? error->message : "unknown error");
+
+		if (error)
+			g_error_free(error);
+	}
+
+	// Failures aren't loaded again
+	handles_[filename] = handle;
+
+	return handle;
+}
+
+
+bool IconCache::size(const std::string &filename, double &width, double &height) {
+	RsvgHandle *handle;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if ((handle = IconCache::handle(filename)) == NULL)
+		return false;
+
+	// svg dimensions
+	rsvg_handle_get_intrinsic_size_in_pixels(handle, &width, &height);
+
+	return true;
+}
+
+
+cairo_surface_t * IconCache::render(RsvgHandle *handle, int width, int height,
+		double iwidth, double iheight, const float *fill, double angle, double dx, double dy) {
+	GError *error = NULL;
+
+	cairo_t *cr = NULL;
+	cairo_t *mask = NULL;
+	cairo_surface_t *surface = NULL;
+	cairo_surface_t *masksurface = NULL;
+
+	RsvgRectangle viewport;
+
+	// Create cairo surface (ARGB32)
+	surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+
+	cr = cairo_create(surface);
+
+	if (fill != NULL) {
+		// Create cairo alpha only surface
+		masksurface = cairo_image_surface_create(CAIRO_FORMAT_A8, width, height);
+
+		mask = cairo_create(masksurface);
+	}
+
+	// Rotate around the icon center
+	if (angle != 0.0) {
+		cairo_t *target = (mask != NULL) ? mask : cr;
+
+		cairo_translate(target, width / 2.0, height / 2.0);
+		cairo_rotate(target, angle * M_PI / 180.0);
+		cairo_translate(target, -iwidth / 2.0, -iheight / 2.0);
+
+		dx = 0.0;
+		dy = 0.0;
+	}
+
+	// Render svg into cairo surface
+	viewport = (RsvgRectangle) {
+		.x = dx,
+		.y = dy,
+		.width = iwidth,
+		.height = iheight
+	};
+
+	if (!rsvg_handle_render_document(handle, (mask != NULL) ? mask : cr, &viewport, &error)) {
+		log_error("Render svg error: %s", error ? error->message : "unknown error");
+
+		if (error)
+			g_error_free(error);
+	}
+
+	if (fill != NULL) {
+		// Apply color
+		cairo_set_source_rgba(cr, fill[0], fill[1], fill[2], fill[3]);
+
+		// Paint mask
+		cairo_mask_surface(cr, masksurface, 0, 0);
+	}
+
+	cairo_surface_flush(surface);
+
+	// Free
+	if (mask)
+		cairo_destroy(mask);
+	if (masksurface)
+		cairo_surface_destroy(masksurface);
+	if (cr)
+		cairo_destroy(cr);
+
+	return surface;
+}
+
+
+cairo_surface_t * IconCache::surface(const std::string &filename, double width, double height,
+		const float *fill, double angle, double dx, double dy) {
+	int w, h;
+
+	char key[512];
+	char color[64];
+
+	Icon icon;
+
+	RsvgHandle *handle;
+
+	if (filename.empty() || (width <= 0) || (height <= 0))
+		return NULL;
+
+	// Transparent color means no color
+	if ((fill != NULL) && (fill[3] == 0))
+		fill = NULL;
+
+	// Rotation per degree, position per 1/4 pixel
+	angle = fmod(round(angle), 360.0);
+	dx = round(dx * 4.0) / 4.0;
+	dy = round(dy * 4.0) / 4.0;
+
+	if (fill != NULL)
+		snprintf(color, sizeof(color), "%.3f,%.3f,%.3f,%.3f", fill[0], fill[1], fill[2], fill[3]);
+	else
+		snprintf(color, sizeof(color), "none");
+
+	snprintf(key, sizeof(key), "%s|%.3fx%.3f|%s|%.0f|%.2f,%.2f", filename.c_str(), width, height, color, angle, dx, dy);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto it = icons_.find(key);
+
+	if (it != icons_.end()) {
+		nb_hits_++;
+
+		// Most recently used
+		lru_.splice(lru_.begin(), lru_, it->second.lru);
+
+		return cairo_surface_reference(it->second.surface);
+	}
+
+	nb_misses_++;
+
+	if ((handle = IconCache::handle(filename)) == NULL)
+		return NULL;
+
+	// Icon bounding box
+	if (angle != 0.0) {
+		double c = fabs(cos(angle * M_PI / 180.0));
+		double s = fabs(sin(angle * M_PI / 180.0));
+
+		w = ceil(width * c + height * s);
+		h = ceil(width * s + height * c);
+	}
+	else {
+		w = ceil(dx + width);
+		h = ceil(dy + height);
+	}
+
+	icon.surface = render(handle, w, h, width, height, fill, angle, dx, dy);
+	icon.size = w * h * 4;
+
+	// Drop least recently used icons
+	while (!lru_.empty() && (size_ + icon.size > CacheSize)) {
+		auto last = icons_.find(lru_.back());
+
+		size_ -= last->second.size;
+		cairo_surface_destroy(last->second.surface);
+
+		icons_.erase(last);
+		lru_.pop_back();
+	}
+
+	lru_.push_front(key);
+	icon.lru = lru_.begin();
+
+	size_ += icon.size;
+
+	icons_[key] = icon;
+
+	return cairo_surface_reference(icon.surface);
+}
+
+
+bool IconCache::draw(cairo_t *cr, const std::string &filename, double x, double y, double width, double height,
+		const float *fill) {
+	double ix = floor(x);
+	double iy = floor(y);
+
+	cairo_surface_t *surface;
+
+	// Icon is rendered at the sub-pixel position, then blitted
+	surface = IconCache::surface(filename, width, height, fill, 0.0, x - ix, y - iy);
+
+	if (surface == NULL)
+		return false;
+
+	cairo_save(cr);
+	cairo_set_source_surface(cr, surface, ix, iy);
+	cairo_paint(cr);
+	cairo_restore(cr);
+
+	cairo_surface_destroy(surface);
+
+	return true;
+}
+
+
+uint64_t IconCache::hits(void) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	return nb_hits_;
+}
+
+
+uint64_t IconCache::misses(void) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	return nb_misses_;
+}
+
+
+void IconCache::clear(void) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	for (auto &it : icons_)
+		cairo_surface_destroy(it.second.surface);
+
+	for (auto &it : handles_) {
+		if (it.second != NULL)
+			g_object_unref(it.second);
+	}
+
+	icons_.clear();
+	handles_.clear();
+	lru_.clear();
+
+	size_ = 0;
+}
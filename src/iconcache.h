@@ -0,0 +1,70 @@
+#ifndef __GPX2VIDEO__ICONCACHE_H__
+#define __GPX2VIDEO__ICONCACHE_H__
+
+#include <map>
+#include <list>
+#include <mutex>
+#include <string>
+#include <cstdint>
+
+#include <cairo.h>
+#include <librsvg/rsvg.h>
+
+
+/**
+ * Process wide SVG icon cache
+ *
+ * SVG documents are parsed once per file. Rasterized icons (ARGB32
+ * premultiplied, fill color applied) are kept per file, size, color,
+ * sub-pixel position & rotation, so drawing an icon is a blit.
+ */
+class IconCache {
+public:
+	// Intrinsic SVG size in pixels
+	static bool size(const std::string &filename, double &width, double &height);
+
+	// Rasterized icon, caller releases it with cairo_surface_destroy
+	static cairo_surface_t * surface(const std::string &filename, double width, double height,
+			const float *fill=NULL, double angle=0.0, double dx=0.0, double dy=0.0);
+
+	// Draw icon at x, y (top left corner), same result as rendering
+	// the SVG document in the viewport (x, y, width, height)
+	static bool draw(cairo_t *cr, const std::string &filename, double x, double y, double width, double height,
+			const float *fill=NULL);
+
+	static uint64_t hits(void);
+	static uint64_t misses(void);
+
+	static void clear(void);
+
+	// Budget of rasterized icons
+	static const size_t CacheSize = 32 * 1024 * 1024;
+
+private:
+	class Icon {
+	public:
+		cairo_surface_t *surface;
+
+		size_t size;
+
+		std::list<std::string>::iterator lru;
+	};
+
+	static RsvgHandle * handle(const std::string &filename);
+
+	static cairo_surface_t * render(RsvgHandle *handle, int width, int height,
+			double iwidth, double iheight, const float *fill, double angle, double dx, double dy);
+
+	static std::mutex mutex_;
+
+	static std::map<std::string, RsvgHandle *> handles_;
+
+	static std::map<std::string, Icon> icons_;
+	static std::list<std::string> lru_;
+	static size_t size_;
+
+	static uint64_t nb_hits_;
+	static uint64_t nb_misses_;
+};
+
+#endif
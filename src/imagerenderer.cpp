@@ -6,6 +6,7 @@
 #include <OpenImageIO/imagebufalgo.h>
 
 #include "log_i.h"
+#include "blend.h"
 #include "macros.h"
 #include "datetime.h"
 #include "oiioutils.h"
@@ -220,7 +221,7 @@ bool ImageRenderer::run(void) {
 		// Image over
 		buf->specmod().x = widget->x();
 		buf->specmod().y = widget->y();
-		OIIO::ImageBufAlgo::over(image_buffer, *buf, image_buffer, buf->roi());
+		Blend::over(image_buffer, *buf, buf->roi());
 	}
 
 	// Write image file
@@ -4,11 +4,16 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <climits>
+#include <chrono>
 #include <locale>
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <strings.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <utime.h>
 #include <math.h>
 
 #include <OpenImageIO/imageio.h>
@@ -17,10 +22,13 @@
 
 #include <cairo.h>
 
+#include "blend.h"
+#include "cache.h"
 #include "utils.h"
 #include "log_i.h"
 #include "evcurl.h"
 #include "oiioutils.h"
+#include "tilestore.h"
 #include "videoparams.h"
 #include "telemetrymedia.h"
 #include "map.h"
@@ -45,6 +53,12 @@
 #define URI_MARKER_R    "#R"
 
 
+// Monotonic time in us
+static int64_t monotonic(void) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 
 MapSettings::MapSettings() 
 	: TrackSettings() {
@@ -53,6 +67,11 @@ MapSettings::MapSettings()
 	divider_ = 2.0;
 
 	source_ = MapSettings::SourceNull;
+
+	download_connections_ = 4;
+	download_rate_ = 10;
+
+	uri_ = "";
 }
 
 
@@ -70,6 +89,36 @@ void MapSettings::setSource(const MapSettings::Source &source) {
 }
 
 
+const int& MapSettings::downloadConnections(void) const {
+	return download_connections_;
+}
+
+
+void MapSettings::setDownloadConnections(const int &connections) {
+	download_connections_ = connections;
+}
+
+
+const int& MapSettings::downloadRate(void) const {
+	return download_rate_;
+}
+
+
+void MapSettings::setDownloadRate(const int &rate) {
+	download_rate_ = rate;
+}
+
+
+const std::string& MapSettings::uri(void) const {
+	return uri_;
+}
+
+
+void MapSettings::setURI(const std::string &uri) {
+	uri_ = uri;
+}
+
+
 const std::string MapSettings::getFriendlyName(const MapSettings::Source &source) {
 	switch (source) {
 	case MapSettings::SourceNull:
@@ -266,34 +315,42 @@ Map::Map(GPXApplication &app, const MapSettings &map_settings, TelemetrySource *
 
 	bg_buf_ = NULL;
 	fg_buf_ = NULL;
-	mapbuf_ = NULL;
 
-	filename_ = "";
+	is_built_ = false;
+	is_loaded_ = false;
+
+	surface_width_ = surface_height_ = 0;
+	surface_size_ = 0;
 
 	refresh_is_required_ = false;
 
+	nbr_running_ = 0;
+	last_request_ = 0;
+	timer_ = NULL;
+
 	evcurl_ = EVCurl::init(evbase);
-	
-	evcurl_->setOption(CURLMOPT_MAXCONNECTS, 1);
-	evcurl_->setOption(CURLMOPT_MAX_HOST_CONNECTIONS, 1);
-	evcurl_->setOption(CURLMOPT_MAX_PIPELINE_LENGTH, 1);
+
+	// Parallel downloads, HTTP/2 requests share the same connection
+	evcurl_->setOption(CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	evcurl_->setOption(CURLMOPT_MAXCONNECTS, (long) std::max(1, settings().downloadConnections()));
+	evcurl_->setOption(CURLMOPT_MAX_HOST_CONNECTIONS, (long) std::max(1, settings().downloadConnections()));
 }
 
 
 Map::~Map() {
 	log_call();
 
-	if (filename_ != "")
-		::unlink(filename_.c_str());
-
 	while (!tiles_.empty()) {
 		Tile *tile = tiles_.front();
 		tiles_.pop_front();
 		delete tile;
 	}
 
-	if (mapbuf_ != NULL)
-		delete mapbuf_;
+	clearSurface();
+
+	if (timer_ != NULL)
+		event_free(timer_);
+
 	if (bg_buf_)
 		delete bg_buf_;
 	if (fg_buf_)
@@ -344,6 +401,18 @@ std::string Map::buildURI(int zoom, int x, int y) {
 
 	log_call();
 
+	// Tiles server override, a base URL or a template with markers
+	if (!settings().uri().empty()) {
+		uri = settings().uri();
+
+		if (!std::strstr(uri.c_str(), URI_MARKER_X) && !std::strstr(uri.c_str(), URI_MARKER_Y)) {
+			while (!uri.empty() && (uri.back() == '/'))
+				uri.pop_back();
+
+			uri += "/" URI_MARKER_Z "/" URI_MARKER_X "/" URI_MARKER_Y ".png";
+		}
+	}
+
 	if (std::strstr(uri.c_str(), URI_MARKER_X)) {
 		snprintf(s, sizeof(s), "%d", x);
 		uri = Utils::replace(uri, URI_MARKER_X, s);
@@ -389,14 +458,29 @@ std::string Map::buildURI(int zoom, int x, int y) {
 }
 
 
+int Map::cacheSource(void) {
+	uint32_t hash = 2166136261U;
+
+	if (settings().uri().empty())
+		return settings().source();
+
+	// Tiles server override has its own cache (FNV-1a of the URI)
+	for (const char &c : settings().uri()) {
+		hash ^= (uint8_t) c;
+		hash *= 16777619U;
+	}
+
+	return MapSettings::SourceCount + (int) (hash % 1000000000U);
+}
+
+
 std::string Map::buildPath(int zoom, int x, int y) {
 	std::ostringstream stream;
 
 	(void) x;
 	(void) y;
 
-	stream << std::getenv("HOME");
-	stream << "/.gpx2video/cache/" << settings().source() << "/" << zoom;
+	stream << Cache::path() << "/" << cacheSource() << "/" << zoom;
 
 	return stream.str();
 }
@@ -588,7 +672,23 @@ void Map::init(void) {
 		break;
 	}
 
-	// Drop old tiles
+	// Drop old tiles & map surface
+	clearSurface();
+
+	is_built_ = false;
+	is_loaded_ = false;
+
+	// Stop scheduler & cancel downloads in progress
+	if (timer_ != NULL)
+		evtimer_del(timer_);
+
+	for (Tile *tile : tiles_)
+		tile->cancel();
+
+	queue_.clear();
+	nbr_running_ = 0;
+	last_request_ = 0;
+
 	while (!tiles_.empty()) {
 		Tile *tile = tiles_.front();
 		tiles_.pop_front();
@@ -634,95 +734,138 @@ void Map::download(void) {
 			log_error("Download failure!");
 	}
 
+	// Start downloads
+	schedule();
+
 done:
 	refresh_is_required_ = false;
 }
 
 
-void Map::build(void) {
-	int fd;
+void Map::schedule(void) {
+	int64_t now;
+	int64_t next;
 
-	int width, height;
+	struct timeval tv;
+
+	unsigned int connections = std::max(1, settings().downloadConnections());
 
-	const char *template_name = "/tmp/map-XXXXXX";
+	int rate = settings().downloadRate();
 
 	log_call();
 
-	log_notice("Build map...");
+	while (!queue_.empty() && (nbr_running_ < connections)) {
+		Tile *tile;
 
-	// Map size
-	width = (vx2_ - vx1_ + 1) * TILESIZE;
-	height = (vy2_ - vy1_ + 1) * TILESIZE;
+		now = monotonic();
+		next = LLONG_MAX;
 
-	// Build map
-	if ((width > 0) && (height > 0)) {
-		// Filename is output if user builds map/track
-		if (app_.command() == GPXApplication::CommandMap) {
-			filename_ = app_.settings().outputfile();
+		// First tile ready (not waiting for a retry)
+		auto it = queue_.begin();
+
+		for (; it != queue_.end(); it++) {
+			if ((*it)->retry_at_ <= now)
+				break;
+
+			next = std::min(next, (*it)->retry_at_);
+		}
+
+		// Politeness, requests per second
+		if ((it != queue_.end()) && (rate > 0) && (now < last_request_ + 1000000 / rate)) {
+			next = last_request_ + 1000000 / rate;
+			it = queue_.end();
 		}
-		else if (filename_ == "") {
-			char *s;
 
-			// Make tmp filename
-			s = strdup(template_name);
-			fd = mkstemp(s);
+		// Wait
+		if (it == queue_.end()) {
+			if (timer_ == NULL)
+				timer_ = evtimer_new(evbase_, scheduleTimeout, this);
 
-			filename_ = s;
+			tv.tv_sec = (next - now) / 1000000;
+			tv.tv_usec = (next - now) % 1000000;
 
-			close(fd);
-			free(s);
+			evtimer_add(timer_, &tv);
+			break;
 		}
 
-		// Create image buffer
-		OIIO::ImageSpec outspec(width, height, 4);
-		OIIO::ImageBuf image_buffer(outspec); 
+		tile = *it;
+		queue_.erase(it);
 
-		// Create map
-		std::unique_ptr<OIIO::ImageOutput> out = OIIO::ImageOutput::create("map.png");
+		last_request_ = now;
 
-		// Collapse echo tile
-		for (Tile *tile : tiles_) {
-			std::string filename = tile->path() + "/" + tile->filename();
+		// Download
+		if (tile->perform()) {
+			nbr_running_++;
+			continue;
+		}
 
-			// Open tile image
-			auto img = OIIO::ImageInput::open(filename.c_str());
+		log_error("\nDownload tile failure: %s", tile->uri().c_str());
 
-			if (img == NULL) {
-				log_warn("Can't open '%s' tile", filename.c_str());
-				continue;
-			}
+		Map::downloadComplete(*tile);
+	}
+}
 
-			const OIIO::ImageSpec& spec = img->spec();
-			OIIO::TypeDesc::BASETYPE type = (OIIO::TypeDesc::BASETYPE) spec.format.basetype;
 
-			// Create tile buffer
-			OIIO::ImageBuf buf(OIIO::ImageSpec(spec.width, spec.height, spec.nchannels, type));
-			img->read_image(img->current_subimage(), img->current_miplevel(), 0, -1, type, buf.localpixels());
+void Map::scheduleTimeout(evutil_socket_t fd, short which, void *arg) {
+	Map *map = (Map *) arg;
 
-			// Add alpha channel
-			int channelorder[] = { 0, 1, 2, -1 /*use a float value*/ };
-			float channelvalues[] = { 0 /*ignore*/, 0 /*ignore*/, 0 /*ignore*/, 1.0 };
-			std::string channelnames[] = { "", "", "", "A" };
+	(void) fd;
+	(void) which;
 
-			OIIO::ImageBuf outbuf = OIIO::ImageBufAlgo::channels(buf, 4, channelorder, channelvalues, channelnames);
+	map->schedule();
+}
 
-			// Write tile
-			outbuf.specmod().x = (tile->x() - vx1_) * TILESIZE;
-			outbuf.specmod().y = (tile->y() - vy1_) * TILESIZE;
-			OIIO::ImageBufAlgo::over(image_buffer, outbuf, image_buffer, outbuf.roi());
-		}
 
-		// Write map file
-		if (out->open(filename_, image_buffer.spec()) == false) {
-			log_error("Build map failure, can't open '%s' file", filename_.c_str());
-			goto error;
-		}
+void Map::build(void) {
+	int width, height;
+
+	log_call();
+
+	log_notice("Build map...");
 
-		out->write_image(image_buffer.spec().format, image_buffer.localpixels());
-		out->close();
+	// Map size
+	width = (vx2_ - vx1_ + 1) * TILESIZE;
+	height = (vy2_ - vy1_ + 1) * TILESIZE;
+
+	// Build map
+	if ((width > 0) && (height > 0)) {
+		// Map surface is decoded from tiles on demand
+		is_built_ = true;
+		is_loaded_ = false;
 
+		// User requests map build
+		if (app_.command() == GPXApplication::CommandMap) {
+			std::string filename = app_.settings().outputfile();
+
+			// Create image buffer
+			OIIO::ImageSpec outspec(width, height, 4);
+			OIIO::ImageBuf image_buffer(outspec); 
+
+			// Create map
+			std::unique_ptr<OIIO::ImageOutput> out = OIIO::ImageOutput::create("map.png");
+
+			// Collapse echo tile
+			for (Tile *tile : tiles_) {
+				OIIO::ImageBuf outbuf;
+
+				if (!loadTile(tile->zoom(), tile->x(), tile->y(), outbuf))
+					continue;
+
+				// Write tile
+				OIIO::ImageBufAlgo::paste(image_buffer, (tile->x() - vx1_) * TILESIZE, (tile->y() - vy1_) * TILESIZE, 0, 0, outbuf);
+			}
+
+			// Write map file
+			if (out->open(filename, image_buffer.spec()) == false) {
+				log_error("Build map failure, can't open '%s' file", filename.c_str());
+				goto error;
+			}
+
+			out->write_image(image_buffer.spec().format, image_buffer.localpixels());
+			out->close();
+		}
 		// User requests track draw
-		if (app_.command() == GPXApplication::CommandTrack)
+		else if (app_.command() == GPXApplication::CommandTrack)
 			draw();
 	}
 	else {
@@ -735,7 +878,44 @@ error:
 }
 
 
+bool Map::loadTile(int zoom, int x, int y, OIIO::ImageBuf &outbuf) {
+	std::string filename = buildPath(zoom, x, y) + "/" + buildFilename(zoom, x, y);
+
+	// Decoded tile
+	if (TileStore::load(cacheSource(), zoom, x, y, outbuf))
+		return true;
+
+	// Open tile image
+	auto img = OIIO::ImageInput::open(filename.c_str());
+
+	if (img == NULL) {
+		log_warn("Can't open '%s' tile", filename.c_str());
+		return false;
+	}
+
+	const OIIO::ImageSpec& spec = img->spec();
+	OIIO::TypeDesc::BASETYPE type = (OIIO::TypeDesc::BASETYPE) spec.format.basetype;
+
+	// Create tile buffer
+	OIIO::ImageBuf buf(OIIO::ImageSpec(spec.width, spec.height, spec.nchannels, type));
+	img->read_image(img->current_subimage(), img->current_miplevel(), 0, -1, type, buf.localpixels());
+
+	// Add alpha channel
+	int channelorder[] = { 0, 1, 2, -1 /*use a float value*/ };
+	float channelvalues[] = { 0 /*ignore*/, 0 /*ignore*/, 0 /*ignore*/, 1.0 };
+	std::string channelnames[] = { "", "", "", "A" };
+
+	outbuf = OIIO::ImageBufAlgo::channels(buf, 4, channelorder, channelvalues, channelnames);
+
+	TileStore::save(cacheSource(), zoom, x, y, outbuf);
+
+	return true;
+}
+
+
 void Map::draw(void) {
+	int mapx, mapy;
+
 	std::string filename = "track.png";
 
 	log_call();
@@ -750,20 +930,34 @@ void Map::draw(void) {
 	// Load map
 	load();
 
+	if (!is_loaded_) {
+		log_error("Draw track failure, map isn't loaded");
+		return;
+	}
+
+	// Track position on map
+	mapx = (pevx1_ - (vx1_ * TILESIZE * divider_));
+	mapy = (pevy1_ - (vy1_ * TILESIZE * divider_));
+
 	// Create output image buffer
-	OIIO::ImageBuf buf(mapbuf_->spec());
+	OIIO::ImageBuf buf(OIIO::ImageSpec(surface_width_, surface_height_, 4, OIIO::TypeDesc::UINT8));
 
-	// Draw map
-	OIIO::ImageBufAlgo::over(buf, *mapbuf_, buf);
+	// Draw map & track, tile per tile
+	for (int ty=0; ty<=(surface_height_ - 1) / SurfaceTileSize; ty++) {
+		for (int tx=0; tx<=(surface_width_ - 1) / SurfaceTileSize; tx++) {
+			SurfaceTile *tile = surfaceTile(tx, ty);
 
-	// Draw track
-	OIIO::ImageBufAlgo::over(buf, *trackbuf_, buf);
+			OIIO::ImageBufAlgo::paste(buf, tile->x, tile->y, 0, 0, *tile->buf);
+
+			trimSurface(1);
+		}
+	}
 
 	// Draw icons
 	if (icon_start_buf_)
-		icon(buf, *icon_start_buf_, x_start_, y_start_, OIIO::ROI());
+		icon(buf, *icon_start_buf_, mapx + x_start_, mapy + y_start_, OIIO::ROI());
 	if (icon_end_buf_)
-		icon(buf, *icon_end_buf_, x_end_, y_end_, OIIO::ROI());
+		icon(buf, *icon_end_buf_, mapx + x_end_, mapy + y_end_, OIIO::ROI());
 
 	// Save
 	std::unique_ptr<OIIO::ImageOutput> out = OIIO::ImageOutput::create(filename);
@@ -782,47 +976,375 @@ error:
 
 
 bool Map::load(void) {
-	if (mapbuf_)
+	if (is_loaded_)
 		return true;
 
 	// Update track settings
 	Track::setSettings(settings());
 
-	if (Track::load() == false)
-		return false;
-
-	double divider = divider_;
+	// Rotate position icon once for all
+	if (icon_positions_.empty())
+		rotateIconPosition();
 
 	log_call();
 
-	if (filename_.empty() || !trackbuf_)
+	if (!isInitialized())
 		return true;
 
-	// Open map
-	auto img = OIIO::ImageInput::open(filename_);
-
-	if (img == NULL) {
-		log_warn("Can't load '%s' map file", filename_.c_str());
+	if (telemetry_source_ == NULL) {
+		log_warn("Can't read telemetry data");
 		return false;
 	}
 
-	const OIIO::ImageSpec& spec = img->spec();
-	VideoParams::Format img_fmt = OIIOUtils::getFormatFromOIIOBaseType((OIIO::TypeDesc::BASETYPE) spec.format.basetype);
-	OIIO::TypeDesc::BASETYPE type = OIIOUtils::getOIIOBaseTypeFromFormat(img_fmt);
+	if (!is_built_)
+		return true;
 
-	OIIO::ImageBuf buf(OIIO::ImageSpec(spec.width, spec.height, spec.nchannels, type)); //, OIIO::InitializePixels::No);
-	img->read_image(img->current_subimage(), img->current_miplevel(), 0, -1, type, buf.localpixels());
+	// Compute begin & end
+	computeEnds();
+
+	// Map size
+	surface_width_ = (vx2_ - vx1_ + 1) * TILESIZE * divider_;
+	surface_height_ = (vy2_ - vy1_ + 1) * TILESIZE * divider_;
+
+	// Tiles are decoded as the view reaches them
+	clearSurface();
+
+	// Tiles rendered by a previous run
+	mosaic_path_ = buildMosaicPath();
+
+	if (Utils::mkpath(mosaic_path_, 0700) == 0)
+		utime(mosaic_path_.c_str(), NULL);
+	else
+		mosaic_path_ = "";
+
+	// Init
+	last_data_ = TelemetryData();
+
+	is_loaded_ = true;
+
+	return true;
+}
+
+
+Map::SurfaceTile * Map::surfaceTile(int tx, int ty) {
+	int x1, y1;
+	int x2, y2;
+	int width, height;
+
+	double margin;
+
+	bool is_complete = true;
+
+	int zoom = settings().zoom();
+
+	bool is_progress = (last_data_.type() != TelemetryData::TypeUnknown);
+
+	SurfaceTile tile;
+
+	std::pair<int, int> key(tx, ty);
+
+	auto it = surface_.find(key);
+
+	if (it != surface_.end()) {
+		// Most recently used
+		surface_lru_.splice(surface_lru_.begin(), surface_lru_, it->second.lru);
+
+		return &it->second;
+	}
+
+	log_debug("Decode map surface tile %d x %d", tx, ty);
+
+	// Tile area on map
+	tile.x = tx * SurfaceTileSize;
+	tile.y = ty * SurfaceTileSize;
+
+	width = std::min(SurfaceTileSize, surface_width_ - tile.x);
+	height = std::min(SurfaceTileSize, surface_height_ - tile.y);
+
+	// Full window is the whole map, so as resize samples as for the whole map
+	OIIO::ImageSpec spec(width, height, 4, OIIO::TypeDesc::UINT8);
+	spec.x = tile.x;
+	spec.y = tile.y;
+	spec.full_x = 0;
+	spec.full_y = 0;
+	spec.full_width = surface_width_;
+	spec.full_height = surface_height_;
+
+	tile.buf = new OIIO::ImageBuf(spec);
+
+	// Map & path rendered by a previous run
+	if (loadMosaic(tile)) {
+		if (is_progress)
+			overlaySurfaceTile(tile, false, true);
+
+		goto done;
+	}
+
+	// Map tiles under the area, with the resize filter margin
+	margin = 4.0 / std::min(divider_, 1.0);
+
+	x1 = std::max(0, (int) floor((tile.x / divider_ - margin) / TILESIZE));
+	y1 = std::max(0, (int) floor((tile.y / divider_ - margin) / TILESIZE));
+
+	x2 = std::min(vx2_ - vx1_, (int) floor(((tile.x + width) / divider_ + margin) / TILESIZE));
+	y2 = std::min(vy2_ - vy1_, (int) floor(((tile.y + height) / divider_ + margin) / TILESIZE));
 
-	// Resize map
-	mapbuf_ = new OIIO::ImageBuf(OIIO::ImageSpec(spec.width * divider, spec.height * divider, spec.nchannels, type)); //, OIIO::InitializePixels::No);
-	OIIO::ImageBufAlgo::resize(*mapbuf_, buf);
+	if ((x1 <= x2) && (y1 <= y2)) {
+		OIIO::ImageSpec mapspec((x2 - x1 + 1) * TILESIZE, (y2 - y1 + 1) * TILESIZE, 4, OIIO::TypeDesc::UINT8);
+		mapspec.x = x1 * TILESIZE;
+		mapspec.y = y1 * TILESIZE;
+		mapspec.full_x = 0;
+		mapspec.full_y = 0;
+		mapspec.full_width = (vx2_ - vx1_ + 1) * TILESIZE;
+		mapspec.full_height = (vy2_ - vy1_ + 1) * TILESIZE;
 
-	// Background track image over
-	trackbuf_->specmod().x = (pevx1_ - (vx1_ * TILESIZE * divider_));
-	trackbuf_->specmod().y = (pevy1_ - (vy1_ * TILESIZE * divider_));
-	OIIO::ImageBufAlgo::over(*mapbuf_, *trackbuf_, *mapbuf_);
+		OIIO::ImageBuf mapbuf(mapspec);
 
-	return (mapbuf_ != NULL);
+		for (int y=y1; y<=y2; y++) {
+			for (int x=x1; x<=x2; x++) {
+				OIIO::ImageBuf buf;
+
+				if (loadTile(zoom, vx1_ + x, vy1_ + y, buf))
+					OIIO::ImageBufAlgo::paste(mapbuf, x * TILESIZE, y * TILESIZE, 0, 0, buf);
+				else
+					is_complete = false;
+			}
+		}
+
+		// Resize map
+		OIIO::ImageBufAlgo::resize(*tile.buf, mapbuf);
+	}
+
+	// Draw background path
+	overlaySurfaceTile(tile, true, false);
+
+	// Don't save a tile with a missing map tile
+	if (is_complete)
+		saveMosaic(tile);
+
+	if (is_progress)
+		overlaySurfaceTile(tile, false, true);
+
+done:
+	// Most recently used
+	surface_lru_.push_front(key);
+	tile.lru = surface_lru_.begin();
+
+	surface_size_ += (size_t) width * height * 4;
+
+	surface_[key] = tile;
+
+	return &surface_[key];
+}
+
+
+void Map::overlaySurfaceTile(SurfaceTile &tile, bool with_path, bool with_progress) {
+	int mapx, mapy;
+	int width, height;
+
+	int stride;
+	unsigned char *bytes;
+
+	cairo_t *cairo;
+	cairo_surface_t *surface;
+
+	width = tile.buf->spec().width;
+	height = tile.buf->spec().height;
+
+	// Track position on map
+	mapx = (pevx1_ - (vx1_ * TILESIZE * divider_));
+	mapy = (pevy1_ - (vy1_ * TILESIZE * divider_));
+
+	// Draw background path & progress
+	surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+
+	cairo = cairo_create(surface);
+
+	cairo_translate(cairo, mapx - tile.x, mapy - tile.y);
+
+	if (with_path)
+		path(cairo, telemetry_source_, divider_);
+
+	if (with_progress)
+		progress(cairo, telemetry_source_, divider_, last_data_.timestamp());
+
+	// Cairo to OIIO
+	bytes = cairo_image_surface_get_data(surface);
+	stride = cairo_image_surface_get_stride(surface);
+
+	OIIO::ImageBuf buf(OIIO::ImageSpec(width, height, 4, OIIO::TypeDesc::UINT8));
+
+	buf.set_pixels(OIIO::ROI(),
+		buf.spec().format,
+		bytes, 
+		OIIO::AutoStride,
+		stride);
+
+	// BGRA => RGBA
+	int channelorder[] = { 2, 1, 0, 3 };
+	float channelvalues[] = { };
+	std::string channelnames[] = { "R", "G", "B", "A" };
+
+	OIIO::ImageBufAlgo::channels(buf, buf, 4, channelorder, channelvalues, channelnames);
+
+	// Track over map
+	buf.specmod().x = tile.x;
+	buf.specmod().y = tile.y;
+	Blend::over(*tile.buf, buf);
+
+	// Release
+	cairo_surface_destroy(surface);
+	cairo_destroy(cairo);
+}
+
+
+std::string Map::buildMosaicPath(void) {
+	char s[512];
+
+	uint64_t hash = 14695981039346656037ULL;
+
+	int zoom = settings().zoom();
+
+	const float *fill = settings().pathSecondaryColor();
+	const float *outline = settings().pathBorderColor();
+
+	TelemetryData wpt;
+
+	enum TelemetrySource::Data result;
+
+	// FNV-1a
+	auto update = [&hash](const void *data, size_t size) {
+		for (size_t i=0; i<size; i++) {
+			hash ^= ((const uint8_t *) data)[i];
+			hash *= 1099511628211ULL;
+		}
+	};
+
+	// Map area & path styling
+	snprintf(s, sizeof(s), "v2|%d|%d|%d|%.6f|%d,%d,%d,%d|%d,%d|%dx%d|%.3f|%.3f|%.3f,%.3f,%.3f,%.3f|%.3f,%.3f,%.3f,%.3f",
+		SurfaceTileSize, cacheSource(), zoom, divider_,
+		vx1_, vy1_, vx2_, vy2_, pevx1_, pevy1_, surface_width_, surface_height_,
+		settings().pathThick(), settings().pathBorder(),
+		fill[0], fill[1], fill[2], fill[3],
+		outline[0], outline[1], outline[2], outline[3]);
+
+	update(s, strlen(s));
+
+	// Map tiles freshness, a refreshed tile changes the mosaic
+	for (int y=vy1_; y<=vy2_; y++) {
+		for (int x=vx1_; x<=vx2_; x++) {
+			struct stat st;
+			int64_t stamp[2] = { 0, 0 };
+
+			std::string filename = buildPath(zoom, x, y) + "/" + buildFilename(zoom, x, y);
+
+			if (stat(filename.c_str(), &st) == 0) {
+				stamp[0] = st.st_mtime;
+				stamp[1] = st.st_size;
+			}
+
+			update(stamp, sizeof(stamp));
+		}
+	}
+
+	// Path, as drawn
+	for (result = telemetry_source_->retrieveFirst(wpt); result != TelemetrySource::DataEof; result = telemetry_source_->retrieveNext(wpt)) {
+		int point[2];
+
+		point[0] = Track::lon2pixel(zoom, divider_, wpt.longitude()) - pevx1_;
+		point[1] = Track::lat2pixel(zoom, divider_, wpt.latitude()) - pevy1_;
+
+		update(point, sizeof(point));
+	}
+
+	snprintf(s, sizeof(s), "%016llx", (unsigned long long) hash);
+
+	return Cache::path() + "/mosaic/" + s;
+}
+
+
+bool Map::loadMosaic(SurfaceTile &tile) {
+	int fd;
+	ssize_t n;
+	size_t size;
+
+	char filename[PATH_MAX];
+
+	const OIIO::ImageSpec &spec = tile.buf->spec();
+
+	if (mosaic_path_.empty())
+		return false;
+
+	snprintf(filename, sizeof(filename), "%s/%d_%d.rgba", mosaic_path_.c_str(), tile.x / SurfaceTileSize, tile.y / SurfaceTileSize);
+
+	if ((fd = ::open(filename, O_RDONLY)) == -1)
+		return false;
+
+	size = (size_t) spec.width * spec.height * 4;
+
+	n = read(fd, tile.buf->localpixels(), size);
+
+	::close(fd);
+
+	return (n == (ssize_t) size);
+}
+
+
+void Map::saveMosaic(const SurfaceTile &tile) {
+	int fd;
+	ssize_t n;
+	size_t size;
+
+	char filename[PATH_MAX];
+	char tmpfile[PATH_MAX];
+
+	const OIIO::ImageSpec &spec = tile.buf->spec();
+
+	if (mosaic_path_.empty())
+		return;
+
+	snprintf(filename, sizeof(filename), "%s/%d_%d.rgba", mosaic_path_.c_str(), tile.x / SurfaceTileSize, tile.y / SurfaceTileSize);
+	snprintf(tmpfile, sizeof(tmpfile), "%s.%d", filename, (int) getpid());
+
+	if ((fd = ::open(tmpfile, O_WRONLY | O_CREAT | O_TRUNC, 0600)) == -1)
+		return;
+
+	size = (size_t) spec.width * spec.height * 4;
+
+	n = write(fd, tile.buf->localpixels(), size);
+
+	::close(fd);
+
+	// Other renderers (segments) may share the mosaic, replace at once
+	if ((n != (ssize_t) size) || (rename(tmpfile, filename) != 0))
+		unlink(tmpfile);
+}
+
+
+void Map::trimSurface(size_t count) {
+	while ((surface_lru_.size() > count) && (surface_size_ > SurfaceCacheSize)) {
+		auto last = surface_.find(surface_lru_.back());
+
+		const OIIO::ImageSpec &spec = last->second.buf->spec();
+
+		surface_size_ -= (size_t) spec.width * spec.height * 4;
+
+		delete last->second.buf;
+
+		surface_.erase(last);
+		surface_lru_.pop_back();
+	}
+}
+
+
+void Map::clearSurface(void) {
+	for (auto &it : surface_)
+		delete it.second.buf;
+
+	surface_.clear();
+	surface_lru_.clear();
+
+	surface_size_ = 0;
 }
 
 
@@ -979,10 +1501,6 @@ OIIO::ImageBuf * Map::render(const TelemetryData &data, bool &is_update) {
 	}
 
 	// Image buffer
-	if (fg_buf_ != NULL)
-		delete fg_buf_;
-
-	// Draw
 	this->createBox(&fg_buf_, theme().width(), theme().height());
 
 	// Cairo context
@@ -997,18 +1515,50 @@ OIIO::ImageBuf * Map::render(const TelemetryData &data, bool &is_update) {
 	// Release
 	this->destroyCairoContext(cairo);
 
-	if (mapbuf_ != NULL) {
-		// Update path progress
+	if (is_loaded_) {
+		int mapx, mapy;
+		int tx1, ty1, tx2, ty2;
+
+		std::list<SurfaceTile *> tiles;
+		std::list<OIIO::ImageBuf *> outbufs;
+
+		// Track position on map
+		mapx = (pevx1_ - (vx1_ * TILESIZE * divider_));
+		mapy = (pevy1_ - (vy1_ * TILESIZE * divider_));
+
+		// Surface tiles in the viewport
+		tx1 = std::max(0, (int) floor((double) (mapx - offsetX) / SurfaceTileSize));
+		ty1 = std::max(0, (int) floor((double) (mapy - offsetY) / SurfaceTileSize));
+
+		tx2 = std::min((surface_width_ - 1) / SurfaceTileSize, (int) floor((double) (mapx - offsetX + width - 1) / SurfaceTileSize));
+		ty2 = std::min((surface_height_ - 1) / SurfaceTileSize, (int) floor((double) (mapy - offsetY + height - 1) / SurfaceTileSize));
+
+		for (int ty=ty1; ty<=ty2; ty++) {
+			for (int tx=tx1; tx<=tx2; tx++)
+				tiles.push_back(surfaceTile(tx, ty));
+		}
+
+		// Update path progress, in each decoded tile
 		if (is_move) {
-			mapbuf_->specmod().x = -(pevx1_ - (vx1_ * TILESIZE * divider_));
-			mapbuf_->specmod().y = -(pevy1_ - (vy1_ * TILESIZE * divider_));
-			path(*mapbuf_, data, divider_);
+			for (auto &it : surface_) {
+				it.second.buf->specmod().x = it.second.x - mapx;
+				it.second.buf->specmod().y = it.second.y - mapy;
+
+				outbufs.push_back(it.second.buf);
+			}
+
+			path(outbufs, data, divider_);
 		}
 
+		// Keep the viewport tiles
+		trimSurface(tiles.size());
+
 		// Map & track image over
-		mapbuf_->specmod().x = x + offsetX - ((pevx1_ - (vx1_ * TILESIZE * divider_)));
-		mapbuf_->specmod().y = y + offsetY - ((pevy1_ - (vy1_ * TILESIZE * divider_)));
-		OIIO::ImageBufAlgo::over(*fg_buf_, *mapbuf_, *fg_buf_, OIIO::ROI(x, x + width, y, y + height));
+		for (SurfaceTile *tile : tiles) {
+			tile->buf->specmod().x = x + offsetX - mapx + tile->x;
+			tile->buf->specmod().y = y + offsetY - mapy + tile->y;
+			Blend::over(*fg_buf_, *tile->buf, OIIO::ROI(x, x + width, y, y + height));
+		}
 
 		// Draw picto
 		if (icon_start_buf_ && theme().hasFlag(VideoWidget::Theme::FlagIconStart))
@@ -1020,9 +1570,7 @@ OIIO::ImageBuf * Map::render(const TelemetryData &data, bool &is_update) {
 			if (settings().follow() != TrackSettings::FollowNone) {
 				double angle = (settings().follow() == TrackSettings::FollowCourse) ? data.course() : data.heading();
 
-				OIIO::ImageBuf position = OIIO::ImageBufAlgo::rotate(*icon_position_buf_, angle * M_PI / 180.0);
-
-				icon(*fg_buf_, position, x + offsetX + posX, y + offsetY + posY, OIIO::ROI(x, x + width, y, y + height));
+				icon(*fg_buf_, *iconPosition(angle), x + offsetX + posX, y + offsetY + posY, OIIO::ROI(x, x + width, y, y + height));
 			}
 			else 
 				icon(*fg_buf_, *icon_position_buf_, x + offsetX + posX, y + offsetY + posY, OIIO::ROI(x, x + width, y, y + height));
@@ -1061,12 +1609,12 @@ void Map::clear(void) {
 	if (fg_buf_)
 		delete fg_buf_;
 
-	if (mapbuf_)
-		delete mapbuf_;
+	clearSurface();
 
 	bg_buf_ = NULL;
 	fg_buf_ = NULL;
-	mapbuf_ = NULL;
+
+	is_loaded_ = false;
 }
 
 
@@ -1120,6 +1668,28 @@ void Map::downloadComplete(Map::Tile &tile) {
 }
 
 
+bool Map::downloadRetry(Map::Tile &tile) {
+	int64_t delay;
+
+	Map& map = tile.map();
+
+	if (tile.retries_ >= DownloadRetries)
+		return false;
+
+	// Backoff: 1s, 2s, 4s...
+	delay = 1000000LL << tile.retries_;
+
+	log_warn("\nDownload tile failure: %s, retry in %lld s", tile.uri().c_str(), (long long) (delay / 1000000));
+
+	tile.retries_++;
+	tile.retry_at_ = monotonic() + delay;
+
+	map.queue_.push_back(&tile);
+
+	return true;
+}
+
+
 Map::Tile::Tile(Map &map, int zoom, int x, int y)
 	: map_(map)
 	, zoom_(zoom)
@@ -1128,8 +1698,13 @@ Map::Tile::Tile(Map &map, int zoom, int x, int y)
 	fp_ = NULL;
 	evtaskh_ = NULL;
 
+	expires_ = 0;
+
 	last_update_ = 0;
 
+	retries_ = 0;
+	retry_at_ = 0;
+
 	uri_ = map_.buildURI(zoom_, x_, y_);
 	path_ = map_.buildPath(zoom_, x_, y_);
 	filename_ = map_.buildFilename(zoom_, x_, y_);
@@ -1137,6 +1712,7 @@ Map::Tile::Tile(Map &map, int zoom, int x, int y)
 
 
 Map::Tile::~Tile() {
+	cancel();
 }
 
 
@@ -1205,56 +1781,136 @@ size_t Map::Tile::downloadWrite(char *ptr, size_t size, size_t nmemb, void *user
 }
 
 
+size_t Map::Tile::downloadHeader(char *ptr, size_t size, size_t nmemb, void *userdata) {
+	int maxage;
+
+	Map::Tile *tile = (Map::Tile *) userdata;
+
+	std::string header(ptr, size * nmemb);
+
+	// New response (redirect)
+	if (strncasecmp(header.c_str(), "HTTP/", 5) == 0) {
+		tile->etag_ = "";
+		tile->expires_ = 0;
+	}
+	else if (strncasecmp(header.c_str(), "ETag:", 5) == 0) {
+		// Whole value, may hold spaces
+		size_t begin = header.find_first_not_of(" \t", 5);
+		size_t end = header.find_last_not_of(" \t\r\n");
+
+		tile->etag_ = ((begin != std::string::npos) && (end >= begin)) ? header.substr(begin, end - begin + 1) : "";
+	}
+	else if ((strncasecmp(header.c_str(), "Cache-Control:", 14) == 0)
+		&& (strstr(header.c_str(), "max-age=") != NULL)
+		&& (sscanf(strstr(header.c_str(), "max-age="), "max-age=%d", &maxage) == 1))
+		tile->expires_ = time(NULL) + maxage;
+
+	return size * nmemb;
+}
+
+
 void Map::Tile::downloadComplete(EVCurlTask *evtaskh, CURLcode result, void *userdata) {
+	long code = 0;
+
+	bool retry = false;
+
 	Map::Tile *tile = (Map::Tile *) userdata;
 
-	log_call();
+	Map& map = tile->map();
 
-	(void) evtaskh;
-	(void) result;
+	log_call();
 
 	if (tile->fp_)
 		std::fclose(tile->fp_);
 
+	evtaskh->getInfo(CURLINFO_RESPONSE_CODE, &code);
+
 	if (result != CURLE_OK) {
 		std::string output = tile->path_ + "/" + tile->filename_;
 
-		log_error("\nDownload tile failure: %s", tile->uri().c_str());
+		// Server busy or network error, try again later
+		switch (result) {
+		case CURLE_HTTP_RETURNED_ERROR:
+			retry = (code == 429) || (code >= 500);
+			break;
+
+		case CURLE_COULDNT_CONNECT:
+		case CURLE_OPERATION_TIMEDOUT:
+		case CURLE_SEND_ERROR:
+		case CURLE_RECV_ERROR:
+		case CURLE_GOT_NOTHING:
+		case CURLE_PARTIAL_FILE:
+		case CURLE_HTTP2:
+		case CURLE_HTTP2_STREAM:
+			retry = true;
+			break;
+
+		default:
+			break;
+		}
 
-		unlink(output.c_str());
+		// Drop partial tile, but keep a previous tile if nothing received
+		if (tile->fp_)
+			unlink(output.c_str());
+	}
+	else {
+		// Tile downloaded or not modified (304)
+		TileStore::update(map.cacheSource(), tile->zoom_, tile->x_, tile->y_,
+			tile->path_ + "/" + tile->filename_, tile->etag_,
+			(tile->expires_ > 0) ? tile->expires_ : time(NULL) + TileStore::DefaultExpiry,
+			(code != 304));
 	}
 
 	tile->fp_ = NULL;
 	tile->evtaskh_ = NULL;
 
-	Map::downloadComplete(*tile);
+	map.nbr_running_--;
+
+	if (result == CURLE_OK)
+		Map::downloadComplete(*tile);
+	else if (!retry || !Map::downloadRetry(*tile)) {
+		log_error("\nDownload tile failure: %s", tile->uri().c_str());
+
+		Map::downloadComplete(*tile);
+	}
+
+	// Next downloads
+	map.schedule();
 }
 
 
 bool Map::Tile::download(void) {
-	struct stat st;
-
 	std::string output = path_ + "/" + filename_;
 
 	log_call();
 
-	Utils::mkpath(path_, 0700);
-
-	// Check if file exists in cache
-	if (access(output.c_str(), F_OK) == 0) {
-		// Check file content
-		stat(output.c_str(), &st);
-
-		if (st.st_size > 0) {
-			Map::downloadComplete(*this);
-			return true;
-		}
+	// Check if tile is in cache & not expired
+	if (TileStore::isValid(map_.cacheSource(), zoom_, x_, y_, output)) {
+		Map::downloadComplete(*this);
+		return true;
 	}
 
 	// Downloading?
 	if (evtaskh_ != NULL)
 		return true;
-	
+
+	Utils::mkpath(path_, 0700);
+
+	// Queue download
+	retries_ = 0;
+	retry_at_ = 0;
+
+	map_.queue_.push_back(this);
+
+	return true;
+}
+
+
+bool Map::Tile::perform(void) {
+	std::string etag;
+
+	log_call();
+
 	// Download
 	evtaskh_ = map_.evcurl()->download(uri_.c_str(), downloadComplete, this);
 
@@ -1269,12 +1925,58 @@ bool Map::Tile::download(void) {
 	evtaskh_->setOption(CURLOPT_WRITEFUNCTION, downloadWrite);
 	evtaskh_->setOption(CURLOPT_WRITEDATA, this);
 
+	evtaskh_->setOption(CURLOPT_HEADERFUNCTION, downloadHeader);
+	evtaskh_->setOption(CURLOPT_HEADERDATA, this);
+
 	evtaskh_->setOption(CURLOPT_FOLLOWLOCATION, 1L);
 
+	// HTTP/2 if the server supports it, wait to share a connection
+	evtaskh_->setOption(CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS);
+	evtaskh_->setOption(CURLOPT_PIPEWAIT, 1L);
+
 	evtaskh_->setHeader("User-Agent: gpx2video");
 
-	evtaskh_->perform();
+	// Expired tile, server answers 304 if not modified
+	etag = TileStore::etag(map_.cacheSource(), zoom_, x_, y_);
+
+	if (!etag.empty())
+		evtaskh_->setHeader(("If-None-Match: " + etag).c_str());
+
+	etag_ = "";
+	expires_ = 0;
+
+	if (evtaskh_->perform() != 0) {
+		evtaskh_->cancel();
+
+		delete evtaskh_;
+		evtaskh_ = NULL;
+
+		return false;
+	}
 
 	return true;
 }
 
+
+void Map::Tile::cancel(void) {
+	std::string output = path_ + "/" + filename_;
+
+	if (evtaskh_ == NULL)
+		return;
+
+	log_call();
+
+	evtaskh_->cancel();
+
+	delete evtaskh_;
+	evtaskh_ = NULL;
+
+	// Drop partial tile
+	if (fp_) {
+		std::fclose(fp_);
+		unlink(output.c_str());
+	}
+
+	fp_ = NULL;
+}
+
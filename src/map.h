@@ -7,6 +7,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <list>
+#include <map>
 
 #include <stdlib.h>
 
@@ -28,10 +29,17 @@ public:
 	public:
 		time_t last_update_;
 
+		// Download attempts & next attempt (backoff)
+		unsigned int retries_;
+		int64_t retry_at_;
+
 		Tile(Map &map, int zoom, int x, int y);
 		virtual ~Tile();
 
 		Map& map(void);
+		int zoom(void) {
+			return zoom_;
+		}
 		int x(void) {
 			return x_;
 		}
@@ -42,11 +50,14 @@ public:
 		const std::string& path(void);
 		const std::string& filename(void);
 		bool download(void);
+		bool perform(void);
+		void cancel(void);
 
 	protected:
 		static int downloadDebug(CURL *curl, curl_infotype type, char *ptr, size_t size, void *userdata);
 		static int downloadProgress(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
 		static size_t downloadWrite(char *ptr, size_t size, size_t nmemb, void *userdata);
+		static size_t downloadHeader(char *ptr, size_t size, size_t nmemb, void *userdata);
 		static void downloadComplete(EVCurlTask *evtaskh, CURLcode result, void *userdata);
 
 	private:
@@ -58,6 +69,10 @@ public:
 		std::string filename_;
 		std::FILE *fp_;
 		EVCurlTask *evtaskh_;
+
+		// Server cache validators
+		std::string etag_;
+		time_t expires_;
 	};
 
 	virtual ~Map();
@@ -108,6 +123,7 @@ public:
 
 	static void downloadProgress(Tile &tile, curl_off_t dltotal, curl_off_t dlnow);
 	static void downloadComplete(Tile &tile);
+	static bool downloadRetry(Tile &tile);
 
 protected:
 	EVCurl *evcurl(void) {
@@ -119,9 +135,15 @@ protected:
 
 	// Download each tule
 	void download(void);
+	// Start queued downloads (parallel transfers & rate limits)
+	void schedule(void);
+	static void scheduleTimeout(evutil_socket_t fd, short which, void *arg);
 	// Draw the full map
 	void build(void);
 
+	// Read map tile (RGBA), from tiles store or tile file
+	bool loadTile(int zoom, int x, int y, OIIO::ImageBuf &outbuf);
+
 	void xmlopen(std::ostream &os) {
 		log_call();
 
@@ -153,18 +175,61 @@ private:
 
 	Map(GPXApplication &app, const MapSettings &map_settings, TelemetrySource *telemetry_source, struct event_base *evbase);
 
+	// Tiles cache & store source key, distinct for a tiles server override
+	int cacheSource(void);
+
 	std::string buildURI(int zoom, int x, int y);
 	std::string buildPath(int zoom, int x, int y);
 	std::string buildFilename(int zoom, int x, int y);
+	// Mosaic cache directory, keyed by map & track content
+	std::string buildMosaicPath(void);
 
 	MapSettings map_settings_;
 
+	// Map surface tile (map, track & path progress)
+	class SurfaceTile {
+	public:
+		// Position on map (pixel)
+		int x, y;
+
+		OIIO::ImageBuf *buf;
+
+		std::list<std::pair<int, int> >::iterator lru;
+	};
+
+	// Surface tile, decoded if not in cache
+	SurfaceTile * surfaceTile(int tx, int ty);
+
+	// Draw path and/or progress over a surface tile
+	void overlaySurfaceTile(SurfaceTile &tile, bool with_path, bool with_progress);
+
+	// Surface tile (map & path) saved by a previous render
+	bool loadMosaic(SurfaceTile &tile);
+	void saveMosaic(const SurfaceTile &tile);
+
+	// Drop least recently used tiles over the budget, but the count last used
+	void trimSurface(size_t count);
+	void clearSurface(void);
+
 	EVCurl *evcurl_;
 
-	OIIO::ImageBuf *mapbuf_;
+	// Map tiles downloaded
+	bool is_built_;
+	bool is_loaded_;
+
+	// Map surface, split in tiles decoded on demand. Only the tiles in
+	// the widget viewport are drawn, so memory & time don't depend on
+	// the track size.
+	static const int SurfaceTileSize = 512;
+	static const size_t SurfaceCacheSize = 64 * 1024 * 1024;
 
-	// Map filename to tmp save
-	std::string filename_;
+	int surface_width_, surface_height_;
+
+	std::map<std::pair<int, int>, SurfaceTile> surface_;
+	std::list<std::pair<int, int> > surface_lru_;
+	size_t surface_size_;
+
+	std::string mosaic_path_;
 
 	// Bounding box (tile view area)
 	int vx1_, vy1_, vx2_, vy2_;
@@ -176,6 +241,14 @@ private:
 
 	unsigned int nbr_downloads_;
 	std::list<Tile *> tiles_;
+
+	// Tiles to download
+	static const unsigned int DownloadRetries = 3;
+
+	std::list<Tile *> queue_;
+	unsigned int nbr_running_;
+	int64_t last_request_;
+	struct event *timer_;
 };
 
 #endif
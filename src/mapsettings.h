@@ -38,6 +38,15 @@ public:
 	const Source& source(void) const;
 	void setSource(const Source &source);
 
+	const int& downloadConnections(void) const;
+	void setDownloadConnections(const int &connections);
+
+	const int& downloadRate(void) const;
+	void setDownloadRate(const int &rate);
+
+	const std::string& uri(void) const;
+	void setURI(const std::string &uri);
+
 	static const std::string getFriendlyName(const Source &source);
 	static const std::string getCopyright(const Source &source);
 	static int getMinZoom(const Source &source);
@@ -46,6 +55,13 @@ public:
 
 private:
 	enum Source source_;
+
+	// Tiles downloaded in parallel & started per second (0 => no limit)
+	int download_connections_;
+	int download_rate_;
+
+	// Tiles server override (mirror of the source, cached apart)
+	std::string uri_;
 };
 
 #endif
@@ -9,11 +9,14 @@
 MediaContainer::MediaContainer() 
 	: start_time_(0)
 	, creation_time_(0) 
-	, max_frame_duration_(0) {
+	, max_frame_duration_(0)
+	, demuxer_(NULL) {
 }
 
 
 MediaContainer::~MediaContainer() {
+	if (demuxer_)
+		delete demuxer_;
 }
 
 
@@ -138,3 +141,9 @@ VideoStreamPtr MediaContainer::getVideoStream(void) {
 }
 
 
+Demuxer * MediaContainer::demuxer(void) {
+	if (demuxer_ == NULL)
+		demuxer_ = Demuxer::create(filename_);
+
+	return demuxer_;
+}
@@ -12,6 +12,7 @@ extern "C" {
 }
 
 #include "stream.h"
+#include "demuxer.h"
 
 
 class MediaContainer {
@@ -46,6 +47,9 @@ public:
 	AudioStreamPtr getAudioStream(void);
 	VideoStreamPtr getVideoStream(void);
 
+	// Demuxer shared by the stream decoders, opened on first call
+	Demuxer * demuxer(void);
+
 private:
 	uint64_t start_time_;
 	uint64_t creation_time_;
@@ -55,6 +59,8 @@ private:
 	std::string filename_;
 
 	std::vector<StreamPtr> streams_;
+
+	Demuxer *demuxer_;
 };
 
 
@@ -2,6 +2,7 @@
 #include <cairo.h>
 
 #include "log_i.h"
+#include "iconcache.h"
 #include "oiioutils.h"
 
 
@@ -61,6 +62,10 @@ OIIO::TypeDesc::BASETYPE OIIOUtils::getOIIOBaseTypeFromFormat(enum VideoParams::
 
 
 void OIIOUtils::frameToBuffer(const Frame *frame, OIIO::ImageBuf *buf) {
+	// Buffer wraps frame data
+	if (buf->localpixels() == frame->constData())
+		return;
+
 	buf->set_pixels(OIIO::ROI(), 
 			buf->spec().format, 
 			frame->constData(), 
@@ -70,6 +75,10 @@ void OIIOUtils::frameToBuffer(const Frame *frame, OIIO::ImageBuf *buf) {
 
 
 void OIIOUtils::bufferToFrame(OIIO::ImageBuf *buf, const Frame *frame) {
+	// Buffer wraps frame data
+	if (buf->localpixels() == frame->constData())
+		return;
+
 	buf->get_pixels(OIIO::ROI(), 
 			buf->spec().format, 
 			frame->data(), 
@@ -95,98 +104,39 @@ error:
 
 
 OIIO::ImageBuf * OIIOUtils::loadsvg(const char *filename, const double &size, const float *color) {
-	bool apply_color;
-
 	int stride;
 	unsigned char *data;
 
 	double width, height;
 
-    GError *error = nullptr;
-
-	cairo_t *cr = NULL;
-	cairo_t *mask = NULL;
 	cairo_surface_t *surface = NULL;
-	cairo_surface_t *masksurface = NULL;
 
 	int channelorder[] = { 2, 1, 0, 3 };
 	float channelvalues[] = { };
-	std::string channelnames[] = { "B", "G", "R", "A" };
-
-	RsvgRectangle viewport;
-
-	RsvgHandle *handle = NULL;
+	std::string channelnames[] = { "R", "G", "B", "A" };
 
 	OIIO::ImageBuf *buf = NULL;
 
-	// Set color
-	apply_color = (color != NULL) && (color[3] != 0);
-
-	// load svg data
-    handle = rsvg_handle_new_from_file(filename, &error);
-    if (!handle) {
-		log_error("Load svg image '%s' error: %s", 
-				filename, 
-				error ? error->message : "unknown error");
-
-		if (error) 
-        	g_error_free(error);
-        goto error;
-    }
-
-    // svg dimensions
-	rsvg_handle_get_intrinsic_size_in_pixels(handle, &width, &height);
+	// svg dimensions
+	if (!IconCache::size(filename, width, height))
+		goto error;
 
 	// Compute size
 	width = width * size / height;
 	height = size;
 
-	// Create cairo surface (ARGB32)
-	surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+	// Rasterized svg (shared cache)
+	surface = IconCache::surface(filename, (int) width, (int) height, color);
 
-	// Create cairo context
-	cr = cairo_create(surface);
-
-	if (apply_color) {
-    	// Create cairo alpha only surface
-		masksurface = cairo_image_surface_create(CAIRO_FORMAT_A8, width, height);
-
-		// Create mask
-		mask = cairo_create(masksurface);
-	}
-
-	// Render svg into cairo surface
-	viewport = (RsvgRectangle) {
-		.x = 0,
-		.y = 0,
-		.width = (double) width,
-		.height = (double) height
-	};
-
-	if (!rsvg_handle_render_document(handle, apply_color ? mask : cr, &viewport, &error)) {
-		log_error("Render svg '%s' error: %s", 
-				filename, 
-				error ? error->message : "unknown error");
-
-		if (error) 
-			g_error_free(error);
+	if (surface == NULL)
 		goto error;
-	}
 
-	if (apply_color) {
-		// Apply color
-		cairo_set_source_rgba(cr, color[0], color[1], color[2], color[3]);
+	// Get raw pixel data from cairo
+	data = cairo_image_surface_get_data(surface);
+	stride = cairo_image_surface_get_stride(surface);
 
-		// Paint mask
-		cairo_mask_surface(cr, masksurface, 0, 0);
-	}
-
-    // Get raw pixel data from cairo
-    data = cairo_image_surface_get_data(surface);
-    stride = cairo_image_surface_get_stride(surface);
-
-    // Create OpenImageIO ImageBuf (convert ARGB → RGBA if needed)
-	buf = new OIIO::ImageBuf(OIIO::ImageSpec(width, height, 4, OIIO::TypeDesc::UINT8));
+	// Create OpenImageIO ImageBuf (convert ARGB → RGBA if needed)
+	buf = new OIIO::ImageBuf(OIIO::ImageSpec(cairo_image_surface_get_width(surface), cairo_image_surface_get_height(surface), 4, OIIO::TypeDesc::UINT8));
 
 	// Cairo to OIIO
 	if (data != NULL) {
@@ -202,17 +152,8 @@ OIIO::ImageBuf * OIIOUtils::loadsvg(const char *filename, const double &size, co
 
 error:
 	// Free
-	if (mask)
-		cairo_destroy(mask);
-	if (masksurface)
-		cairo_surface_destroy(masksurface);
-	if (cr)
-		cairo_destroy(cr);
 	if (surface)
 		cairo_surface_destroy(surface);
 
-	if (handle != NULL)
-		g_object_unref(handle);
-
 	return buf;
 }
@@ -0,0 +1,359 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "log_i.h"
+#include "profiler.h"
+
+
+Profiler::Profiler(bool trace)
+	: trace_(trace)
+	, nbr_dropped_(0) {
+	started_at_ = now();
+}
+
+
+Profiler::~Profiler() {
+}
+
+
+Profiler * Profiler::create(bool trace) {
+	Profiler *profiler;
+
+	profiler = new Profiler(trace);
+
+	return profiler;
+}
+
+
+int64_t Profiler::now(void) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+int Profiler::threadId(void) {
+	std::thread::id id = std::this_thread::get_id();
+
+	auto it = threads_.find(id);
+
+	if (it != threads_.end())
+		return it->second;
+
+	int tid = threads_.size() + 1;
+
+	threads_[id] = tid;
+
+	return tid;
+}
+
+
+void Profiler::setThreadName(const std::string &name) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	thread_names_[threadId()] = name;
+}
+
+
+void Profiler::record(const std::string &name, int64_t begin, int64_t end, int64_t frame) {
+	size_t stage;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto it = index_.find(name);
+
+	if (it == index_.end()) {
+		stage = stages_.size();
+
+		index_[name] = stage;
+		names_.push_back(name);
+		stages_.push_back(Stage());
+	}
+	else
+		stage = it->second;
+
+	Stage &s = stages_[stage];
+
+	uint32_t duration = (uint32_t) std::min(std::max(end - begin, (int64_t) 0), (int64_t) UINT32_MAX);
+
+	s.count++;
+	s.total += duration;
+	s.max = std::max(s.max, duration);
+	s.buckets[bucket(duration)]++;
+
+	if (!trace_)
+		return;
+
+	if (events_.size() < MaxTraceEvents)
+		events_.push_back(Event { stage, threadId(), begin - started_at_, end - begin, frame });
+	else
+		nbr_dropped_++;
+}
+
+
+void Profiler::setCounter(const std::string &name, uint64_t value) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	for (auto &counter : counters_) {
+		if (counter.first == name) {
+			counter.second = value;
+			return;
+		}
+	}
+
+	counters_.push_back(std::make_pair(name, value));
+}
+
+
+int Profiler::bucket(uint32_t value) {
+	int exponent;
+
+	// Exact below SubBuckets us
+	if (value < SubBuckets)
+		return value;
+
+	exponent = 31 - __builtin_clz(value);
+
+	return (exponent - SubBucketBits + 1) * SubBuckets + ((value >> (exponent - SubBucketBits)) & (SubBuckets - 1));
+}
+
+
+uint32_t Profiler::bucketValue(int index) {
+	int exponent;
+
+	uint64_t lower, width;
+
+	if (index < SubBuckets)
+		return index;
+
+	exponent = index / SubBuckets + SubBucketBits - 1;
+
+	lower = (uint64_t) (SubBuckets + (index % SubBuckets)) << (exponent - SubBucketBits);
+	width = (uint64_t) 1 << (exponent - SubBucketBits);
+
+	// Bucket middle
+	return (uint32_t) std::min(lower + width / 2, (uint64_t) UINT32_MAX);
+}
+
+
+uint32_t Profiler::percentile(const Stage &stage, double p) {
+	uint64_t rank;
+	uint64_t count = 0;
+
+	if (stage.count == 0)
+		return 0;
+
+	// Nearest rank
+	rank = (uint64_t) ceil(p * stage.count);
+	rank = MAX(rank, 1);
+
+	for (int i=0; i<NbBuckets; i++) {
+		count += stage.buckets[i];
+
+		if (count >= rank)
+			return std::min(bucketValue(i), stage.max);
+	}
+
+	return stage.max;
+}
+
+
+std::string Profiler::escapeJSON(const std::string &str) {
+	char buf[8];
+
+	std::string result;
+
+	for (unsigned char c : str) {
+		switch (c) {
+		case '"':
+			result += "\\\"";
+			break;
+		case '\\':
+			result += "\\\\";
+			break;
+		case '\n':
+			result += "\\n";
+			break;
+		case '\r':
+			result += "\\r";
+			break;
+		case '\t':
+			result += "\\t";
+			break;
+		default:
+			if (c < 0x20) {
+				snprintf(buf, sizeof(buf), "\\u%04x", c);
+				result += buf;
+			}
+			else
+				result += c;
+			break;
+		}
+	}
+
+	return result;
+}
+
+
+std::string Profiler::escapeCSV(const std::string &str) {
+	std::string result;
+
+	if (str.find_first_of(",\"\r\n") == std::string::npos)
+		return str;
+
+	// Quoted field, quotes doubled
+	result = "\"";
+
+	for (char c : str) {
+		if (c == '"')
+			result += '"';
+		result += c;
+	}
+
+	result += "\"";
+
+	return result;
+}
+
+
+void Profiler::dump(void) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	log_notice("Render profile (ms):");
+	log_notice("  %-24s %8s %10s %8s %8s %8s %8s", "stage", "count", "total", "p50", "p95", "p99", "max");
+
+	for (size_t i=0; i<stages_.size(); i++) {
+		const Stage &stage = stages_[i];
+
+		log_notice("  %-24s %8lu %10.1f %8.2f %8.2f %8.2f %8.2f", names_[i].c_str(),
+			stage.count,
+			stage.total / 1000.0,
+			percentile(stage, 0.50) / 1000.0,
+			percentile(stage, 0.95) / 1000.0,
+			percentile(stage, 0.99) / 1000.0,
+			stage.max / 1000.0);
+	}
+
+	// Counters
+	for (auto &counter : counters_)
+		log_notice("  %-24s %8lu", counter.first.c_str(), counter.second);
+}
+
+
+bool Profiler::save(const std::string &filename) {
+	FILE *fp;
+
+	bool csv;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	csv = (filename.size() >= 4) && (filename.compare(filename.size() - 4, 4, ".csv") == 0);
+
+	if ((fp = fopen(filename.c_str(), "w")) == NULL) {
+		log_error("Can't write profile report '%s'", filename.c_str());
+		return false;
+	}
+
+	if (csv)
+		fprintf(fp, "stage,count,total_ms,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n");
+	else
+		fprintf(fp, "{\n  \"duration_ms\": %.3f,\n  \"stages\": [\n", (now() - started_at_) / 1000.0);
+
+	for (size_t i=0; i<stages_.size(); i++) {
+		const Stage &stage = stages_[i];
+
+		double total = stage.total / 1000.0;
+		double mean = (stage.count == 0) ? 0.0 : total / stage.count;
+		double max = stage.max / 1000.0;
+
+		if (csv) {
+			fprintf(fp, "%s,%lu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+				escapeCSV(names_[i]).c_str(), stage.count, total, mean,
+				percentile(stage, 0.50) / 1000.0,
+				percentile(stage, 0.95) / 1000.0,
+				percentile(stage, 0.99) / 1000.0,
+				max);
+		}
+		else {
+			fprintf(fp, "    { \"stage\": \"%s\", \"count\": %lu, \"total_ms\": %.3f, \"mean_ms\": %.3f, "
+				"\"p50_ms\": %.3f, \"p95_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f }%s\n",
+				escapeJSON(names_[i]).c_str(), stage.count, total, mean,
+				percentile(stage, 0.50) / 1000.0,
+				percentile(stage, 0.95) / 1000.0,
+				percentile(stage, 0.99) / 1000.0,
+				max,
+				(i + 1 < stages_.size()) ? "," : "");
+		}
+	}
+
+	// Counters, count column only in CSV
+	if (csv) {
+		for (auto &counter : counters_)
+			fprintf(fp, "%s,%lu,,,,,,\n", escapeCSV(counter.first).c_str(), counter.second);
+	}
+	else {
+		fprintf(fp, "  ],\n  \"counters\": {\n");
+
+		for (size_t i=0; i<counters_.size(); i++) {
+			fprintf(fp, "    \"%s\": %lu%s\n", escapeJSON(counters_[i].first).c_str(), counters_[i].second,
+				(i + 1 < counters_.size()) ? "," : "");
+		}
+
+		fprintf(fp, "  }\n}\n");
+	}
+
+	fclose(fp);
+
+	return true;
+}
+
+
+bool Profiler::saveTrace(const std::string &filename) {
+	FILE *fp;
+
+	bool first = true;
+
+	std::vector<std::string> names;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if ((fp = fopen(filename.c_str(), "w")) == NULL) {
+		log_error("Can't write profile trace '%s'", filename.c_str());
+		return false;
+	}
+
+	// Stage names, escaped once
+	for (const std::string &name : names_)
+		names.push_back(escapeJSON(name));
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+
+	// Thread names
+	for (auto &it : thread_names_) {
+		fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+			first ? "" : ",\n", it.first, escapeJSON(it.second).c_str());
+		first = false;
+	}
+
+	// Complete events
+	for (const Event &event : events_) {
+		fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%ld,\"dur\":%ld",
+			first ? "" : ",\n", names[event.stage].c_str(), event.tid, event.ts, event.dur);
+
+		if (event.frame >= 0)
+			fprintf(fp, ",\"args\":{\"frame\":%ld}", event.frame);
+
+		fprintf(fp, "}");
+		first = false;
+	}
+
+	fprintf(fp, "\n]}\n");
+
+	if (nbr_dropped_ > 0)
+		log_warn("Profile trace truncated, %lu events dropped", nbr_dropped_);
+
+	fclose(fp);
+
+	return true;
+}
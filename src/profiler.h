@@ -0,0 +1,125 @@
+#ifndef __GPX2VIDEO__PROFILER_H__
+#define __GPX2VIDEO__PROFILER_H__
+
+#include <map>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <cstdint>
+
+
+/**
+ * Render path profiler
+ *
+ * Stages (decode, widgets, blend, encode...) record their duration per
+ * frame. Report gives p50 / p95 / p99 of each stage, from a log scale
+ * histogram (fixed size, ~3% precision). Trace dumps the events in Chrome
+ * trace format (chrome://tracing, ui.perfetto.dev), up to MaxTraceEvents.
+ *
+ * Nested stages are also counted by their parent.
+ */
+class Profiler {
+public:
+	class Scope {
+	public:
+		Scope(Profiler *profiler, const std::string &name, int64_t frame=-1)
+			: profiler_(profiler)
+			, name_(profiler ? name : "")
+			, frame_(frame)
+			, begin_(profiler ? Profiler::now() : 0) {
+		}
+
+		~Scope() {
+			if (profiler_)
+				profiler_->record(name_, begin_, Profiler::now(), frame_);
+		}
+
+	private:
+		Profiler *profiler_;
+
+		std::string name_;
+
+		int64_t frame_;
+		int64_t begin_;
+	};
+
+	// Trace events kept (~40 MB), next ones are dropped
+	static const size_t MaxTraceEvents = 1000000;
+
+	virtual ~Profiler();
+
+	static Profiler * create(bool trace=false);
+
+	// Monotonic time in us
+	static int64_t now(void);
+
+	void setThreadName(const std::string &name);
+
+	void record(const std::string &name, int64_t begin, int64_t end, int64_t frame=-1);
+
+	// Cache statistics... reported with the stages
+	void setCounter(const std::string &name, uint64_t value);
+
+	void dump(void);
+
+	// CSV if filename ends with .csv, else JSON
+	bool save(const std::string &filename);
+	bool saveTrace(const std::string &filename);
+
+private:
+	// Log scale histogram: 2^SubBucketBits buckets per power of 2 (us)
+	static const int SubBucketBits = 4;
+	static const int SubBuckets = 1 << SubBucketBits;
+	static const int NbBuckets = (32 - SubBucketBits + 1) * SubBuckets;
+
+	class Stage {
+	public:
+		uint64_t count;
+		uint64_t total;
+		uint32_t max;
+		uint64_t buckets[NbBuckets];
+	};
+
+	class Event {
+	public:
+		size_t stage;
+		int tid;
+		int64_t ts;
+		int64_t dur;
+		int64_t frame;
+	};
+
+	Profiler(bool trace);
+
+	int threadId(void);
+
+	static int bucket(uint32_t value);
+	static uint32_t bucketValue(int index);
+	static uint32_t percentile(const Stage &stage, double p);
+
+	// Stage names come from the layout (widget name)
+	static std::string escapeJSON(const std::string &str);
+	static std::string escapeCSV(const std::string &str);
+
+	std::mutex mutex_;
+
+	bool trace_;
+
+	int64_t started_at_;
+
+	// Stages, in order of first record
+	std::vector<std::string> names_;
+	std::map<std::string, size_t> index_;
+	std::vector<Stage> stages_;
+
+	std::vector<Event> events_;
+	uint64_t nbr_dropped_;
+
+	std::vector<std::pair<std::string, uint64_t> > counters_;
+
+	std::map<std::thread::id, int> threads_;
+	std::map<int, std::string> thread_names_;
+};
+
+#endif
@@ -16,6 +16,7 @@
 #include "videoparams.h"
 #include "encoder.h"
 #include "widgets.h"
+#include "widgetatlas.h"
 #include "renderer.h"
 
 
@@ -48,6 +49,12 @@ bool Renderer::init(MediaContainer *container) {
 	// Media
 	container_ = container;
 
+	// Widget frames, per displayed value
+	if (rendererSettings().renderAtlasSize() > 0)
+		WidgetAtlas::setSize((size_t) rendererSettings().renderAtlasSize() * 1024 * 1024);
+	else
+		WidgetAtlas::setSize(0);
+
 	// Compute telemetry range
 	computeTelemetryRange();
 
@@ -262,6 +269,9 @@ bool Renderer::loadMap(layout::Map *m) {
 	// Map settings
 	mapSettings.setSize(width, height);
 	mapSettings.setSource((MapSettings::Source) mapsource);
+	mapSettings.setDownloadConnections(rendererSettings().mapConnections());
+	mapSettings.setDownloadRate(rendererSettings().mapRate());
+	mapSettings.setURI(rendererSettings().mapURL());
 	mapSettings.setZoom(m->zoom());
 	mapSettings.setView((MapSettings::View) view);
 	mapSettings.setDivider(m->factor());
@@ -1641,7 +1651,13 @@ void Renderer::resize(OIIO::ImageBuf *buf, int width, int height) {
 	if ((width == spec.width) && (height == spec.height))
 		return;
 
-	OIIO::ImageBuf out(OIIO::ImageSpec(width, height, spec.nchannels, type));
+	OIIO::ImageSpec outspec(width, height, spec.nchannels, type);
+
+	// Keep channels order (BGRA widget bitmap)
+	outspec.channelnames = spec.channelnames;
+	outspec.alpha_channel = spec.alpha_channel;
+
+	OIIO::ImageBuf out(outspec);
 	OIIO::ImageBufAlgo::resize(out, *buf);
 
 	*buf = out;
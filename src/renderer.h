@@ -49,7 +49,24 @@ public:
 		, video_crf_(video_crf)
 		, video_bit_rate_(video_bit_rate)
 		, video_min_bit_rate_(video_min_bit_rate)
-		, video_max_bit_rate_(video_max_bit_rate) {
+		, video_max_bit_rate_(video_max_bit_rate)
+		, audio_copy_(true)
+		, render_threads_(0)
+		, render_scale_threads_(0)
+		, render_queue_size_(4)
+		, render_yuv_(false)
+		, render_overlay_(false)
+		, render_profile_("")
+		, render_trace_("")
+		, render_atlas_size_(64)
+		, render_segments_(1)
+		, render_segment_(false)
+		, render_segment_from_(0)
+		, render_segment_to_(0)
+		, render_segment_real_(0)
+		, map_connections_(4)
+		, map_rate_(10)
+		, map_url_("") {
 	}
 	virtual ~RendererSettings() {
 	}
@@ -102,6 +119,133 @@ public:
 		return video_max_bit_rate_;
 	}
 
+	const bool& audioCopy(void) const {
+		return audio_copy_;
+	}
+
+	void setAudioCopy(const bool &enable) {
+		audio_copy_ = enable;
+	}
+
+	const int& renderThreads(void) const {
+		return render_threads_;
+	}
+
+	void setRenderThreads(const int &threads) {
+		render_threads_ = threads;
+	}
+
+	const int& renderScaleThreads(void) const {
+		return render_scale_threads_;
+	}
+
+	void setRenderScaleThreads(const int &threads) {
+		render_scale_threads_ = threads;
+	}
+
+	const int& renderQueueSize(void) const {
+		return render_queue_size_;
+	}
+
+	void setRenderQueueSize(const int &size) {
+		render_queue_size_ = size;
+	}
+
+	const bool& renderYUV(void) const {
+		return render_yuv_;
+	}
+
+	void setRenderYUV(const bool &enable) {
+		render_yuv_ = enable;
+	}
+
+	const bool& renderOverlay(void) const {
+		return render_overlay_;
+	}
+
+	void setRenderOverlay(const bool &enable) {
+		render_overlay_ = enable;
+	}
+
+	const std::string& renderProfile(void) const {
+		return render_profile_;
+	}
+
+	void setRenderProfile(const std::string &filename) {
+		render_profile_ = filename;
+	}
+
+	const std::string& renderTrace(void) const {
+		return render_trace_;
+	}
+
+	void setRenderTrace(const std::string &filename) {
+		render_trace_ = filename;
+	}
+
+	const int& renderAtlasSize(void) const {
+		return render_atlas_size_;
+	}
+
+	void setRenderAtlasSize(const int &size) {
+		render_atlas_size_ = size;
+	}
+
+	const int& renderSegments(void) const {
+		return render_segments_;
+	}
+
+	void setRenderSegments(const int &segments) {
+		render_segments_ = segments;
+	}
+
+	const bool& isRenderSegment(void) const {
+		return render_segment_;
+	}
+
+	const uint64_t& renderSegmentFrom(void) const {
+		return render_segment_from_;
+	}
+
+	const uint64_t& renderSegmentTo(void) const {
+		return render_segment_to_;
+	}
+
+	const uint64_t& renderSegmentReal(void) const {
+		return render_segment_real_;
+	}
+
+	void setRenderSegment(const uint64_t &from, const uint64_t &to, const uint64_t &real) {
+		render_segment_ = true;
+		render_segment_from_ = from;
+		render_segment_to_ = to;
+		render_segment_real_ = real;
+	}
+
+	const int& mapConnections(void) const {
+		return map_connections_;
+	}
+
+	void setMapConnections(const int &connections) {
+		map_connections_ = connections;
+	}
+
+	const int& mapRate(void) const {
+		return map_rate_;
+	}
+
+	void setMapRate(const int &rate) {
+		map_rate_ = rate;
+	}
+
+	const std::string& mapURL(void) const {
+		return map_url_;
+	}
+
+	void setMapURL(const std::string &url) {
+		map_url_ = url;
+	}
+
 private:
 	std::string media_file_;
 	std::string layout_file_;
@@ -116,6 +260,44 @@ private:
 	int64_t video_bit_rate_;
 	int64_t video_min_bit_rate_;
 	int64_t video_max_bit_rate_;
+
+	// Copy input audio packets (AAC encoded if output can't carry them)
+	bool audio_copy_;
+
+	// Pipeline: 0 => auto
+	int render_threads_;
+	int render_scale_threads_;
+	int render_queue_size_;
+
+	// Blend widgets in native YUV frames
+	bool render_yuv_;
+
+	// Render only widgets, on a transparent background
+	bool render_overlay_;
+
+	// Per stage timings report (JSON or CSV) & Chrome trace
+	std::string render_profile_;
+	std::string render_trace_;
+
+	// Widget frame atlas budget (MB), 0 => disabled
+	int render_atlas_size_;
+
+	// Split video in segments rendered in parallel
+	int render_segments_;
+
+	// Render only a segment [from:to[ (video time in ms, to = 0 => end),
+	// real time elapsed at the segment start (ms, time factor applied)
+	bool render_segment_;
+	uint64_t render_segment_from_;
+	uint64_t render_segment_to_;
+	uint64_t render_segment_real_;
+
+	// Map tiles download: parallel transfers & requests per second
+	int map_connections_;
+	int map_rate_;
+
+	// Map tiles server override
+	std::string map_url_;
 };
 
 
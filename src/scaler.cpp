@@ -0,0 +1,265 @@
+#include <iostream>
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/mem.h>
+}
+
+#include "log_i.h"
+#include "scaler.h"
+
+
+Scaler::Scaler(int nb_threads)
+	: nb_threads_(nb_threads)
+	, width_(0)
+	, height_(0)
+	, src_fmt_(AV_PIX_FMT_NONE)
+	, dst_fmt_(AV_PIX_FMT_NONE)
+	, flags_(0)
+	, src_(NULL)
+	, src_linesize_(NULL)
+	, dst_(NULL)
+	, dst_linesize_(NULL)
+	, queue_(MaxThreads)
+	, nb_pending_(0) {
+}
+
+
+Scaler::~Scaler() {
+	queue_.close();
+
+	for (std::thread *thread : threads_) {
+		thread->join();
+		delete thread;
+	}
+
+	threads_.clear();
+
+	freeBands();
+}
+
+
+Scaler * Scaler::create(int nb_threads) {
+	Scaler *scaler;
+
+	if (nb_threads <= 0)
+		nb_threads = std::min((int) AutoThreads, (int) std::max(1u, std::thread::hardware_concurrency()));
+
+	nb_threads = std::min(nb_threads, (int) MaxThreads);
+
+	scaler = new Scaler(nb_threads);
+
+	// Caller thread converts a band too
+	for (int i=1; i<nb_threads; i++) {
+		scaler->threads_.push_back(new std::thread([scaler] {
+			scaler->run();
+		}));
+	}
+
+	return scaler;
+}
+
+
+void Scaler::freeBands(void) {
+	for (Band &band : bands_) {
+		sws_freeContext(band.ctx);
+		av_freep(&band.data[0]);
+	}
+
+	bands_.clear();
+}
+
+
+const int& Scaler::threads(void) const {
+	return nb_threads_;
+}
+
+
+bool Scaler::isSplittable(AVPixelFormat fmt) {
+	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+
+	if (desc == NULL)
+		return false;
+
+	return !(desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM));
+}
+
+
+void Scaler::offsetPlanes(AVPixelFormat fmt, int y, const uint8_t * const planes[],
+		const int linesize[], uint8_t *data[4]) {
+	int nb_planes = av_pix_fmt_count_planes(fmt);
+
+	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+
+	for (int i=0; i<4; i++) {
+		// Chroma planes are subsampled
+		int shift = ((i == 1) || (i == 2)) ? desc->log2_chroma_h : 0;
+
+		if ((i < nb_planes) && (planes[i] != NULL))
+			data[i] = (uint8_t *) planes[i] + (ptrdiff_t) (y >> shift) * linesize[i];
+		else
+			data[i] = NULL;
+	}
+}
+
+
+bool Scaler::init(int width, int height, AVPixelFormat src_fmt, AVPixelFormat dst_fmt, int flags) {
+	int nb_bands;
+	int band_height;
+
+	if ((width == width_) && (height == height_) && (src_fmt == src_fmt_) && (dst_fmt == dst_fmt_)
+		&& (flags == flags_) && !bands_.empty())
+		return true;
+
+	freeBands();
+
+	width_ = width;
+	height_ = height;
+	src_fmt_ = src_fmt;
+	dst_fmt_ = dst_fmt;
+	flags_ = flags;
+
+	// Bands height, aligned
+	nb_bands = nb_threads_;
+
+	if (!isSplittable(src_fmt) || !isSplittable(dst_fmt))
+		nb_bands = 1;
+
+	band_height = (height + nb_bands - 1) / nb_bands;
+	band_height = (band_height + BandAlign - 1) / BandAlign * BandAlign;
+
+	for (int y=0; y<height; y+=band_height) {
+		Band band;
+
+		band.y = y;
+		band.height = std::min(band_height, height - y);
+		band.result = 0;
+
+		band.src_y = (nb_bands > 1) ? std::max(0, y - BandOverlap) : y;
+		band.src_height = (nb_bands > 1) ? std::min(height, y + band.height + BandOverlap) - band.src_y : band.height;
+
+		for (int i=0; i<4; i++) {
+			band.data[i] = NULL;
+			band.linesize[i] = 0;
+		}
+
+		band.ctx = sws_getContext(width, band.src_height, src_fmt,
+			width, band.src_height, dst_fmt,
+			flags, NULL, NULL, NULL);
+
+		if (band.ctx == NULL) {
+			log_error("Scaler fails to create scale context");
+			goto error;
+		}
+
+		bands_.push_back(band);
+
+		if ((nb_bands > 1) && (av_image_alloc(bands_.back().data, bands_.back().linesize,
+				width, band.src_height, dst_fmt, 64) < 0)) {
+			log_error("Scaler fails to allocate band buffer");
+			goto error;
+		}
+	}
+
+	log_info("Scaler: %s => %s, %dx%d in %lu band(s)",
+		av_get_pix_fmt_name(src_fmt), av_get_pix_fmt_name(dst_fmt),
+		width, height, bands_.size());
+
+	return !bands_.empty();
+
+error:
+	freeBands();
+
+	return false;
+}
+
+
+void Scaler::scaleBand(Band &band) {
+	uint8_t *src[4];
+	uint8_t *dst[4];
+	uint8_t *data[4];
+
+	offsetPlanes(src_fmt_, band.src_y, src_, src_linesize_, src);
+	offsetPlanes(dst_fmt_, band.y, dst_, dst_linesize_, dst);
+
+	// One band, in place
+	if (band.data[0] == NULL) {
+		band.result = sws_scale(band.ctx,
+			(const uint8_t * const *) src, src_linesize_,
+			0, band.src_height,
+			dst, dst_linesize_);
+
+		return;
+	}
+
+	band.result = sws_scale(band.ctx,
+		(const uint8_t * const *) src, src_linesize_,
+		0, band.src_height,
+		band.data, band.linesize);
+
+	if (band.result < 0)
+		return;
+
+	// Drop the overlap rows
+	offsetPlanes(dst_fmt_, band.y - band.src_y, band.data, band.linesize, data);
+
+	av_image_copy(dst, dst_linesize_, (const uint8_t **) data, band.linesize,
+		dst_fmt_, width_, band.height);
+}
+
+
+void Scaler::run(void) {
+	int index;
+
+	while (queue_.pop(index)) {
+		scaleBand(bands_[index]);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if (--nb_pending_ == 0)
+			cond_done_.notify_one();
+	}
+}
+
+
+int Scaler::scale(const uint8_t * const src[], const int src_linesize[],
+		uint8_t * const dst[], const int dst_linesize[]) {
+	if (bands_.empty())
+		return -1;
+
+	src_ = src;
+	src_linesize_ = src_linesize;
+	dst_ = dst;
+	dst_linesize_ = dst_linesize;
+
+	// Other bands to the workers
+	if (bands_.size() > 1) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			nb_pending_ = bands_.size() - 1;
+		}
+
+		for (size_t i=1; i<bands_.size(); i++)
+			queue_.push(i);
+	}
+
+	scaleBand(bands_[0]);
+
+	if (bands_.size() > 1) {
+		std::unique_lock<std::mutex> lock(mutex_);
+
+		cond_done_.wait(lock, [this] {
+			return (nb_pending_ == 0);
+		});
+	}
+
+	for (Band &band : bands_) {
+		if (band.result < 0)
+			return band.result;
+	}
+
+	return height_;
+}
@@ -0,0 +1,108 @@
+#ifndef __GPX2VIDEO__SCALER_H__
+#define __GPX2VIDEO__SCALER_H__
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+#include "workqueue.h"
+
+
+/**
+ * Threaded pixel format conversion
+ *
+ * Frame is split in horizontal bands, each band is converted by its own
+ * swscale context, in parallel. Vertical filters (chroma subsampling) read
+ * rows across the band edges, so each context converts BandOverlap more
+ * rows on both sides to its own buffer, only the band rows are copied out.
+ * Output is the same as a whole frame conversion.
+ *
+ * Caller converts the first band, the workers the others. A scaler is
+ * used by one thread at once.
+ */
+class Scaler {
+public:
+	virtual ~Scaler();
+
+	// 0 => auto
+	static Scaler * create(int nb_threads=0);
+
+	const int& threads(void) const;
+
+	// (Re)configure conversion, nothing done if unchanged
+	bool init(int width, int height, AVPixelFormat src_fmt, AVPixelFormat dst_fmt, int flags=SWS_FAST_BILINEAR);
+
+	// Convert whole frame, returns the output height or a negative value
+	int scale(const uint8_t * const src[], const int src_linesize[],
+		uint8_t * const dst[], const int dst_linesize[]);
+
+	// Band height alignment (chroma subsampling)
+	static const int BandAlign = 16;
+
+	// Rows converted past each band edge (filter support, dither aligned)
+	static const int BandOverlap = 16;
+
+	static const int AutoThreads = 4;
+	static const int MaxThreads = 16;
+
+private:
+	class Band {
+	public:
+		SwsContext *ctx;
+
+		int y;
+		int height;
+
+		// Source rows, with overlap
+		int src_y;
+		int src_height;
+
+		// Band output, NULL if converted in place (one band)
+		uint8_t *data[4];
+		int linesize[4];
+
+		int result;
+	};
+
+	Scaler(int nb_threads);
+
+	void run(void);
+	void scaleBand(Band &band);
+	void freeBands(void);
+
+	static bool isSplittable(AVPixelFormat fmt);
+	static void offsetPlanes(AVPixelFormat fmt, int y, const uint8_t * const planes[],
+		const int linesize[], uint8_t *data[4]);
+
+	int nb_threads_;
+
+	int width_;
+	int height_;
+	AVPixelFormat src_fmt_;
+	AVPixelFormat dst_fmt_;
+	int flags_;
+
+	std::vector<Band> bands_;
+
+	// Current frame
+	const uint8_t * const *src_;
+	const int *src_linesize_;
+	uint8_t * const *dst_;
+	const int *dst_linesize_;
+
+	// Workers
+	std::vector<std::thread *> threads_;
+	WorkQueue<int> queue_;
+
+	std::mutex mutex_;
+	std::condition_variable cond_done_;
+	int nb_pending_;
+};
+
+#endif
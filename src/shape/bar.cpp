@@ -2,6 +2,7 @@
 #include <pango/pangocairo.h>
 
 #include "../log_i.h"
+#include "../iconcache.h"
 #include "bar.h"
 
 
@@ -378,19 +379,8 @@ void BarShape::needle(cairo_t *cr, VideoWidget::Theme::NeedleType type,
 
 
 void BarShape::icon(cairo_t *cr, double v, const std::string &filename, const float *fill) {
-	bool apply_color;
-
 	struct BarShape::point p;
 
-    GError *error = NULL;
-
-	cairo_t *mask = NULL;
-	cairo_surface_t *surface = NULL;
-
-	RsvgRectangle viewport;
-
-	RsvgHandle *handle = NULL;
-
 	double size;
 	double border;
 	double needlesize;
@@ -399,17 +389,6 @@ void BarShape::icon(cairo_t *cr, double v, const std::string &filename, const fl
 	if (filename.empty())
 		return;
 
-	// Set color
-	apply_color = (fill != NULL) && (fill[3] != 0);
-
-	// load svg data
-	handle = rsvg_handle_new_from_file(filename.c_str(), &error);
-    if (!handle) {
-        log_error("Load svn image failure: %s", error->message);
-        g_error_free(error);
-        return;
-    }
-
 	// Scaling
 	border = size2pixels(theme().needleBorder()) / 2.0;
 	distance = size2pixels(theme().needleDistance());
@@ -427,40 +406,8 @@ void BarShape::icon(cairo_t *cr, double v, const std::string &filename, const fl
 	else
 		p.y  = p.y - (size / 2) - needlesize - border - distance;
 
-	if (apply_color) {
-		// Create alpha only surface
-		surface = cairo_image_surface_create(CAIRO_FORMAT_A8, theme().width(), theme().height());
-
-		// Create mask
-		mask = cairo_create(surface);
-	}
-
-	// Render svg into cairo surface
-	viewport = (RsvgRectangle) {
-		.x = (double) p.x - (size / 2),
-		.y = (double) p.y - (size / 2),
-		.width = (double) size,
-		.height = (double) size
-	};
-
-	rsvg_handle_render_document(handle, apply_color ? mask : cr, &viewport, NULL);
-
-	if (apply_color) {
-		// Apply color
-		cairo_set_source_rgba(cr, fill[0], fill[1], fill[2], fill[3]);
-
-		// Paint mask
-		cairo_mask_surface(cr, surface, 0, 0);
-	}
-
-	// Free
-	if (surface)
-		cairo_surface_destroy(surface);
-	if (mask)
-		cairo_destroy(mask);
-
-	if (handle != NULL)
-		g_object_unref(handle);
+	// Rasterized svg, cached
+	IconCache::draw(cr, filename, p.x - (size / 2), p.y - (size / 2), size, size, fill);
 }
 
 
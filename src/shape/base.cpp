@@ -1,10 +1,50 @@
+#include <cmath>
+
 #include "../log_i.h"
+#include "../blend.h"
+#include "../widgetatlas.h"
 #include "base.h"
 
 
 void ShapeBase::createBox(OIIO::ImageBuf **buf, int width, int height) {
-	// Create an image buffer with static render
-	*buf = new OIIO::ImageBuf(OIIO::ImageSpec(width, height, 4, OIIO::TypeDesc::UINT8));
+	size_t size = (size_t) width * height * 4;
+
+	// Reuse the bitmap, unless the renderer resized or rotated it (own pixels)
+	if (*buf != NULL) {
+		const OIIO::ImageSpec &spec = (*buf)->spec();
+
+		if ((spec.width == width) && (spec.height == height) && !pixels_.empty()
+			&& ((*buf)->localpixels() == pixels_.data()))
+			return;
+
+		delete *buf;
+	}
+
+	// Grow pixels, surface on the previous ones is obsolete
+	if (pixels_.size() < size) {
+		if (target_ != NULL)
+			cairo_surface_destroy(target_);
+
+		target_ = NULL;
+
+		pixels_.resize(size);
+	}
+
+	// Image buffer with static render, on the shape pixels
+	*buf = new OIIO::ImageBuf(boxSpec(width, height), pixels_.data());
+}
+
+
+OIIO::ImageSpec ShapeBase::boxSpec(int width, int height) {
+	OIIO::ImageSpec spec(width, height, 4, OIIO::TypeDesc::UINT8);
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	// Cairo ARGB32 pixels, as stored in memory
+	spec.channelnames = { "B", "G", "R", "A" };
+	spec.alpha_channel = 3;
+#endif
+
+	return spec;
 }
 
 
@@ -91,6 +131,15 @@ void ShapeBase::drawImage(OIIO::ImageBuf *buf, int x, int y, const char *name, V
 		outbuf = OIIO::ImageBufAlgo::channels(outbuf, 4, channelorder, channelvalues, channelnames);
 	}
 
+	// Same channel order as the bitmap
+	if (Blend::isBGRA(buf->spec())) {
+		int channelorder[] = { 2, 1, 0, 3 };
+		float channelvalues[] = { };
+		std::string channelnames[] = { "B", "G", "R", "A" };
+
+		outbuf = OIIO::ImageBufAlgo::channels(outbuf, 4, channelorder, channelvalues, channelnames);
+	}
+
 	// Image over
 	outbuf.specmod().x = x;
 	outbuf.specmod().y = y;
@@ -101,11 +150,35 @@ void ShapeBase::drawImage(OIIO::ImageBuf *buf, int x, int y, const char *name, V
 
 
 cairo_t * ShapeBase::createCairoContext(OIIO::ImageBuf *buf) {
-	// Create the cairo destination surface
-	cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, buf->spec().width, buf->spec().height);
+	int width = buf->spec().width;
+	int height = buf->spec().height;
+
+	unsigned char *data = (unsigned char *) buf->localpixels();
+
+	// Bitmap memory moved (new buffer, resized...)
+	if ((target_ != NULL) && ((cairo_image_surface_get_data(target_) != data)
+			|| (cairo_image_surface_get_width(target_) != width)
+			|| (cairo_image_surface_get_height(target_) != height))) {
+		cairo_surface_destroy(target_);
+		target_ = NULL;
+	}
+
+	// Create the cairo destination surface on the bitmap pixels
+	if (target_ == NULL) {
+		if ((data != NULL) && (cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width) == width * 4))
+			target_ = cairo_image_surface_create_for_data(data, CAIRO_FORMAT_ARGB32, width, height, width * 4);
+		else
+			target_ = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+	}
 
 	// Cairo context
-	cairo_t *cairo = cairo_create(surface);
+	cairo_t *cairo = cairo_create(target_);
+
+	// Previous frame
+	cairo_save(cairo);
+	cairo_set_operator(cairo, CAIRO_OPERATOR_CLEAR);
+	cairo_paint(cairo);
+	cairo_restore(cairo);
 
 	return cairo;
 }
@@ -117,11 +190,13 @@ void ShapeBase::renderCairoContext(OIIO::ImageBuf *buf, cairo_t *cairo) {
 
 	cairo_surface_t *surface = cairo_get_target(cairo);
 
+	cairo_surface_flush(surface);
+
 	data = cairo_image_surface_get_data(surface);
 	stride = cairo_image_surface_get_stride(surface);
 
-	// Cairo to OIIO
-	if (data != NULL) {
+	// Cairo to OIIO, only if cairo can't draw in the bitmap
+	if ((data != NULL) && (data != buf->localpixels())) {
 		buf->set_pixels(OIIO::ROI(),
 			buf->spec().format,
 			data, 
@@ -129,12 +204,14 @@ void ShapeBase::renderCairoContext(OIIO::ImageBuf *buf, cairo_t *cairo) {
 			stride);
 	}
 
-	// BGRA => RGBA
-	int channelorder[] = { 2, 1, 0, 3 };
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	// ARGB => RGBA
+	int channelorder[] = { 1, 2, 3, 0 };
 	float channelvalues[] = { };
-	std::string channelnames[] = { "B", "G", "R", "A" };
+	std::string channelnames[] = { "R", "G", "B", "A" };
 
 	OIIO::ImageBufAlgo::channels(*buf, *buf, 4, channelorder, channelvalues, channelnames);
+#endif
 }
 
 
@@ -143,7 +220,8 @@ void ShapeBase::destroyCairoContext(cairo_t *cairo) {
 
 	cairo_destroy(cairo);
 
-	if (surface != NULL)
+	// Keep the persistent surface
+	if ((surface != NULL) && (surface != target_))
 		cairo_surface_destroy(surface);
 }
 
@@ -167,21 +245,98 @@ void ShapeBase::saveCairoSurface(cairo_t *cairo) {
 	cairo_paint(cr);
 	cairo_destroy(cr);
 
-	surface_ = dst;
+	if (layers_[LayerBackground] != NULL)
+		cairo_surface_destroy(layers_[LayerBackground]);
+
+	layers_[LayerBackground] = dst;
 }
 
 
-bool ShapeBase::restoreCairoSurface(cairo_t *cairo) {
-	if (surface_ == NULL)
+bool ShapeBase::restoreCairoSurface(cairo_t *cairo, ShapeBase::Layer layer) {
+	if (layers_[layer] == NULL)
 		return false;
 
-	cairo_set_source_surface(cairo, surface_, 0, 0);
+	cairo_save(cairo);
+	cairo_set_source_surface(cairo, layers_[layer], 0, 0);
 	cairo_paint(cairo);
+	cairo_restore(cairo);
+
+	return true;
+}
+
+
+cairo_t * ShapeBase::createLayerContext(cairo_t *cairo) {
+	cairo_t *cr;
+
+	cairo_surface_t *src, *dst;
+
+	src = cairo_get_target(cairo);
+
+	// Transparent surface, same size
+	dst = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+		cairo_image_surface_get_width(src),
+		cairo_image_surface_get_height(src));
+
+	cr = cairo_create(dst);
+
+	// Context keeps the surface
+	cairo_surface_destroy(dst);
+
+	return cr;
+}
+
+
+void ShapeBase::saveLayerContext(cairo_t *cairo, cairo_t *layer) {
+	cairo_surface_t *surface = cairo_get_target(layer);
+
+	cairo_surface_flush(surface);
+
+	if (layers_[LayerForeground] != NULL)
+		cairo_surface_destroy(layers_[LayerForeground]);
+
+	layers_[LayerForeground] = cairo_surface_reference(surface);
+
+	cairo_destroy(layer);
+
+	// Paint layer
+	restoreCairoSurface(cairo, LayerForeground);
+}
+
+
+void ShapeBase::clearLayers(void) {
+	for (int i=0; i<LayerCount; i++) {
+		if (layers_[i] != NULL)
+			cairo_surface_destroy(layers_[i]);
+
+		layers_[i] = NULL;
+	}
+}
+
+
+bool ShapeBase::loadFrame(OIIO::ImageBuf *buf, const std::string &key) {
+	if (!WidgetAtlas::load(this, key, buf))
+		return false;
+
+	frame_key_ = key;
 
 	return true;
 }
 
 
+void ShapeBase::saveFrame(OIIO::ImageBuf *buf, const std::string &key) {
+	WidgetAtlas::save(this, key, buf);
+
+	frame_key_ = key;
+}
+
+
+void ShapeBase::clearFrames(void) {
+	WidgetAtlas::drop(this);
+
+	frame_key_.clear();
+}
+
+
 void ShapeBase::background(cairo_t *cr, double radius) {
 	int x, y;
 	int width, height;
@@ -225,12 +380,32 @@ void ShapeBase::background(cairo_t *cr, double radius) {
 }
 
 
-void ShapeBase::text(cairo_t *cr, int x, int y, ShapeBase::Font &font, 
-		const float *fill, const float *outline, const char *text) {
+PangoLayout * ShapeBase::layout(cairo_t *cr, const ShapeBase::Font &font, std::string &key) {
 	PangoLayout *layout;
 
 	PangoFontDescription *desc;
 
+	double size = fontsize2pixels(font.size);
+
+	// Font key
+	key = font.family
+		+ "/" + std::to_string((int) font.style)
+		+ "/" + std::to_string((int) font.weight)
+		+ "/" + std::to_string(size)
+		+ "/" + std::to_string((int) font.align)
+		+ "/" + std::to_string(font.linespace);
+
+	auto it = layouts_.find(key);
+
+	if (it != layouts_.end()) {
+		layout = it->second;
+
+		// Follow cairo context (font options, matrix)
+		pango_cairo_update_layout(cr, layout);
+
+		return layout;
+	}
+
 	// Pango layout
 	layout = pango_cairo_create_layout(cr);
 
@@ -242,7 +417,7 @@ void ShapeBase::text(cairo_t *cr, int x, int y, ShapeBase::Font &font,
 	pango_font_description_set_weight(desc, (PangoWeight) font.weight);
 	pango_font_description_set_stretch(desc, PANGO_STRETCH_NORMAL);
 //	pango_font_description_set_size(desc, fontsize * PANGO_SCALE);
-	pango_font_description_set_absolute_size(desc, fontsize2pixels(font.size));
+	pango_font_description_set_absolute_size(desc, size);
 
 //	// Linespace
 //	if (linespace > 0) {
@@ -252,11 +427,23 @@ void ShapeBase::text(cairo_t *cr, int x, int y, ShapeBase::Font &font,
 //		pango_layout_set_attributs(layout, attrs);
 //	}
 
-	// Draw text into layout
+	// Text properties
 	pango_layout_set_alignment(layout, (PangoAlignment) font.align);
 	pango_layout_set_spacing(layout, 0);
 	pango_layout_set_line_spacing(layout, font.linespace);
 	pango_layout_set_font_description(layout, desc);
+
+	pango_font_description_free(desc);
+
+	layouts_[key] = layout;
+
+	return layout;
+}
+
+
+void ShapeBase::drawText(cairo_t *cr, PangoLayout *layout, int x, int y, ShapeBase::Font &font, 
+		const float *fill, const float *outline, const char *text) {
+	// Draw text into layout
 	pango_layout_set_text(layout, text, -1);
 
 	// Apply shadow effect
@@ -285,51 +472,142 @@ void ShapeBase::text(cairo_t *cr, int x, int y, ShapeBase::Font &font,
 	}
 	cairo_stroke(cr);
 	cairo_restore(cr);
+}
+
+
+ShapeBase::TextRun * ShapeBase::textRun(cairo_t *cr, ShapeBase::Font &font,
+		const float *fill, const float *outline, const char *text) {
+	int pad;
+	int shadow;
+	int width, height;
+
+	cairo_t *cairo;
+
+	std::string key;
+
+	PangoLayout *layout;
+
+	PangoRectangle ink;
+
+	TextRun run;
+
+	layout = this->layout(cr, font, key);
+
+	// Text key
+	key += "/" + std::to_string(font.border)
+		+ "/" + std::to_string(font.shadow_opacity)
+		+ "/" + std::to_string(font.shadow_distance)
+		+ "/" + VideoWidget::Theme::color2hex(fill)
+		+ "/" + ((outline != NULL) ? VideoWidget::Theme::color2hex(outline) : "")
+		+ "/" + text;
+
+	auto it = text_runs_.find(key);
+
+	if (it != text_runs_.end()) {
+		// Most recently used
+		text_lru_.splice(text_lru_.begin(), text_lru_, it->second.lru);
+
+		return &it->second;
+	}
+
+	// Text area, with border & shadow
+	pango_layout_set_text(layout, text, -1);
+	pango_layout_get_pixel_extents(layout, &ink, NULL);
+
+	pad = (font.border > 0) ? ceil(font.border * fontsize2pixels(font.size) / 100000.0) + 2 : 2;
+	shadow = (font.shadow_distance > 0) ? ceil(shadow2pixels(font)) : 0;
+
+	width = ink.width + 2 * pad + shadow;
+	height = ink.height + 2 * pad + shadow;
+
+	run.x = ink.x - pad;
+	run.y = ink.y - pad;
+	run.size = width * height * 4;
+	run.surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, MAX(width, 1), MAX(height, 1));
+
+	// Render text once
+	cairo = cairo_create(run.surface);
+	pango_cairo_update_layout(cairo, layout);
+	drawText(cairo, layout, -run.x, -run.y, font, fill, outline, text);
+	cairo_destroy(cairo);
+
+	cairo_surface_flush(run.surface);
+
+	pango_cairo_update_layout(cr, layout);
+
+	// Drop least recently used texts
+	while (!text_lru_.empty() && (text_cache_size_ + run.size > TextCacheSize)) {
+		auto last = text_runs_.find(text_lru_.back());
+
+		text_cache_size_ -= last->second.size;
+		cairo_surface_destroy(last->second.surface);
+
+		text_runs_.erase(last);
+		text_lru_.pop_back();
+	}
+
+	text_lru_.push_front(key);
+	run.lru = text_lru_.begin();
+
+	text_cache_size_ += run.size;
+
+	return &(text_runs_[key] = run);
+}
+
+
+void ShapeBase::clearTextCache(void) {
+	for (auto &it : layouts_)
+		g_object_unref(it.second);
+
+	for (auto &it : text_runs_)
+		cairo_surface_destroy(it.second.surface);
+
+	layouts_.clear();
+	dummies_.clear();
+
+	text_runs_.clear();
+	text_lru_.clear();
+	text_cache_size_ = 0;
+}
 
-	pango_font_description_free(desc);
 
-	g_object_unref(layout);
+void ShapeBase::text(cairo_t *cr, int x, int y, ShapeBase::Font &font, 
+		const float *fill, const float *outline, const char *text) {
+	std::string key;
+
+	cairo_matrix_t matrix;
+
+	TextRun *run;
+
+	cairo_get_matrix(cr, &matrix);
+
+	// Rendered text is reused on pixel aligned positions only
+	if ((matrix.xx != 1.0) || (matrix.yy != 1.0) || (matrix.xy != 0.0) || (matrix.yx != 0.0)
+		|| (matrix.x0 != floor(matrix.x0)) || (matrix.y0 != floor(matrix.y0))) {
+		drawText(cr, layout(cr, font, key), x, y, font, fill, outline, text);
+		return;
+	}
+
+	run = textRun(cr, font, fill, outline, text);
+
+	cairo_save(cr);
+	cairo_set_source_surface(cr, run->surface, x + run->x, y + run->y);
+	cairo_paint(cr);
+	cairo_restore(cr);
 }
 
 
 void ShapeBase::extents(cairo_t *cr, ShapeBase::Font &font, ShapeBase::TextType type, const char *text,
 		int &x, int &y, int &width, int &height) {
+	std::string key;
 	std::string dummy;
    
 	PangoLayout *layout;
 
-	PangoFontDescription *desc;
-
 	PangoRectangle rectangle;
 
-	// Alpha / Numeric
-	dummy = 
-		"0123456789";
-
-	if (type == ShapeBase::TextAlpha) {
-		dummy += 
-			"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-			"abcdefghijklmnopqrstuvwxyz";
-	}
-
 	// Pango layout
-	layout = pango_cairo_create_layout(cr);
-
-	// Font loading
-	desc = pango_font_description_new();
-	pango_font_description_set_family(desc, font.family.c_str());
-	pango_font_description_set_style(desc, (PangoStyle) font.style);
-	pango_font_description_set_variant(desc, PANGO_VARIANT_NORMAL);
-	pango_font_description_set_weight(desc, (PangoWeight) font.weight);
-	pango_font_description_set_stretch(desc, PANGO_STRETCH_NORMAL);
-//	pango_font_description_set_size(desc, fontsize * PANGO_SCALE);
-	pango_font_description_set_absolute_size(desc, fontsize2pixels(font.size));
-
-	// Text properties
-	pango_layout_set_alignment(layout, (PangoAlignment) font.align);
-	pango_layout_set_spacing(layout, 0);
-	pango_layout_set_line_spacing(layout, font.linespace);
-	pango_layout_set_font_description(layout, desc);
+	layout = this->layout(cr, font, key);
 
 	// Get text size
 	pango_layout_set_text(layout, text, -1);
@@ -342,18 +620,34 @@ void ShapeBase::extents(cairo_t *cr, ShapeBase::Font &font, ShapeBase::TextType
 	height = rectangle.height;
 
 	if (type != ShapeBase::TextMultiLine) {
-		// Get dummy size
-		pango_layout_set_text(layout, dummy.c_str(), -1);
-		pango_layout_get_pixel_extents(layout, &rectangle, NULL);
+		key += (type == ShapeBase::TextAlpha) ? "/alpha" : "/numeric";
+
+		auto it = dummies_.find(key);
+
+		if (it == dummies_.end()) {
+			// Alpha / Numeric
+			dummy = 
+				"0123456789";
+
+			if (type == ShapeBase::TextAlpha) {
+				dummy += 
+					"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+					"abcdefghijklmnopqrstuvwxyz";
+			}
+
+			// Get dummy size
+			pango_layout_set_text(layout, dummy.c_str(), -1);
+			pango_layout_get_pixel_extents(layout, &rectangle, NULL);
+
+			dummies_[key] = rectangle;
+		}
+		else
+			rectangle = it->second;
 
 		// Return dummy position & size
 		y = (rectangle.y - 1);
 		height = rectangle.height;
 	}
-
-	pango_font_description_free(desc);
-
-	g_object_unref(layout);
 }
 
 void ShapeBase::xmlwrite(std::ostream &os) {
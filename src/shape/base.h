@@ -1,6 +1,11 @@
 #ifndef __GPX2VIDEO__SHAPE__BASE_H__
 #define __GPX2VIDEO__SHAPE__BASE_H__
 
+#include <map>
+#include <list>
+#include <string>
+#include <vector>
+
 #include <pango/pangocairo.h>
 
 #include "../utils.h"
@@ -22,6 +27,14 @@ public:
 		FeatureUnknown
 	};
 
+	// Static layers, under & over the dynamic parts
+	enum Layer {
+		LayerBackground,
+		LayerForeground,
+
+		LayerCount
+	};
+
 	enum TextType {
 		TextAlpha,
 		TextNumeric,
@@ -77,6 +90,12 @@ public:
 		size_factor_ /= 100.0;
 		fontsize_factor_ /= 100.0;
 
+		// Static layers & frames have to be drawn again
+		if ((width != width_) || (height != height_)) {
+			clearLayers();
+			clearFrames();
+		}
+
 		width_ = width;
 		height_ = height;
 	}
@@ -84,10 +103,15 @@ public:
 	virtual void draw(cairo_t *cairo, const TelemetryData &data) = 0;
 
 	virtual void clear(void) {
-		if (surface_ != NULL)
-			cairo_surface_destroy(surface_);
+		clearLayers();
+
+		if (target_ != NULL)
+			cairo_surface_destroy(target_);
+
+		target_ = NULL;
 
-		surface_ = NULL;
+		clearFrames();
+		clearTextCache();
 
 		is_initialized_ = false;
 	}
@@ -107,20 +131,51 @@ protected:
 	ShapeBase(VideoWidget::Theme &theme, VideoWidget::Shape type = VideoWidget::ShapeNone)
    		: theme_(theme) 
 		, type_(type) 
-		, surface_(NULL) {
+		, width_(0)
+		, height_(0)
+		, target_(NULL)
+		, text_cache_size_(0) {
 		is_initialized_ = false;
+
+		for (int i=0; i<LayerCount; i++)
+			layers_[i] = NULL;
 	}
 
+	// Widget bitmap, on the shape pixels (max extent, reused as the size
+	// changes). On little endian hosts, pixels are cairo BGRA premultiplied
+	// as is.
 	void createBox(OIIO::ImageBuf **buf, int width, int height);
 
+	// Bitmap spec, same channels order as the widget bitmap
+	static OIIO::ImageSpec boxSpec(int width, int height);
+
 	void drawImage(OIIO::ImageBuf *buf, int x, int y, const char *name, VideoWidget::Zoom zoom);
 
+	// Cairo draws in the bitmap memory (no copy), context is cleared
 	cairo_t * createCairoContext(OIIO::ImageBuf *buf);
 	void renderCairoContext(OIIO::ImageBuf *buf, cairo_t *cairo);
 	void destroyCairoContext(cairo_t *cairo);
 
+	// Static background layer: copy of the surface drawn so far
 	void saveCairoSurface(cairo_t *cairo);
-	bool restoreCairoSurface(cairo_t *cairo);
+	bool restoreCairoSurface(cairo_t *cairo, Layer layer = LayerBackground);
+
+	// Static foreground layer: drawn apart, then painted over
+	cairo_t * createLayerContext(cairo_t *cairo);
+	void saveLayerContext(cairo_t *cairo, cairo_t *layer);
+
+	void clearLayers(void);
+
+	// Frame atlas, keyed by the displayed value: a value drawn yet is
+	// copied from the atlas (see WidgetAtlas)
+	bool isLastFrame(const std::string &key) const {
+		return !frame_key_.empty() && (key == frame_key_);
+	}
+
+	bool loadFrame(OIIO::ImageBuf *buf, const std::string &key);
+	void saveFrame(OIIO::ImageBuf *buf, const std::string &key);
+
+	void clearFrames(void);
 
 	void background(cairo_t *cr, double radius = 0.0);
 
@@ -143,7 +198,52 @@ protected:
 	}
 
 private:
-	cairo_surface_t *surface_;
+	// Rendered text (fill, border & shadow), blitted while the string
+	// doesn't change
+	class TextRun {
+	public:
+		cairo_surface_t *surface;
+
+		// Offset from the text position
+		int x;
+		int y;
+
+		size_t size;
+
+		std::list<std::string>::iterator lru;
+	};
+
+	PangoLayout * layout(cairo_t *cr, const Font &font, std::string &key);
+
+	void drawText(cairo_t *cr, PangoLayout *layout, int x, int y, Font &font,
+			const float *fill, const float *outline, const char *text);
+
+	TextRun * textRun(cairo_t *cr, Font &font, const float *fill, const float *outline, const char *text);
+
+	void clearTextCache(void);
+
+	// Text cache budget, per shape
+	static const size_t TextCacheSize = 2 * 1024 * 1024;
+
+	cairo_surface_t *layers_[LayerCount];
+
+	// Persistent surface on the bitmap pixels
+	cairo_surface_t *target_;
+
+	// Widget bitmap pixels, grows to the max extent
+	std::vector<uint8_t> pixels_;
+
+	// Value displayed in the widget bitmap
+	std::string frame_key_;
+
+	// Layouts per font
+	std::map<std::string, PangoLayout *> layouts_;
+	std::map<std::string, PangoRectangle> dummies_;
+
+	// Rendered text LRU
+	std::map<std::string, TextRun> text_runs_;
+	std::list<std::string> text_lru_;
+	size_t text_cache_size_;
 
 	double size_factor_;
 	double fontsize_factor_;
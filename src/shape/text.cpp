@@ -2,30 +2,17 @@
 #include <pango/pangocairo.h>
 
 #include "../log_i.h"
+#include "../iconcache.h"
 #include "text.h"
 
 
 void TextShape::icon(cairo_t *cr, const std::string &filename, const float *fill) {
-	bool apply_color;
-
-    GError *error = NULL;
-
-	cairo_t *mask = NULL;
-	cairo_surface_t *surface = NULL;
-
 	double size;
 	double padding_left, padding_top;
 
-	RsvgRectangle viewport;
-
-	RsvgHandle *handle = NULL;
-
 	if (filename.empty())
 		return;
 
-	// Set color
-	apply_color = (fill != NULL) && (fill[3] != 0);
-
 	// Compute icon size
 	size = ((double) (size_ - 2 * theme().border()) * theme().iconSize()) / 100.0;
 
@@ -33,48 +20,11 @@ void TextShape::icon(cairo_t *cr, const std::string &filename, const float *fill
 	padding_left = (size_ - size) / 2.0;
 	padding_top = (theme().textOrientation() == VideoWidget::OrientationHorizontal) ? padding_left : 0.0;
 
-	// load svg data
-	handle = rsvg_handle_new_from_file(filename.c_str(), &error);
-    if (!handle) {
-        log_error("Load svn image failure: %s", error->message);
-        g_error_free(error);
-        return;
-    }
-
-	if (apply_color) {
-		// Create alpha only surface
-		surface = cairo_image_surface_create(CAIRO_FORMAT_A8, size_, size_);
-
-		// Create mask
-		mask = cairo_create(surface);
-	}
-
-	// Render svg into cairo surface
-	viewport = (RsvgRectangle) {
-		.x = (double) theme().border() + padding_left,
-		.y = (double) theme().border() + padding_top,
-		.width = size,
-		.height = size
-	};
-
-	rsvg_handle_render_document(handle, apply_color ? mask : cr, &viewport, NULL);
-
-	if (apply_color) {
-		// Apply color
-		cairo_set_source_rgba(cr, fill[0], fill[1], fill[2], fill[3]);
-
-		// Paint mask
-		cairo_mask_surface(cr, surface, 0, 0);
-	}
-
-	// Free
-	if (surface)
-		cairo_surface_destroy(surface);
-	if (mask)
-		cairo_destroy(mask);
-
-	if (handle != NULL)
-		g_object_unref(handle);
+	// Rasterized svg, cached
+	IconCache::draw(cr, filename,
+		(double) theme().border() + padding_left,
+		(double) theme().border() + padding_top,
+		size, size, fill);
 }
 
 
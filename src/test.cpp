@@ -1,11 +1,22 @@
 #include <string>
 #include <iomanip>
+#include <algorithm>
+#include <cstdlib>
 
 #include "log_i.h"
 #include "utils.h"
 #include "datetime.h"
+#include "profiler.h"
+#include "scaler.h"
 #include "test.h"
 
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/common.h>
+#include <libswscale/swscale.h>
+}
+
 
 // Test API
 //----------
@@ -91,6 +102,121 @@ void Test::testParseDatetime(const char *string) {
 }
 
 
+bool Test::benchScale(int width, int height, AVPixelFormat src_fmt, AVPixelFormat dst_fmt, int nb_threads) {
+	bool result = false;
+
+	int count = 20;
+
+	int diff, max_diff = 0;
+
+	int64_t begin, end;
+
+	uint8_t *src[4] = { NULL };
+	uint8_t *dst[4] = { NULL };
+	uint8_t *ref[4] = { NULL };
+	int src_linesize[4];
+	int dst_linesize[4];
+	int ref_linesize[4];
+
+	double ms;
+
+	struct SwsContext *ctx = NULL;
+
+	const AVPixFmtDescriptor *src_desc = av_pix_fmt_desc_get(src_fmt);
+	const AVPixFmtDescriptor *dst_desc = av_pix_fmt_desc_get(dst_fmt);
+
+	Scaler *scaler = Scaler::create(nb_threads);
+
+	log_call();
+
+	if ((av_image_alloc(src, src_linesize, width, height, src_fmt, 64) < 0)
+		|| (av_image_alloc(dst, dst_linesize, width, height, dst_fmt, 64) < 0)
+		|| (av_image_alloc(ref, ref_linesize, width, height, dst_fmt, 64) < 0)) {
+		printf("  Fail to allocate %dx%d frames\n", width, height);
+		goto done;
+	}
+
+	if (!scaler->init(width, height, src_fmt, dst_fmt)) {
+		printf("  Fail to convert %s => %s\n", av_get_pix_fmt_name(src_fmt), av_get_pix_fmt_name(dst_fmt));
+		goto done;
+	}
+
+	// Deterministic pattern: gradients & noise
+	for (int i=0; i<av_pix_fmt_count_planes(src_fmt); i++) {
+		int h = ((i == 1) || (i == 2)) ? AV_CEIL_RSHIFT(height, src_desc->log2_chroma_h) : height;
+
+		for (int y=0; y<h; y++) {
+			for (int x=0; x<src_linesize[i]; x++) {
+				uint32_t noise = (uint32_t) (x * 73856093) ^ (uint32_t) (y * 19349663) ^ (uint32_t) (i * 83492791);
+
+				src[i][(ptrdiff_t) y * src_linesize[i] + x] = (uint8_t) ((x + y * 2 + i * 64) / 4 + (noise % 32));
+			}
+		}
+	}
+
+	// Reference, whole frame by one context
+	if ((ctx = sws_getContext(width, height, src_fmt, width, height, dst_fmt,
+			SWS_FAST_BILINEAR, NULL, NULL, NULL)) == NULL) {
+		printf("  Fail to create scale context\n");
+		goto done;
+	}
+
+	sws_scale(ctx, src, src_linesize, 0, height, ref, ref_linesize);
+
+	if (scaler->scale(src, src_linesize, dst, dst_linesize) != height) {
+		printf("  Fail to convert %s => %s\n", av_get_pix_fmt_name(src_fmt), av_get_pix_fmt_name(dst_fmt));
+		goto done;
+	}
+
+	for (int i=0; i<av_pix_fmt_count_planes(dst_fmt); i++) {
+		int h = ((i == 1) || (i == 2)) ? AV_CEIL_RSHIFT(height, dst_desc->log2_chroma_h) : height;
+		int w = av_image_get_linesize(dst_fmt, width, i);
+
+		for (int y=0; y<h; y++) {
+			for (int x=0; x<w; x++) {
+				diff = abs(dst[i][(ptrdiff_t) y * dst_linesize[i] + x] - ref[i][(ptrdiff_t) y * ref_linesize[i] + x]);
+
+				max_diff = std::max(max_diff, diff);
+			}
+		}
+	}
+
+	if (max_diff > ScaleTolerance) {
+		printf("  %4dx%-4d %-8s => %-8s %2d thread(s): FAIL, output differs from one context (max diff: %d)\n",
+			width, height, av_get_pix_fmt_name(src_fmt), av_get_pix_fmt_name(dst_fmt),
+			scaler->threads(), max_diff);
+		goto done;
+	}
+
+	begin = Profiler::now();
+
+	for (int i=0; i<count; i++)
+		scaler->scale(src, src_linesize, dst, dst_linesize);
+
+	end = Profiler::now();
+
+	ms = (double) (end - begin) / count / 1000.0;
+
+	printf("  %4dx%-4d %-8s => %-8s %2d thread(s): %6.2f ms/frame - %6.1f fps - %7.1f Mpixels/s\n",
+		width, height, av_get_pix_fmt_name(src_fmt), av_get_pix_fmt_name(dst_fmt),
+		scaler->threads(), ms, 1000.0 / ms, (double) width * height / ms / 1000.0);
+
+	result = true;
+
+done:
+	if (ctx != NULL)
+		sws_freeContext(ctx);
+
+	av_freep(&src[0]);
+	av_freep(&dst[0]);
+	av_freep(&ref[0]);
+
+	delete scaler;
+
+	return result;
+}
+
+
 bool Test::run(void) {
 	log_call();
 
@@ -160,6 +286,27 @@ bool Test::run(void) {
 	testParseDatetime("2020:07:21 08:55:48.123456 +0200");
 	testParseDatetime("2020:07:21 08:55:48.123 +02:00");
 
+	std::cout << std::endl;
+
+	std::cout << "## Colour conversion benchmark (decode, encode & native YUV paths)" << std::endl;
+
+	const int sizes[][2] = { { 1920, 1080 }, { 2704, 1520 }, { 3840, 2160 } };
+
+	bool result = true;
+
+	for (auto &size : sizes) {
+		for (int nb_threads : { 1, 0 }) {
+			result &= benchScale(size[0], size[1], AV_PIX_FMT_YUV420P, AV_PIX_FMT_RGBA, nb_threads);
+			result &= benchScale(size[0], size[1], AV_PIX_FMT_RGBA, AV_PIX_FMT_YUV420P, nb_threads);
+			result &= benchScale(size[0], size[1], AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P, nb_threads);
+		}
+	}
+
+	if (!result) {
+		fail();
+		return true;
+	}
+
 	complete();
 
 	return true;
@@ -6,6 +6,10 @@
 #include <string>
 #include <vector>
 
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
 #include "application.h"
 
 
@@ -29,6 +33,10 @@ protected:
 private:
 	void printTimestamp(uint64_t timestamp);
 	void testParseDatetime(const char *string);
+	// Banded output is checked against a single context conversion
+	static const int ScaleTolerance = 1;
+
+	bool benchScale(int width, int height, AVPixelFormat src_fmt, AVPixelFormat dst_fmt, int nb_threads);
 };
 
 #endif
@@ -0,0 +1,560 @@
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "log_i.h"
+#include "tilestore.h"
+
+
+#define INDEX_HEADER "# gpx2video tiles index v1"
+
+
+std::mutex TileStore::mutex_;
+
+bool TileStore::is_open_ = false;
+bool TileStore::is_writable_ = false;
+
+std::string TileStore::path_;
+size_t TileStore::capacity_ = 0;
+
+time_t TileStore::opened_at_ = 0;
+
+int TileStore::lock_fd_ = -1;
+int TileStore::pack_fd_ = -1;
+
+std::map<std::string, TileStore::Entry> TileStore::entries_;
+std::vector<int64_t> TileStore::free_slots_;
+int64_t TileStore::nbr_slots_ = 0;
+size_t TileStore::size_ = 0;
+
+bool TileStore::is_dirty_ = false;
+
+uint64_t TileStore::nb_hits_ = 0;
+uint64_t TileStore::nb_misses_ = 0;
+
+
+std::string TileStore::key(int source, int zoom, int x, int y) {
+	char s[64];
+
+	snprintf(s, sizeof(s), "%d/%d/%d/%d", source, zoom, x, y);
+
+	return std::string(s);
+}
+
+
+std::string TileStore::encode(const std::string &value) {
+	char s[4];
+
+	std::string field;
+
+	if (value.empty())
+		return "-";
+
+	for (unsigned char c : value) {
+		if ((c <= ' ') || (c >= 0x7f) || (c == '%') || ((c == '-') && (value.size() == 1))) {
+			snprintf(s, sizeof(s), "%%%02X", c);
+			field += s;
+		}
+		else
+			field += c;
+	}
+
+	return field;
+}
+
+
+std::string TileStore::decode(const std::string &field) {
+	std::string value;
+
+	if (field == "-")
+		return "";
+
+	for (size_t i=0; i<field.size(); i++) {
+		if ((field[i] == '%') && (i + 2 < field.size())
+			&& isxdigit((unsigned char) field[i + 1]) && isxdigit((unsigned char) field[i + 2])) {
+			value += (char) strtol(field.substr(i + 1, 2).c_str(), NULL, 16);
+			i += 2;
+		}
+		else
+			value += field[i];
+	}
+
+	return value;
+}
+
+
+bool TileStore::open(const std::string &path, size_t size) {
+	FILE *fp;
+
+	struct stat st;
+
+	char *line = NULL;
+	size_t length = 0;
+
+	std::vector<bool> used;
+
+	std::string lockfile = path + "/tiles.lock";
+	std::string indexfile = path + "/tiles.index";
+	std::string packfile = path + "/tiles.pack";
+
+	log_call();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (is_open_)
+		return true;
+
+	path_ = path;
+	capacity_ = size;
+
+	opened_at_ = time(NULL);
+
+	// Only one process updates the store
+	lock_fd_ = ::open(lockfile.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+	is_writable_ = (lock_fd_ != -1) && (flock(lock_fd_, LOCK_EX | LOCK_NB) == 0);
+
+	if (!is_writable_)
+		log_info("Tile store used by another process, read only");
+
+	// Load index
+	if ((fp = fopen(indexfile.c_str(), "r")) != NULL) {
+		while (getline(&line, &length, fp) != -1) {
+			int n = 0;
+			char *etag, *end;
+			long long expires, last_used, slot;
+			unsigned long filesize;
+
+			Entry entry;
+
+			if (line[0] == '#')
+				continue;
+
+			if ((sscanf(line, "%d %d %d %d %lld %lld %lu %lld %n",
+					&entry.source, &entry.zoom, &entry.x, &entry.y,
+					&expires, &last_used, &filesize, &slot, &n) != 8) || (n == 0))
+				continue;
+
+			line[strcspn(line, "\n")] = '\0';
+
+			// ETag (encoded), then filename to end of line
+			etag = line + n;
+
+			if ((end = strchr(etag, ' ')) == NULL)
+				continue;
+
+			*end = '\0';
+
+			entry.filename = end + 1;
+			entry.etag = decode(etag);
+			entry.expires = expires;
+			entry.last_used = last_used;
+			entry.size = filesize;
+			entry.slot = is_writable_ ? slot : -1;
+
+			if (entry.filename.empty())
+				continue;
+
+			entries_[key(entry.source, entry.zoom, entry.x, entry.y)] = entry;
+		}
+
+		free(line);
+
+		fclose(fp);
+	}
+
+	// Pack file, decoded tiles
+	if (is_writable_) {
+		pack_fd_ = ::open(packfile.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+		if ((pack_fd_ != -1) && (fstat(pack_fd_, &st) == 0))
+			nbr_slots_ = st.st_size / SlotSize;
+
+		used.assign(nbr_slots_, false);
+	}
+
+	size_ = 0;
+
+	for (auto &it : entries_) {
+		Entry &entry = it.second;
+
+		// Slot lost or shared
+		if ((entry.slot >= nbr_slots_) || ((entry.slot >= 0) && used[entry.slot]))
+			entry.slot = -1;
+
+		if (entry.slot >= 0) {
+			used[entry.slot] = true;
+			size_ += SlotSize;
+		}
+
+		size_ += entry.size;
+	}
+
+	for (int64_t slot=nbr_slots_-1; slot>=0; slot--) {
+		if (!used[slot])
+			free_slots_.push_back(slot);
+	}
+
+	is_open_ = true;
+
+	// Dropped tiles out of the index at once
+	if (is_writable_) {
+		evict();
+
+		if (is_dirty_)
+			saveIndex();
+	}
+
+	log_info("Tile store: %lu tile(s), %lu MB", entries_.size(), size_ / (1024 * 1024));
+
+	return true;
+}
+
+
+void TileStore::close(void) {
+	log_call();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (!is_open_)
+		return;
+
+	if (is_writable_) {
+		evict();
+		saveIndex();
+	}
+
+	log_info("Tile store: %lu tile(s) read from pack, %lu decoded", nb_hits_, nb_misses_);
+
+	if (pack_fd_ != -1)
+		::close(pack_fd_);
+	if (lock_fd_ != -1)
+		::close(lock_fd_);
+
+	pack_fd_ = -1;
+	lock_fd_ = -1;
+
+	entries_.clear();
+	free_slots_.clear();
+
+	nbr_slots_ = 0;
+	size_ = 0;
+
+	is_dirty_ = false;
+	is_open_ = false;
+	is_writable_ = false;
+}
+
+
+void TileStore::evict(time_t since) {
+	int n = 0;
+
+	size_t target = capacity_ / 100 * EvictRatio;
+
+	std::vector<std::map<std::string, Entry>::iterator> lru;
+
+	if (!is_writable_ || (size_ <= capacity_))
+		return;
+
+	for (auto it=entries_.begin(); it!=entries_.end(); it++) {
+		if ((since == 0) || (it->second.last_used < since))
+			lru.push_back(it);
+	}
+
+	// Least recently used first
+	std::sort(lru.begin(), lru.end(), [](const std::map<std::string, Entry>::iterator &a,
+		const std::map<std::string, Entry>::iterator &b) {
+		return a->second.last_used < b->second.last_used;
+	});
+
+	for (auto &it : lru) {
+		if (size_ <= target)
+			break;
+
+		unlink(it->second.filename.c_str());
+
+		drop(it);
+
+		n++;
+	}
+
+	if (n > 0)
+		log_info("Tile store: %d tile(s) dropped", n);
+}
+
+
+void TileStore::drop(std::map<std::string, Entry>::iterator it) {
+	Entry &entry = it->second;
+
+	if (entry.slot >= 0) {
+		free_slots_.push_back(entry.slot);
+		size_ -= SlotSize;
+
+		is_dirty_ = true;
+	}
+
+	size_ -= entry.size;
+
+	entries_.erase(it);
+}
+
+
+bool TileStore::saveIndex(void) {
+	FILE *fp;
+
+	std::string indexfile = path_ + "/tiles.index";
+	std::string tmpfile = indexfile + ".tmp";
+
+	if ((fp = fopen(tmpfile.c_str(), "w")) == NULL) {
+		log_warn("Can't write tile store index '%s'", tmpfile.c_str());
+		return false;
+	}
+
+	fprintf(fp, "%s\n", INDEX_HEADER);
+
+	for (auto &it : entries_) {
+		const Entry &entry = it.second;
+
+		fprintf(fp, "%d %d %d %d %lld %lld %lu %lld %s %s\n",
+			entry.source, entry.zoom, entry.x, entry.y,
+			(long long) entry.expires, (long long) entry.last_used,
+			(unsigned long) entry.size, (long long) entry.slot,
+			encode(entry.etag).c_str(),
+			entry.filename.c_str());
+	}
+
+	if (fclose(fp) != 0) {
+		unlink(tmpfile.c_str());
+		return false;
+	}
+
+	// Replace index at once
+	if (rename(tmpfile.c_str(), indexfile.c_str()) != 0) {
+		unlink(tmpfile.c_str());
+		return false;
+	}
+
+	is_dirty_ = false;
+
+	return true;
+}
+
+
+bool TileStore::isValid(int source, int zoom, int x, int y, const std::string &filename) {
+	struct stat st;
+
+	time_t now = time(NULL);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto it = entries_.find(key(source, zoom, x, y));
+
+	if (it != entries_.end()) {
+		// Tile file removed (ie: evicted by another process)
+		if ((stat(filename.c_str(), &st) != 0) || (st.st_size <= 0)) {
+			drop(it);
+			return false;
+		}
+
+		it->second.last_used = now;
+
+		// Only the store owner revalidates expired tiles
+		return (it->second.expires > now) || !is_writable_;
+	}
+
+	// Not indexed, check tile file
+	if ((stat(filename.c_str(), &st) != 0) || (st.st_size <= 0))
+		return false;
+
+	if (is_open_) {
+		Entry entry;
+
+		entry.source = source;
+		entry.zoom = zoom;
+		entry.x = x;
+		entry.y = y;
+		entry.filename = filename;
+		entry.expires = now + DefaultExpiry;
+		entry.last_used = now;
+		entry.size = st.st_size;
+		entry.slot = -1;
+
+		entries_[key(source, zoom, x, y)] = entry;
+
+		size_ += entry.size;
+
+		evict(opened_at_);
+	}
+
+	return true;
+}
+
+
+std::string TileStore::etag(int source, int zoom, int x, int y) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto it = entries_.find(key(source, zoom, x, y));
+
+	if (it == entries_.end())
+		return "";
+
+	return it->second.etag;
+}
+
+
+void TileStore::update(int source, int zoom, int x, int y, const std::string &filename,
+		const std::string &etag, time_t expires, bool modified) {
+	struct stat st;
+
+	std::string s = key(source, zoom, x, y);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (!is_open_)
+		return;
+
+	auto it = entries_.find(s);
+
+	if (it == entries_.end()) {
+		Entry entry;
+
+		entry.source = source;
+		entry.zoom = zoom;
+		entry.x = x;
+		entry.y = y;
+		entry.size = 0;
+		entry.slot = -1;
+
+		it = entries_.insert(std::make_pair(s, entry)).first;
+	}
+
+	Entry &entry = it->second;
+
+	// Tile content changed, decoded tile is obsolete
+	if (modified && (entry.slot >= 0)) {
+		free_slots_.push_back(entry.slot);
+		size_ -= SlotSize;
+
+		entry.slot = -1;
+
+		is_dirty_ = true;
+	}
+
+	if ((stat(filename.c_str(), &st) != 0) || (st.st_size <= 0)) {
+		drop(it);
+		return;
+	}
+
+	size_ -= entry.size;
+
+	entry.filename = filename;
+	entry.size = st.st_size;
+	entry.expires = expires;
+	entry.last_used = time(NULL);
+
+	if (modified || !etag.empty())
+		entry.etag = etag;
+
+	size_ += entry.size;
+
+	evict(opened_at_);
+}
+
+
+bool TileStore::load(int source, int zoom, int x, int y, OIIO::ImageBuf &buf) {
+	ssize_t n;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (pack_fd_ == -1)
+		return false;
+
+	auto it = entries_.find(key(source, zoom, x, y));
+
+	if ((it == entries_.end()) || (it->second.slot < 0)) {
+		nb_misses_++;
+		return false;
+	}
+
+	buf.reset(OIIO::ImageSpec(TileSize, TileSize, 4, OIIO::TypeDesc::UINT8));
+
+	n = pread(pack_fd_, buf.localpixels(), SlotSize, (off_t) it->second.slot * SlotSize);
+
+	if (n != (ssize_t) SlotSize) {
+		nb_misses_++;
+		return false;
+	}
+
+	nb_hits_++;
+
+	it->second.last_used = time(NULL);
+
+	return true;
+}
+
+
+void TileStore::save(int source, int zoom, int x, int y, const OIIO::ImageBuf &buf) {
+	int64_t slot;
+
+	const OIIO::ImageSpec &spec = buf.spec();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (pack_fd_ == -1)
+		return;
+
+	if ((spec.width != TileSize) || (spec.height != TileSize) || (spec.nchannels != 4)
+		|| (spec.format != OIIO::TypeDesc::UINT8) || (buf.localpixels() == NULL))
+		return;
+
+	// Only downloaded tiles
+	auto it = entries_.find(key(source, zoom, x, y));
+
+	if ((it == entries_.end()) || (it->second.slot >= 0))
+		return;
+
+	if (!free_slots_.empty()) {
+		// Saved index mustn't point to the slot anymore
+		if (is_dirty_ && !saveIndex())
+			return;
+
+		slot = free_slots_.back();
+		free_slots_.pop_back();
+	}
+	else
+		slot = nbr_slots_++;
+
+	if (pwrite(pack_fd_, buf.localpixels(), SlotSize, (off_t) slot * SlotSize) != (ssize_t) SlotSize) {
+		free_slots_.push_back(slot);
+		return;
+	}
+
+	it->second.slot = slot;
+
+	size_ += SlotSize;
+
+	evict(opened_at_);
+}
+
+
+uint64_t TileStore::hits(void) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	return nb_hits_;
+}
+
+
+uint64_t TileStore::misses(void) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	return nb_misses_;
+}
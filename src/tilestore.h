@@ -0,0 +1,114 @@
+#ifndef __GPX2VIDEO__TILESTORE_H__
+#define __GPX2VIDEO__TILESTORE_H__
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <ctime>
+
+#include "oiio.h"
+
+
+/**
+ * Map tiles store
+ *
+ * Downloaded tiles are recorded in a single index file (source, zoom, x, y,
+ * ETag & expiry date), so a map doesn't check each tile file. Decoded tiles
+ * (RGBA) are kept in a pack file, a map rendered again doesn't decode PNG.
+ * Least recently used tiles are dropped over the size budget, at open,
+ * close & as soon as a new tile exceeds it (down to EvictRatio %).
+ *
+ * Only the first process updates the store, others (ie: segment renderers)
+ * read the index. Index is saved before a freed slot is reused, so a
+ * crash never maps a tile onto the pixels of another one.
+ */
+class TileStore {
+public:
+	// Load index & drop tiles over the budget (bytes)
+	static bool open(const std::string &path, size_t size);
+	// Save index
+	static void close(void);
+
+	// Tile downloaded & not expired
+	static bool isValid(int source, int zoom, int x, int y, const std::string &filename);
+
+	// Tile ETag, to revalidate an expired tile
+	static std::string etag(int source, int zoom, int x, int y);
+
+	// Tile downloaded (modified) or revalidated
+	static void update(int source, int zoom, int x, int y, const std::string &filename,
+		const std::string &etag, time_t expires, bool modified);
+
+	// Decoded tile (RGBA, TileSize x TileSize)
+	static bool load(int source, int zoom, int x, int y, OIIO::ImageBuf &buf);
+	static void save(int source, int zoom, int x, int y, const OIIO::ImageBuf &buf);
+
+	static uint64_t hits(void);
+	static uint64_t misses(void);
+
+	static const int TileSize = 256;
+	static const size_t SlotSize = TileSize * TileSize * 4;
+
+	// Tile lifetime if server doesn't tell (1 week)
+	static const time_t DefaultExpiry = 7 * 24 * 3600;
+
+	// Store size after eviction, % of the budget
+	static const int EvictRatio = 90;
+
+private:
+	class Entry {
+	public:
+		int source;
+		int zoom;
+		int x, y;
+
+		std::string filename;
+		std::string etag;
+
+		time_t expires;
+		time_t last_used;
+
+		// Tile file size & pack slot (-1 if not decoded)
+		size_t size;
+		int64_t slot;
+	};
+
+	static std::string key(int source, int zoom, int x, int y);
+
+	// Index field: '%', blanks & controls percent-escaped, "-" if empty
+	static std::string encode(const std::string &value);
+	static std::string decode(const std::string &field);
+
+	// Tiles used since 'since' (current maps) are kept
+	static void evict(time_t since=0);
+	static void drop(std::map<std::string, Entry>::iterator it);
+	static bool saveIndex(void);
+
+	static std::mutex mutex_;
+
+	static bool is_open_;
+	static bool is_writable_;
+
+	static std::string path_;
+	static size_t capacity_;
+
+	static time_t opened_at_;
+
+	static int lock_fd_;
+	static int pack_fd_;
+
+	static std::map<std::string, Entry> entries_;
+	static std::vector<int64_t> free_slots_;
+	static int64_t nbr_slots_;
+	static size_t size_;
+
+	// Index on disk may still point to freed slots
+	static bool is_dirty_;
+
+	static uint64_t nb_hits_;
+	static uint64_t nb_misses_;
+};
+
+#endif
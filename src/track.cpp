@@ -18,6 +18,7 @@
 
 #include "log_i.h"
 #include "utils.h"
+#include "blend.h"
 #include "datetime.h"
 #include "oiioutils.h"
 #include "videoparams.h"
@@ -410,6 +411,8 @@ Track::~Track() {
 	if (icon_position_buf_ != NULL)
 		delete icon_position_buf_;
 
+	clearIconPositions();
+
 	if (trackbuf_ != NULL)
 		delete trackbuf_;
 	if (bg_buf_)
@@ -805,6 +808,8 @@ void Track::init(void) {
 	if (icon_position_buf_ != NULL)
 		delete icon_position_buf_;
 
+	clearIconPositions();
+
 	// Load icons
 	size = 2 * size2pixels(settings().iconSize(TrackSettings::IconEnd));
 	color = settings().iconColor(TrackSettings::IconEnd);
@@ -826,12 +831,10 @@ void Track::init(void) {
 }
 
 
-void Track::path(OIIO::ImageBuf &outbuf, TelemetrySource *source, double divider) {
+void Track::path(cairo_t *cairo, TelemetrySource *source, double divider) {
 	int zoom;
-	int stride;
 	double path_thick;
 	double path_border;
-	unsigned char *bytes;
 
 	const float *fill;
 	const float *outline;
@@ -851,15 +854,6 @@ void Track::path(OIIO::ImageBuf &outbuf, TelemetrySource *source, double divider
 	fill = settings().pathSecondaryColor();
 	outline = settings().pathBorderColor();
 
-	// Cairo buffer
-	OIIO::ImageBuf buf(outbuf.spec());
-
-	// Create the cairo destination surface
-	cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, outbuf.spec().width, outbuf.spec().height);
-
-	// Cairo context
-	cairo_t *cairo = cairo_create(surface);
-
 	// Path border
 	if (path_border > 0) {
 		cairo_set_source_rgba(cairo, outline[0], outline[1], outline[2], outline[3]); // BGR #0000000
@@ -891,6 +885,64 @@ void Track::path(OIIO::ImageBuf &outbuf, TelemetrySource *source, double divider
 	}
 
 	cairo_stroke(cairo);
+}
+
+
+void Track::progress(cairo_t *cairo, TelemetrySource *source, double divider, uint64_t timestamp) {
+	int zoom;
+	double path_thick;
+
+	const float *fill;
+
+	int x = 0, y = 0;
+
+	TelemetryData wpt;
+
+	enum TelemetrySource::Data result;
+
+	log_call();
+
+	zoom = settings().zoom();
+	path_thick = settings().pathThick();
+
+	fill = settings().pathPrimaryColor();
+
+	// Draw WPT with primary color
+	cairo_set_source_rgba(cairo, fill[0], fill[1], fill[2], fill[3]); // BGR #669df600
+	cairo_set_line_width(cairo, path_thick); //3.0); //40.96);
+	cairo_set_line_join(cairo, CAIRO_LINE_JOIN_ROUND);
+
+	for (result = source->retrieveFirst(wpt); result != TelemetrySource::DataEof; result = source->retrieveNext(wpt)) {
+		x = Track::lon2pixel(zoom, divider, wpt.longitude()) - pevx1_;
+		y = Track::lat2pixel(zoom, divider, wpt.latitude()) - pevy1_;
+
+		cairo_line_to(cairo, x, y);
+
+		if (wpt.timestamp() >= timestamp)
+			break;
+	}
+
+	cairo_stroke(cairo);
+}
+
+
+void Track::path(OIIO::ImageBuf &outbuf, TelemetrySource *source, double divider) {
+	int stride;
+	unsigned char *bytes;
+
+	log_call();
+
+	// Cairo buffer
+	OIIO::ImageBuf buf(outbuf.spec());
+
+	// Create the cairo destination surface
+	cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, outbuf.spec().width, outbuf.spec().height);
+
+	// Cairo context
+	cairo_t *cairo = cairo_create(surface);
+
+	// Draw path
+	path(cairo, source, divider);
 
 	// Convert to image
 	bytes = cairo_image_surface_get_data(surface);
@@ -906,12 +958,12 @@ void Track::path(OIIO::ImageBuf &outbuf, TelemetrySource *source, double divider
 	// BGRA => RGBA
 	int channelorder[] = { 2, 1, 0, 3 };
 	float channelvalues[] = { };
-	std::string channelnames[] = { "B", "G", "R", "A" };
+	std::string channelnames[] = { "R", "G", "B", "A" };
 
 	OIIO::ImageBufAlgo::channels(buf, buf, 4, channelorder, channelvalues, channelnames);
 
 	// Cairo over
-	OIIO::ImageBufAlgo::over(outbuf, buf, outbuf);
+	Blend::over(outbuf, buf);
 
 	// Release
 	cairo_surface_destroy(surface);
@@ -920,6 +972,13 @@ void Track::path(OIIO::ImageBuf &outbuf, TelemetrySource *source, double divider
 
 
 void Track::path(OIIO::ImageBuf &outbuf, const TelemetryData &data, double divider) {
+	std::list<OIIO::ImageBuf *> outbufs = { &outbuf };
+
+	path(outbufs, data, divider);
+}
+
+
+void Track::path(std::list<OIIO::ImageBuf *> &outbufs, const TelemetryData &data, double divider) {
 	int zoom;
 	int stride;
 	double path_thick;
@@ -934,16 +993,13 @@ void Track::path(OIIO::ImageBuf &outbuf, const TelemetryData &data, double divid
 
 	int channelorder[] = { 2, 1, 0, 3 };
 	float channelvalues[] = { };
-	std::string channelnames[] = { "B", "G", "R", "A" };
+	std::string channelnames[] = { "R", "G", "B", "A" };
 
-	OIIO::ROI roi = OIIO::ROI::All();
 	OIIO::ImageBuf buf;
 
 	cairo_t *cairo = NULL;
 	cairo_surface_t *surface = NULL;
 
-	TelemetryData wpt;
-
 	enum TelemetrySource::Data result;
 
 	log_call();
@@ -960,31 +1016,47 @@ void Track::path(OIIO::ImageBuf &outbuf, const TelemetryData &data, double divid
 			goto skip;
 		}
 
-		// Cairo buffer
-		buf = OIIO::ImageBuf(outbuf.spec());
+		// Draw the whole progress in each buffer
+		for (OIIO::ImageBuf *outbuf : outbufs) {
+			const OIIO::ImageSpec& spec = outbuf->spec();
 
-		// Create the cairo destination surface
-		surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, outbuf.spec().width, outbuf.spec().height);
+			// Cairo buffer
+			buf = OIIO::ImageBuf(OIIO::ImageSpec(spec.width, spec.height, 4, OIIO::TypeDesc::UINT8));
 
-		// Cairo context
-		cairo = cairo_create(surface);
+			// Create the cairo destination surface
+			surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, spec.width, spec.height);
 
-		// Draw new WPT with primary color
-		cairo_set_source_rgba(cairo, fill[0], fill[1], fill[2], fill[3]); // BGR #669df600
-		cairo_set_line_width(cairo, path_thick); //3.0); //40.96);
-		cairo_set_line_join(cairo, CAIRO_LINE_JOIN_ROUND);
+			// Cairo context
+			cairo = cairo_create(surface);
 
-		for (result = telemetry_source_->retrieveFirst(wpt); result != TelemetrySource::DataEof; result = telemetry_source_->retrieveNext(wpt)) {
-			x = Track::lon2pixel(zoom, divider, wpt.longitude()) - pevx1_;
-			y = Track::lat2pixel(zoom, divider, wpt.latitude()) - pevy1_;
+			// Buffer origin
+			cairo_translate(cairo, -spec.x, -spec.y);
 
-			cairo_line_to(cairo, x, y);
+			progress(cairo, telemetry_source_, divider, data.timestamp());
 
-			if (wpt.timestamp() >= data.timestamp())
-				break;
-		}
+			// Convert to image
+			bytes = cairo_image_surface_get_data(surface);
+			stride = cairo_image_surface_get_stride(surface);
 
-		cairo_stroke(cairo);
+			// Cairo to OIIO
+			buf.set_pixels(OIIO::ROI(),
+				buf.spec().format,
+				bytes, 
+				OIIO::AutoStride,
+				stride);
+
+			// BGRA => RGBA 
+			OIIO::ImageBufAlgo::channels(buf, buf, 4, channelorder, channelvalues, channelnames);
+
+			// Cairo over
+			buf.specmod().x = spec.x;
+			buf.specmod().y = spec.y;
+			Blend::over(*outbuf, buf);
+
+			// Release
+			cairo_surface_destroy(surface);
+			cairo_destroy(cairo);
+		}
 	}
 	else if (!data.hasValue(TelemetryData::DataFix)) {
 		goto skip;
@@ -1003,14 +1075,6 @@ void Track::path(OIIO::ImageBuf &outbuf, const TelemetryData &data, double divid
 
 		TelemetryData wpt = (last_wpt_.type() == TelemetryData::TypeUnknown) ? last_data_ : last_wpt_;
 
-		const OIIO::ImageSpec& spec = outbuf.spec();
-
-		OIIO::TypeDesc::BASETYPE type = (OIIO::TypeDesc::BASETYPE) spec.format.basetype;
-
-		// Last point
-		x1 = Track::lon2pixel(zoom, divider, last_data_.longitude()) - pevx1_;
-		y1 = Track::lat2pixel(zoom, divider, last_data_.latitude()) - pevy1_;
-
 		// Last point
 		x1 = last_posX_;
 		y1 = last_posY_;
@@ -1019,11 +1083,9 @@ void Track::path(OIIO::ImageBuf &outbuf, const TelemetryData &data, double divid
 		x2 = Track::lon2pixel(zoom, divider, data.longitude()) - pevx1_;
 		y2 = Track::lat2pixel(zoom, divider, data.latitude()) - pevy1_;
 
-		if (last_data_.type() != TelemetryData::TypeUnknown) {
-			// Move ?
-			if ((x1 == x2) && (y1 == y2))
-				goto skip;
-		}
+		// Move ?
+		if ((x1 == x2) && (y1 == y2))
+			goto skip;
 
 		// Move segment at origin
 		xoff = std::min(x1, x2) - path_thick;
@@ -1039,7 +1101,7 @@ void Track::path(OIIO::ImageBuf &outbuf, const TelemetryData &data, double divid
 		height = std::max(y1, y2) + path_thick;
 
 		// Cairo buffer
-		buf = OIIO::ImageBuf(OIIO::ImageSpec(width, height, spec.nchannels, type));
+		buf = OIIO::ImageBuf(OIIO::ImageSpec(width, height, 4, OIIO::TypeDesc::UINT8));
 
 		// Create the cairo destination surface
 		surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
@@ -1085,32 +1147,31 @@ void Track::path(OIIO::ImageBuf &outbuf, const TelemetryData &data, double divid
 		cairo_stroke(cairo);
 		cairo_restore(cairo);
 
-		// Overlay offset
-		roi = OIIO::ROI(xoff, xoff + width, yoff, yoff + height);
-	}
+		// Convert to image
+		bytes = cairo_image_surface_get_data(surface);
+		stride = cairo_image_surface_get_stride(surface);
 
-	// Convert to image
-	bytes = cairo_image_surface_get_data(surface);
-	stride = cairo_image_surface_get_stride(surface);
+		// Cairo to OIIO
+		buf.set_pixels(OIIO::ROI(),
+			buf.spec().format,
+			bytes, 
+			OIIO::AutoStride,
+			stride);
 
-	// Cairo to OIIO
-	buf.set_pixels(OIIO::ROI(),
-		buf.spec().format,
-		bytes, 
-		OIIO::AutoStride,
-		stride);
+		// BGRA => RGBA 
+		OIIO::ImageBufAlgo::channels(buf, buf, 4, channelorder, channelvalues, channelnames);
 
-	// BGRA => RGBA 
-	OIIO::ImageBufAlgo::channels(buf, buf, 4, channelorder, channelvalues, channelnames);
+		// Segment over each buffer it crosses
+		buf.specmod().x = xoff;
+		buf.specmod().y = yoff;
 
-	// Cairo over
-	buf.specmod().x = xoff;
-	buf.specmod().y = yoff;
-	OIIO::ImageBufAlgo::over(outbuf, buf, outbuf, roi);
+		for (OIIO::ImageBuf *outbuf : outbufs)
+			Blend::over(*outbuf, buf, OIIO::ROI(xoff, xoff + width, yoff, yoff + height));
 
-	// Release
-	cairo_surface_destroy(surface);
-	cairo_destroy(cairo);
+		// Release
+		cairo_surface_destroy(surface);
+		cairo_destroy(cairo);
+	}
 
 	// Save current position
 	last_data_ = data;
@@ -1120,19 +1181,44 @@ skip:
 }
 
 
+void Track::computeEnds(void) {
+	int zoom = settings().zoom();
+
+	TelemetryData wpt;
+
+	log_call();
+
+	// Compute begin
+	telemetry_source_->retrieveFirst(wpt);
+
+	x_start_ = Track::lon2pixel(zoom, divider_, wpt.longitude()) - pevx1_;
+	y_start_ = Track::lat2pixel(zoom, divider_, wpt.latitude()) - pevy1_;
+
+	ts_start_ = telemetry_source_->beginTimestamp();
+
+	// Compute end
+	telemetry_source_->retrieveLast(wpt);
+
+	x_end_ = Track::lon2pixel(zoom, divider_, wpt.longitude()) - pevx1_;
+	y_end_ = Track::lat2pixel(zoom, divider_, wpt.latitude()) - pevy1_;
+
+	ts_end_ = telemetry_source_->endTimestamp();
+}
+
+
 bool Track::load(void) {
+	// Rotate position icon once for all
+	if (icon_positions_.empty())
+		rotateIconPosition();
+
 	if (trackbuf_)
 		return true;
 
 	int width = settings().width();
 	int height = settings().height();
 
-	int zoom = settings().zoom();
-
 	std::string filename = app_.settings().inputfile();
 
-	TelemetryData wpt;
-
 	log_call();
 
 	if (!isInitialized())
@@ -1150,21 +1236,8 @@ bool Track::load(void) {
 		// Draw background path
 		path(*trackbuf_, telemetry_source_, divider_);
 
-		// Compute begin
-		telemetry_source_->retrieveFirst(wpt);
-
-		x_start_ = Track::lon2pixel(zoom, divider_, wpt.longitude()) - pevx1_;
-		y_start_ = Track::lat2pixel(zoom, divider_, wpt.latitude()) - pevy1_;
-
-		ts_start_ = telemetry_source_->beginTimestamp();
-
-		// Compute end
-		telemetry_source_->retrieveLast(wpt);
-
-		x_end_ = Track::lon2pixel(zoom, divider_, wpt.longitude()) - pevx1_;
-		y_end_ = Track::lat2pixel(zoom, divider_, wpt.latitude()) - pevy1_;
-
-		ts_end_ = telemetry_source_->endTimestamp();
+		// Compute begin & end
+		computeEnds();
 	}
 	else {
 		log_warn("Can't read telemetry data");
@@ -1327,10 +1400,6 @@ OIIO::ImageBuf * Track::render(const TelemetryData &data, bool &is_update) {
 	}
 
 	// Image buffer
-	if (fg_buf_ != NULL)
-		delete fg_buf_;
-
-	// Draw
 	this->createBox(&fg_buf_, theme().width(), theme().height());
 
 	// Cairo context
@@ -1357,7 +1426,7 @@ OIIO::ImageBuf * Track::render(const TelemetryData &data, bool &is_update) {
 		// Draw track image over
 		trackbuf_->specmod().x = x + offsetX;
 		trackbuf_->specmod().y = y + offsetY;
-		OIIO::ImageBufAlgo::over(*fg_buf_, *trackbuf_, *fg_buf_, OIIO::ROI(x, x + width, y, y + height));
+		Blend::over(*fg_buf_, *trackbuf_, OIIO::ROI(x, x + width, y, y + height));
 
 		// Draw picto
 		if (icon_start_buf_ && theme().hasFlag(VideoWidget::Theme::FlagIconStart))
@@ -1369,9 +1438,7 @@ OIIO::ImageBuf * Track::render(const TelemetryData &data, bool &is_update) {
 			if (settings().follow() != TrackSettings::FollowNone) {
 				double angle = (settings().follow() == TrackSettings::FollowCourse) ? data.course() : data.heading();
 
-				OIIO::ImageBuf position = OIIO::ImageBufAlgo::rotate(*icon_position_buf_, angle * M_PI / 180.0);
-
-				icon(*fg_buf_, position, x + offsetX + posX, y + offsetY + posY, OIIO::ROI(x, x + width, y, y + height));
+				icon(*fg_buf_, *iconPosition(angle), x + offsetX + posX, y + offsetY + posY, OIIO::ROI(x, x + width, y, y + height));
 			}
 			else {
 				icon(*fg_buf_, *icon_position_buf_, x + offsetX + posX, y + offsetY + posY, OIIO::ROI(x, x + width, y, y + height));
@@ -1461,15 +1528,60 @@ bool Track::icon(OIIO::ImageBuf &map, OIIO::ImageBuf &icon, int x, int y, OIIO::
 	// Image over
 	icon.specmod().x = x;
 	icon.specmod().y = y;
-	result = OIIO::ImageBufAlgo::over(map, icon, map, roi);
+	result = Blend::over(map, icon, roi);
 
 	if (!result)
-		log_error("ImageBufAlgo::over failure");
+		log_error("Blend::over failure");
 
 	return result;
 }
 
 
+void Track::rotateIconPosition(void) {
+	clearIconPositions();
+
+	if ((icon_position_buf_ == NULL) || (settings().follow() == TrackSettings::FollowNone))
+		return;
+
+	log_debug("Rotate position icon (%d steps)", IconPositionSteps);
+
+	icon_positions_.reserve(IconPositionSteps);
+
+	for (int i=0; i<IconPositionSteps; i++) {
+		double angle = 2.0 * M_PI * i / IconPositionSteps;
+
+		icon_positions_.push_back(new OIIO::ImageBuf(OIIO::ImageBufAlgo::rotate(*icon_position_buf_, angle)));
+	}
+}
+
+
+OIIO::ImageBuf * Track::iconPosition(double angle) {
+	int i;
+
+	if (icon_positions_.empty())
+		rotateIconPosition();
+
+	if (icon_positions_.empty())
+		return icon_position_buf_;
+
+	// Nearest step
+	i = (int) lround(angle * IconPositionSteps / 360.0) % IconPositionSteps;
+
+	if (i < 0)
+		i += IconPositionSteps;
+
+	return icon_positions_[i];
+}
+
+
+void Track::clearIconPositions(void) {
+	for (OIIO::ImageBuf *buf : icon_positions_)
+		delete buf;
+
+	icon_positions_.clear();
+}
+
+
 std::string Track::getIconFilename(TrackSettings::Icon icon, TrackSettings::Icon bydefault) {
 	log_call();
 
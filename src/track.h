@@ -7,6 +7,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <list>
+#include <vector>
 
 #include <stdlib.h>
 
@@ -72,6 +73,7 @@ public:
 	// Draw track path
 	void path(OIIO::ImageBuf &outbuf, TelemetrySource *source, double divider=1.0);
 	void path(OIIO::ImageBuf &outbuf, const TelemetryData &data, double divider=1.0);
+	void path(std::list<OIIO::ImageBuf *> &outbufs, const TelemetryData &data, double divider=1.0);
 
 	// Render track
 	OIIO::ImageBuf * render(const TelemetryData &data, bool &is_update);
@@ -96,8 +98,23 @@ protected:
 	void init(void);
 	bool load(void);
 
+	// Start & end positions
+	void computeEnds(void);
+
+	// Draw path (secondary color) or path progress until timestamp (primary
+	// color) in track coordinates
+	void path(cairo_t *cairo, TelemetrySource *source, double divider);
+	void progress(cairo_t *cairo, TelemetrySource *source, double divider, uint64_t timestamp);
+
 	bool icon(OIIO::ImageBuf &map, OIIO::ImageBuf &icon, int x, int y, OIIO::ROI roi);
 
+	// Position icon rotated by angle (degree), looked up in the
+	// pre-rotated icons
+	OIIO::ImageBuf * iconPosition(double angle);
+
+	void rotateIconPosition(void);
+	void clearIconPositions(void);
+
 	void xmlopen(std::ostream &os) {
 		log_call();
 
@@ -133,6 +150,11 @@ protected:
 	OIIO::ImageBuf *icon_start_buf_;
 	OIIO::ImageBuf *icon_position_buf_;
 
+	// Position icon per rotation step (follow course or heading)
+	static const int IconPositionSteps = 360;
+
+	std::vector<OIIO::ImageBuf *> icon_positions_;
+
 	TelemetryData last_wpt_;
 	TelemetryData last_data_;
 
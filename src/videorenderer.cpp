@@ -1,14 +1,26 @@
 #include <iostream>
+#include <algorithm>
 #include <memory>
+#include <thread>
+#include <filesystem>
+#include <cstring>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 
 #include "log_i.h"
+#include "blend.h"
 #include "datetime.h"
+#include "iconcache.h"
 #include "oiioutils.h"
 #include "ffmpegutils.h"
+#include "widgetatlas.h"
 #include "videorenderer.h"
 
 
@@ -21,6 +33,21 @@ VideoRenderer::VideoRenderer(GPXApplication &app,
 	decoder_gpmf_ = NULL;
 	encoder_ = NULL;
 
+	thread_decode_ = NULL;
+	thread_render_ = NULL;
+	thread_encode_ = NULL;
+
+	nb_composite_running_ = 0;
+	is_aborted_ = false;
+
+	nb_layers_reused_ = 0;
+	nb_layers_updated_ = 0;
+
+	thread_segments_ = NULL;
+	frame_offset_ = 0;
+
+	profiler_ = NULL;
+
 	frame_time_ = 0;
 	duration_ms_ = 0;
 	real_duration_ms_ = 0;
@@ -37,6 +64,8 @@ VideoRenderer::~VideoRenderer() {
 		delete decoder_video_;
 	if (decoder_gpmf_)
 		delete decoder_gpmf_;
+	if (profiler_)
+		delete profiler_;
 }
 
 
@@ -71,6 +100,10 @@ bool VideoRenderer::init(MediaContainer *container) {
 	VideoStreamPtr video_stream = container_->getVideoStream();
 	AudioStreamPtr audio_stream = container_->getAudioStream();
 
+	// Overlay only, no audio track
+	if (rendererSettings().renderOverlay())
+		audio_stream = NULL;
+
 	// Retrieve GoPro MET stream
 	StreamPtr gpmf_stream = container_->getDataStream("GoPro MET");
 
@@ -101,6 +134,18 @@ bool VideoRenderer::init(MediaContainer *container) {
 		break;
 	}
 
+	// Overlay only, use a pixel format with alpha
+	if (rendererSettings().renderOverlay()) {
+		AVPixelFormat pix_fmt = ExportCodec::getAlphaPixelFormat(video_codec);
+
+		if (pix_fmt == AV_PIX_FMT_NONE) {
+			log_error("Video codec '%s' doesn't support alpha channel", ExportCodec::getCodecName(video_codec).c_str());
+			return false;
+		}
+
+		video_params.setPixelFormat(pix_fmt);
+	}
+
 	// Encoder settings
 	EncoderSettings encoderSettings;
 	encoderSettings.setFilename(app_.settings().outputfile());
@@ -151,6 +196,20 @@ bool VideoRenderer::init(MediaContainer *container) {
 
 		break;
 
+	case ExportCodec::CodecProRes:
+		encoderSettings.setVideoOption("profile", "4444");
+		encoderSettings.setVideoOption("vendor", "apl0");
+		break;
+
+	case ExportCodec::CodecVP9:
+		encoderSettings.setVideoOption("row-mt", "1");
+
+		if (rendererSettings().videoCRF() != -1)
+			encoderSettings.setVideoOption("crf", std::to_string(rendererSettings().videoCRF()));
+		else
+			encoderSettings.setVideoBitrate(rendererSettings().videoBitrate());
+		break;
+
 	default:
 		break;
 	}
@@ -164,6 +223,14 @@ bool VideoRenderer::init(MediaContainer *container) {
 
 		encoderSettings.setAudioParams(audio_params, ExportCodec::CodecAAC);
 		encoderSettings.setAudioBitrate(44 * 1000);
+
+		// Copy input audio, AAC encoder is the fallback
+		if (rendererSettings().audioCopy() && (container_->demuxer() != NULL)) {
+			AVStream *stream = container_->demuxer()->stream(audio_stream->index());
+
+			if (stream)
+				encoderSettings.setAudioCopy(stream->codecpar);
+		}
 	}
 
 	// Compute layout size from width & height and DAR
@@ -195,8 +262,21 @@ bool VideoRenderer::init(MediaContainer *container) {
 		(unsigned int) (duration_ms_ / 3600000), (unsigned int) ((duration_ms_ / 60000) % 60), (unsigned int) ((duration_ms_ / 1000) % 60), (unsigned int) (duration_ms_ % 1000));
 	duration_[sizeof(duration_) - 1] = '\0';
 
-	// Open & decode input media
+	// Frame buffers recycled across the pipeline
+	frame_pool_ = FramePool::create();
+
+	// Per stage timings (segments are profiled by each renderer)
+	if (!isSegmented() && (!rendererSettings().renderProfile().empty() || !rendererSettings().renderTrace().empty()))
+		profiler_ = Profiler::create(!rendererSettings().renderTrace().empty());
+
+	// Open & decode input media (overlay only: demuxer is just used for
+	// stream info & keyframes, frames aren't decoded)
 	decoder_video_ = Decoder::create();
+	decoder_video_->setNativeVideo(rendererSettings().renderYUV() && !rendererSettings().renderOverlay());
+	decoder_video_->setPassive(rendererSettings().renderOverlay());
+	decoder_video_->setFramePool(frame_pool_);
+	decoder_video_->setScaleThreads(rendererSettings().renderScaleThreads());
+	decoder_video_->setProfiler(profiler_);
 	decoder_video_->open(video_stream);
 
 	if (audio_stream) {
@@ -204,14 +284,39 @@ bool VideoRenderer::init(MediaContainer *container) {
 		decoder_audio_->open(audio_stream);
 	}
 
-	// Open & decoder gpmf stream
-	if (gpmf_stream) {
+	// Open & decoder gpmf stream, only read for auto time factor & progress info
+	// (a stream attached but not read would stall the demuxer once its queue is full)
+	if (gpmf_stream && (rendererSettings().isTimeFactorAuto() || app_.progressInfo())) {
 		decoder_gpmf_ = GPMFDecoder::create();
 		decoder_gpmf_->open(gpmf_stream);
 	}
 
+	// Segment renderer, seek to the segment keyframe (rounded down to ms)
+	if (rendererSettings().isRenderSegment() && (rendererSettings().renderSegmentFrom() > 0)) {
+		int64_t target_ts = rendererSettings().renderSegmentFrom() * 1000 + 999;
+
+		frame_offset_ = llround(rendererSettings().renderSegmentFrom() * av_q2d(video_params.frameRate()) / 1000.0);
+
+		if (!rendererSettings().renderOverlay() && (decoder_video_->seek(target_ts) < 0))
+			log_warn("Video seek failure, decode from the beginning");
+
+		if (decoder_audio_)
+			decoder_audio_->seek(target_ts);
+
+		if (decoder_gpmf_)
+			decoder_gpmf_->seek(target_ts);
+	}
+
 	// Open & encode output video
 	encoder_ = Encoder::create(encoderSettings);
+	encoder_->setFramePool(frame_pool_);
+	encoder_->setScaleThreads(rendererSettings().renderScaleThreads());
+	encoder_->setProfiler(profiler_);
+
+	// Segments are encoded by the child processes
+	if (isSegmented())
+		return true;
+
 	return encoder_->open();
 }
 
@@ -286,13 +391,578 @@ bool VideoRenderer::start(void) {
 	started_at_ = now;
 	last_timecode_ms_ = 0;
 
+	// Segment renderer, restore the state at the segment start
+	if (rendererSettings().isRenderSegment()) {
+		uint64_t timestamp;
+
+		last_timecode_ms_ = rendererSettings().renderSegmentFrom();
+		real_duration_ms_ = rendererSettings().renderSegmentReal();
+
+		timestamp = start_time + real_duration_ms_;
+		timestamp -= (timestamp % telemetrySettings().telemetryRate());
+
+		if (source_) {
+			source_->retrieveFrom(data_);
+			source_->retrieveNext(data_, timestamp);
+		}
+
+		log_info("Render segment from %lu ms to %lu ms", rendererSettings().renderSegmentFrom(), rendererSettings().renderSegmentTo());
+	}
+
 	return true;
 }
 
 
 bool VideoRenderer::run(void) {
+	log_call();
+
+	// Segments are rendered by child processes
+	if (isSegmented()) {
+		if (!startSegments())
+			fail();
+
+		return true;
+	}
+
+	// Frames are processed by the pipeline threads, the last one will
+	// complete the task.
+	startPipeline();
+
+	return true;
+}
+
+
+void VideoRenderer::startPipeline(void) {
+	int nb_threads;
+	int queue_size;
+
+	log_call();
+
+	// Composite workers
+	nb_threads = rendererSettings().renderThreads();
+
+	if (nb_threads <= 0) {
+		// Keep a core for decoder, renderer & encoder
+		nb_threads = std::thread::hardware_concurrency();
+		nb_threads = MAX(1, nb_threads - 2);
+	}
+
+	queue_size = MAX(1, rendererSettings().renderQueueSize());
+
+	log_info("Render pipeline: %d composite thread(s), queue size: %d", nb_threads, queue_size);
+
+	decode_queue_.setQueueSize(queue_size);
+	composite_queue_.setQueueSize(queue_size);
+	encode_queue_.setQueueSize(queue_size);
+
+	// Keep enough free buffers for all frames in flight
+	frame_pool_->setCapacity(3 * queue_size + nb_threads + 2);
+
+	is_aborted_ = false;
+	nb_composite_running_ = nb_threads;
+
+	thread_encode_ = new std::thread([this] {
+		encode();
+	});
+
+	for (int i=0; i<nb_threads; i++) {
+		threads_composite_.push_back(new std::thread([this] {
+			composite();
+		}));
+	}
+
+	thread_render_ = new std::thread([this] {
+		render();
+	});
+
+	thread_decode_ = new std::thread([this] {
+		decode();
+	});
+}
+
+
+void VideoRenderer::stopPipeline(void) {
+	log_call();
+
+	// Wake up & stop threads still running (abort)
+	if (thread_encode_ != NULL) {
+		is_aborted_ = true;
+
+		decode_queue_.abort();
+		composite_queue_.abort();
+		encode_queue_.abort();
+	}
+
+	if (thread_decode_) {
+		thread_decode_->join();
+		delete thread_decode_;
+	}
+
+	if (thread_render_) {
+		thread_render_->join();
+		delete thread_render_;
+	}
+
+	for (std::thread *thread : threads_composite_) {
+		thread->join();
+		delete thread;
+	}
+
+	if (thread_encode_) {
+		thread_encode_->join();
+		delete thread_encode_;
+	}
+
+	thread_decode_ = NULL;
+	thread_render_ = NULL;
+	thread_encode_ = NULL;
+	threads_composite_.clear();
+
+	drawn_widgets_.clear();
+	drawn_bufs_.clear();
+	drawn_rois_.clear();
+	layers_.clear();
+}
+
+
+/**
+ * Segments
+ *
+ * Video is split at keyframes, each segment is rendered by a child
+ * gpx2video process (own decoder, encoder & widgets), then segment files
+ * are joined with a stream copy.
+ */
+
+bool VideoRenderer::isSegmented(void) {
+	return (rendererSettings().renderSegments() > 1) && !rendererSettings().isRenderSegment();
+}
+
+
+/**
+ * Real time elapsed at each segment start, as computed frame by frame by
+ * the whole video rendering (auto time factor changes along the video)
+ */
+bool VideoRenderer::segmentsRealTime(const std::vector<uint64_t> &bounds, std::vector<uint64_t> &reals) {
+	uint64_t n = 0;
+	uint64_t timecode_ms;
+	uint64_t last_timecode_ms = 0;
+
+	// Same rounding as render()
+	unsigned int real_ms = 0;
+
+	Demuxer *demuxer;
+	GPMFDecoder *decoder;
+
+	GPMFData data;
+
+	AVRational frame_rate = encoder_->settings().videoParams().frameRate();
+
+	StreamPtr gpmf_stream = container_->getDataStream("GoPro MET");
+
+	reals.clear();
+
+	// Constant time factor
+	if (!rendererSettings().isTimeFactorAuto() || !gpmf_stream) {
+		for (uint64_t from : bounds)
+			reals.push_back(rendererSettings().timeFactor() * from);
+
+		return true;
+	}
+
+	// Read GPMF stream with a demuxer of its own, so as decoders position isn't changed.
+	// GPMF samples are read from the container index, else the file is demuxed.
+	if ((demuxer = Demuxer::create(gpmf_stream->container()->filename())) == NULL)
+		return false;
+
+	decoder = GPMFDecoder::create();
+
+	if (!decoder->open(gpmf_stream, demuxer, true)) {
+		log_error("Can't read GPMF stream");
+		goto error;
+	}
+
+	for (uint64_t from : bounds) {
+		while ((timecode_ms = n * 1000 / av_q2d(frame_rate)) <= from) {
+			decoder->retrieveData(data, av_div_q(av_make_q(1000 * n, 1), frame_rate));
+
+			real_ms += data.timelapse * (timecode_ms - last_timecode_ms);
+			last_timecode_ms = timecode_ms;
+
+			n++;
+		}
+
+		reals.push_back(real_ms);
+	}
+
+	delete decoder;
+	delete demuxer;
+
+	return true;
+
+error:
+	delete decoder;
+	delete demuxer;
+
+	return false;
+}
+
+
+bool VideoRenderer::startSegments(void) {
+	int nb_segments;
+	int nb_threads;
+
+	std::vector<int64_t> keyframes;
+	std::vector<uint64_t> bounds;
+	std::vector<uint64_t> reals;
+
+	std::string start_time;
+
+	std::filesystem::path output = app_.settings().outputfile();
+
+	VideoStreamPtr video_stream = container_->getVideoStream();
+
+	log_call();
+
+	nb_segments = rendererSettings().renderSegments();
+
+	// Split at keyframes
+	if (!decoder_video_->keyframes(keyframes)) {
+		log_error("Can't read video keyframes");
+		return false;
+	}
+
+	bounds.push_back(0);
+
+	for (int i=1; i<nb_segments; i++) {
+		uint64_t target = (uint64_t) duration_ms_ * i / nb_segments;
+
+		for (int64_t ts : keyframes) {
+			uint64_t ms = ts * av_q2d(video_stream->timeBase()) * 1000;
+
+			if ((ms >= target) && (ms > bounds.back())) {
+				bounds.push_back(ms);
+				break;
+			}
+		}
+	}
+
+	nb_segments = bounds.size();
+
+	// Segment renderers start with the real time elapsed
+	if (!segmentsRealTime(bounds, reals))
+		return false;
+
+	// Share compositing threads between segments
+	nb_threads = rendererSettings().renderThreads();
+
+	if (nb_threads <= 0)
+		nb_threads = MAX(1, (int) std::thread::hardware_concurrency() / nb_segments);
+
+	// Keep synchronized video start time
+	start_time = Datetime::timestamp2string(container_->startTime(), Datetime::FormatDatetime, true) + "Z";
+
+	log_notice("Render %d segments...", nb_segments);
+
+	for (int i=0; i<nb_segments; i++) {
+		pid_t pid;
+
+		std::vector<std::string> args = app_.arguments();
+		std::vector<char *> argv;
+
+		std::string range = std::to_string(bounds[i]) + ":" + ((i + 1 < nb_segments) ? std::to_string(bounds[i + 1]) : "");
+
+		std::filesystem::path file = output.parent_path()
+			/ (output.stem().string() + ".part" + std::to_string(i) + output.extension().string());
+
+		args.insert(args.end(), {
+			"--render-segment", range + ":" + std::to_string(reals[i]),
+			"--render-threads", std::to_string(nb_threads),
+			"--start-time", start_time,
+			"--output", file.string()
+		});
+
+		for (std::string &arg : args)
+			argv.push_back((char *) arg.c_str());
+		argv.push_back(NULL);
+
+		log_info("Segment %d: [%s[ => %s (real time: %lu ms)", i, range.c_str(), file.c_str(), reals[i]);
+
+		if ((pid = fork()) < 0) {
+			log_error("Can't spawn segment renderer");
+			goto error;
+		}
+
+		if (pid == 0) {
+			int fd = ::open("/dev/null", O_WRONLY);
+
+			// Progress output only from the main process
+			if (fd >= 0) {
+				dup2(fd, STDOUT_FILENO);
+				::close(fd);
+			}
+
+			// Same binary, whatever PATH & working directory
+			execv("/proc/self/exe", argv.data());
+
+			_exit(EXIT_FAILURE);
+		}
+
+		segments_pid_.push_back(pid);
+		segments_file_.push_back(file.string());
+	}
+
+	if (segments_pid_.empty())
+		return false;
+
+	thread_segments_ = new std::thread([this] {
+		waitSegments();
+	});
+
+	return true;
+
+error:
+	// Partial video is useless, stop segments already spawned
+	for (pid_t pid : segments_pid_)
+		kill(pid, SIGTERM);
+
+	for (pid_t pid : segments_pid_)
+		waitpid(pid, NULL, 0);
+
+	for (std::string &file : segments_file_)
+		::unlink(file.c_str());
+
+	segments_pid_.clear();
+	segments_file_.clear();
+
+	return false;
+}
+
+
+void VideoRenderer::waitSegments(void) {
+	bool success = true;
+
+	log_call();
+
+	for (size_t i=0; i<segments_pid_.size(); i++) {
+		int status = 0;
+
+		if (waitpid(segments_pid_[i], &status, 0) < 0)
+			status = -1;
+
+		segments_pid_[i] = 0;
+
+		if (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+			log_error("Segment %lu rendering failure", i);
+			success = false;
+		}
+		else
+			log_notice("Segment %lu/%lu rendered", i + 1, segments_pid_.size());
+	}
+
+	if (success && !is_aborted_) {
+		log_notice("Join segments...");
+
+		if (!FFmpegUtils::concat(segments_file_, app_.settings().outputfile())) {
+			log_error("Join segments failure");
+			success = false;
+		}
+	}
+
+	for (std::string &file : segments_file_)
+		::unlink(file.c_str());
+
+	if (is_aborted_)
+		return;
+
+	if (success)
+		complete();
+	else
+		fail();
+}
+
+
+void VideoRenderer::stopSegments(void) {
+	log_call();
+
+	if (thread_segments_ == NULL)
+		return;
+
+	// Abort, stop child processes still running
+	is_aborted_ = true;
+
+	for (pid_t pid : segments_pid_) {
+		if (pid > 0)
+			kill(pid, SIGTERM);
+	}
+
+	thread_segments_->join();
+	delete thread_segments_;
+
+	thread_segments_ = NULL;
+
+	segments_pid_.clear();
+	segments_file_.clear();
+}
+
+
+std::string VideoRenderer::profileFilename(const std::string &filename) {
+	std::filesystem::path path(filename);
+
+	if (!rendererSettings().isRenderSegment())
+		return filename;
+
+	// One report per segment renderer
+	path.replace_filename(path.stem().string() + ".segment" + std::to_string(rendererSettings().renderSegmentFrom()) + path.extension().string());
+
+	return path.string();
+}
+
+
+/**
+ * Decoder stage
+ */
+
+void VideoRenderer::decode(void) {
+	int64_t index = 0;
+	int64_t position = 0;
+
+	JobPtr job;
 	FramePtr frame;
 
+	AVRational video_time;
+
+	VideoStreamPtr video_stream = container_->getVideoStream();
+
+	log_call();
+
+	if (profiler_)
+		profiler_->setThreadName("decode");
+
+	while (!is_aborted_) {
+		video_time = av_div_q(av_make_q(1000 * (frame_offset_ + index), 1), encoder_->settings().videoParams().frameRate());
+
+		// Read video data or create a transparent frame
+		{
+			Profiler::Scope scope(profiler_, "decode", index);
+
+			if (rendererSettings().renderOverlay())
+				frame = createOverlayFrame(frame_offset_ + position++);
+			else
+				frame = decoder_video_->retrieveVideo(video_time);
+		}
+
+		if (frame == NULL)
+			break;
+
+		// Segment renderer, keep only frames in [from:to[
+		if (rendererSettings().isRenderSegment()) {
+			uint64_t timecode_ms = frame->timestamp() * av_q2d(video_stream->timeBase()) * 1000;
+
+			if (timecode_ms < rendererSettings().renderSegmentFrom())
+				continue;
+
+			if ((rendererSettings().renderSegmentTo() != 0) && (timecode_ms >= rendererSettings().renderSegmentTo()))
+				break;
+		}
+
+		job = std::make_shared<Job>();
+		job->index = index;
+		job->frame = frame;
+		job->video_time = video_time;
+
+		if (!decode_queue_.push(job))
+			break;
+
+		index++;
+	}
+
+	decode_queue_.close();
+}
+
+
+FramePtr VideoRenderer::createOverlayFrame(int64_t index) {
+	int64_t timestamp;
+	uint64_t timecode_ms;
+
+	size_t size;
+	uint8_t *data;
+
+	VideoParams::Format format;
+
+	VideoStreamPtr video_stream = container_->getVideoStream();
+
+	const VideoParams &params = encoder_->settings().videoParams();
+
+	// Frame timestamp, at the source video frame rate
+	timestamp = av_rescale_q(index, av_inv_q(params.frameRate()), video_stream->timeBase());
+	timecode_ms = timestamp * av_q2d(video_stream->timeBase()) * 1000;
+
+	if (timecode_ms >= duration_ms_)
+		return NULL;
+
+	// RGBA buffer as expected by the encoder
+	if (FFmpegUtils::getCompatiblePixelFormat(params.pixelFormat()) == AV_PIX_FMT_RGBA64)
+		format = VideoParams::FormatUnsigned16;
+	else
+		format = VideoParams::FormatUnsigned8;
+
+	FramePtr frame = Frame::create();
+
+	frame->setVideoParams(VideoParams(params.width(), params.height(),
+		video_stream->timeBase(),
+		format,
+		VideoParams::RGBAChannelCount,
+		params.orientation(),
+		params.pixelAspectRatio(),
+		params.interlacing()));
+
+	// Transparent background
+	size = (size_t) frame->linesizeBytes() * params.height();
+
+	if ((data = frame_pool_->acquire(size)) == NULL)
+		return NULL;
+
+	memset(data, 0, size);
+
+	frame->setTimestamp(timestamp);
+	frame->setDuration(av_q2d(av_inv_q(params.frameRate())));
+	frame->setData(data, frame_pool_, size);
+
+	return frame;
+}
+
+
+/**
+ * Render stage
+ *
+ * Telemetry & widgets are stateful, so this stage is processed in the
+ * frame order by only one thread.
+ */
+
+void VideoRenderer::render(void) {
+	JobPtr job;
+
+	log_call();
+
+	if (profiler_)
+		profiler_->setThreadName("render");
+
+	while (decode_queue_.pop(job)) {
+		if (!render(job))
+			break;
+
+		if (!composite_queue_.push(job))
+			break;
+	}
+
+	// Unlock decoder if stopped before the end of stream
+	decode_queue_.abort();
+
+	composite_queue_.close();
+}
+
+
+bool VideoRenderer::render(JobPtr job) {
 	double sar;
 	int orientation;
 
@@ -305,23 +975,31 @@ bool VideoRenderer::run(void) {
 
 	double time_factor;
 
-	int duration;
 	unsigned int real_duration_ms;
 
-	AVRational video_time;
-
 	bool is_update = false;
 
-	OIIO::ImageBuf frame_buffer;
+	AVColorSpace color_space;
+
+	std::vector<VideoWidget *> widgets;
+	std::vector<OIIO::ImageBuf *> bufs;
+	std::vector<bool> updates;
+
+	size_t n = 0;
 
 	VideoStreamPtr video_stream = container_->getVideoStream();
-//	AudioStreamPtr audio_stream = container_->getAudioStream();
+
+	Profiler::Scope scope(profiler_, "render", job->index);
 
 	time_factor = rendererSettings().timeFactor();
 
-	start_time = container_->startTime();
+	// YUV matrix, if unspecified guess from the video size
+	color_space = decoder_video_->colorSpace();
 
-	video_time = av_div_q(av_make_q(1000 * frame_time_, 1), encoder_->settings().videoParams().frameRate());
+	if (color_space == AVCOL_SPC_UNSPECIFIED)
+		color_space = (video_stream->height() >= 720) ? AVCOL_SPC_BT709 : AVCOL_SPC_SMPTE170M;
+
+	start_time = container_->startTime();
 
 	// SAR & orientation video
 	sar = av_q2d(encoder_->settings().videoParams().pixelAspectRatio());
@@ -329,45 +1007,32 @@ bool VideoRenderer::run(void) {
 
 	// Read GPMF data
 	if (decoder_gpmf_) {
-		decoder_gpmf_->retrieveData(gpmf_data_, video_time);
+		decoder_gpmf_->retrieveData(gpmf_data_, job->video_time);
 
 		if (rendererSettings().isTimeFactorAuto())
 			time_factor = gpmf_data_.timelapse;
 	}
-	
-	// Read audio data
-	if (decoder_audio_) {
-		duration = round(av_q2d(av_div_q(av_make_q(1000 * (frame_time_ + 1), 1), encoder_->settings().videoParams().frameRate())));
-		duration -= round(av_q2d(video_time));
 
-		do {
-			frame = decoder_audio_->retrieveAudio(encoder_->settings().audioParams(), video_time, duration);
+	timecode = job->frame->timestamp();
+	timecode_ms = timecode * av_q2d(video_stream->timeBase()) * 1000;
 
-			if (frame != NULL)
-				encoder_->writeAudio(frame, video_time);
-		} while (frame != NULL);
+	// Max rendering duration
+	if (app_.settings().maxDuration() > 0) {
+		if (timecode_ms > app_.settings().maxDuration())
+			return false;
 	}
 
-	// Read video data
-	frame = decoder_video_->retrieveVideo(video_time);
-
-	if (frame == NULL)
-		goto done;
-
-	timecode = frame->timestamp();
-	timecode_ms = timecode * av_q2d(video_stream->timeBase()) * 1000;
-
 	// Update video real time 
 	datetime = start_time + real_duration_ms_;
 	timestamp = start_time + real_duration_ms_;
 
-	// Convert video frame to image
-	frame_buffer = frame->toImageBuf();
-
 	// Read GPX data
 	timestamp -= (timestamp % telemetrySettings().telemetryRate());
-	if (source_)
+	if (source_) {
+		Profiler::Scope scope(profiler_, "telemetry", job->index);
+
 		source_->retrieveNext(data_, timestamp);
+	}
 
 	// Set current datetime
 	data_.setDatetime(datetime);
@@ -376,6 +1041,8 @@ bool VideoRenderer::run(void) {
 	for (VideoWidget *widget : widgets_) {
 		OIIO::ImageBuf *buf = NULL;
 
+		size_t i = n++;
+
 		uint64_t begin = widget->atBeginTime();
 		uint64_t end = widget->atEndTime();
 
@@ -390,6 +1057,9 @@ bool VideoRenderer::run(void) {
 			continue;
 
 		// Render dynamic widget
+		Profiler::Scope scope(profiler_, profiler_ ? "widget." + std::to_string(i) + "." + widget->name() : "", job->index);
+
+		is_update = false;
 		buf = widget->render(data_, is_update);
 
 		if (buf == NULL)
@@ -401,19 +1071,330 @@ bool VideoRenderer::run(void) {
 			this->rotate(buf, orientation);
 		}
 
-		// Image over
+		// Widget position
 		buf->specmod().x = widget->x();
 		buf->specmod().y = widget->y();
-		OIIO::ImageBufAlgo::over(frame_buffer, *buf, frame_buffer, buf->roi());
+
+		widgets.push_back(widget);
+		bufs.push_back(buf);
+		updates.push_back(is_update);
 	}
 
-	// Upate video frame
-	frame->fromImageBuf(frame_buffer);
+	// Pre-composite widgets, unchanged areas are reused as is
+	{
+		Profiler::Scope scope(profiler_, "layers", job->index);
 
-	// Max rendering duration
-	if (app_.settings().maxDuration() > 0) {
-		if (timecode_ms > app_.settings().maxDuration())
-			goto done;
+		updateLayers(widgets, bufs, updates, color_space);
+	}
+
+	for (Layer &layer : layers_) {
+		if (decoder_video_->isNativeVideo()) {
+			if (layer.overlay != NULL)
+				job->overlays.push_back(layer.overlay);
+		}
+		else if (layer.buf != NULL)
+			job->layers.push_back(layer.buf);
+	}
+
+	// Compute real time by step, since time_factor is variable
+	real_duration_ms = timecode_ms - last_timecode_ms_;
+	real_duration_ms_ += time_factor * real_duration_ms;
+
+	last_timecode_ms_ = timecode_ms;
+
+	job->timecode = timecode;
+	job->timecode_ms = timecode_ms;
+	job->datetime = datetime;
+	job->time_factor = time_factor;
+
+	if (app_.progressInfo()) {
+		job->data = data_;
+		job->gpmf_data = gpmf_data_;
+	}
+
+	return true;
+}
+
+
+static bool isOverlapping(const OIIO::ROI &a, const OIIO::ROI &b) {
+	OIIO::ROI roi = OIIO::roi_intersection(a, b);
+
+	return (roi.width() > 0) && (roi.height() > 0);
+}
+
+
+void VideoRenderer::updateLayers(const std::vector<VideoWidget *> &widgets, const std::vector<OIIO::ImageBuf *> &bufs,
+	const std::vector<bool> &updates, AVColorSpace color_space) {
+	bool is_regroup;
+
+	std::vector<bool> dirty(widgets.size(), false);
+	std::vector<OIIO::ROI> rois(widgets.size());
+
+	// Widgets list or position changed, group widgets again
+	is_regroup = (widgets != drawn_widgets_);
+
+	for (size_t i=0; i<widgets.size(); i++) {
+		rois[i] = bufs[i]->roi();
+
+		if (is_regroup)
+			continue;
+
+		if (rois[i] != drawn_rois_[i])
+			is_regroup = true;
+		else if (updates[i] || (bufs[i] != drawn_bufs_[i]))
+			dirty[i] = true;
+	}
+
+	if (is_regroup) {
+		layers_.clear();
+
+		for (size_t i=0; i<widgets.size(); i++) {
+			Layer layer;
+
+			layer.roi = rois[i];
+			layer.widgets.push_back(i);
+
+			// Merge overlapping areas (restart since the area grows)
+			for (auto it = layers_.begin(); it != layers_.end(); ) {
+				if (isOverlapping(it->roi, layer.roi)) {
+					layer.roi = OIIO::roi_union(it->roi, layer.roi);
+					layer.widgets.insert(layer.widgets.end(), it->widgets.begin(), it->widgets.end());
+
+					layers_.erase(it);
+					it = layers_.begin();
+				}
+				else
+					it++;
+			}
+
+			// Keep widgets order
+			std::sort(layer.widgets.begin(), layer.widgets.end());
+
+			layers_.push_back(layer);
+		}
+	}
+
+	for (Layer &layer : layers_) {
+		bool is_dirty = is_regroup;
+
+		for (size_t i : layer.widgets)
+			is_dirty |= dirty[i];
+
+		if (!is_dirty) {
+			nb_layers_reused_++;
+			continue;
+		}
+
+		nb_layers_updated_++;
+
+		layer.buf = NULL;
+		layer.overlay = NULL;
+
+		// Composite workers still blend the previous bitmap, so it's
+		// never updated in place.
+		if (layer.widgets.size() == 1) {
+			OIIO::ImageBuf *buf = bufs[layer.widgets[0]];
+
+			if (decoder_video_->isNativeVideo())
+				layer.overlay = YUVOverlay::create(*buf, decoder_video_->pixelFormat(), color_space, decoder_video_->colorRange());
+			else
+				layer.buf = std::make_shared<OIIO::ImageBuf>(*buf);
+		}
+		else {
+			OIIO::TypeDesc format = OIIO::TypeDesc::UINT8;
+
+			for (size_t i : layer.widgets) {
+				if (bufs[i]->spec().format != OIIO::TypeDesc::UINT8)
+					format = bufs[i]->spec().format;
+			}
+
+			OIIO::ImageSpec spec(layer.roi.width(), layer.roi.height(), 4, format);
+			spec.x = layer.roi.xbegin;
+			spec.y = layer.roi.ybegin;
+			spec.alpha_channel = 3;
+
+			layer.buf = std::make_shared<OIIO::ImageBuf>(spec);
+			OIIO::ImageBufAlgo::zero(*layer.buf);
+
+			for (size_t i : layer.widgets)
+				Blend::over(*layer.buf, *bufs[i]);
+
+			// Convert layer bitmap to the video YUV format
+			if (decoder_video_->isNativeVideo()) {
+				layer.overlay = YUVOverlay::create(*layer.buf, decoder_video_->pixelFormat(), color_space, decoder_video_->colorRange());
+				layer.buf = NULL;
+			}
+		}
+	}
+
+	drawn_widgets_ = widgets;
+	drawn_bufs_ = bufs;
+	drawn_rois_ = rois;
+}
+
+
+/**
+ * Composite stage
+ */
+
+void VideoRenderer::composite(void) {
+	JobPtr job;
+
+	log_call();
+
+	if (profiler_)
+		profiler_->setThreadName("composite");
+
+	while (composite_queue_.pop(job)) {
+		composite(job);
+
+		if (!encode_queue_.push(job))
+			break;
+	}
+
+	// Last worker closes the encoder queue
+	if (--nb_composite_running_ == 0)
+		encode_queue_.close();
+}
+
+
+void VideoRenderer::composite(JobPtr job) {
+	AVFrame *avframe = job->frame->avFrame();
+
+	Profiler::Scope scope(profiler_, "blend", job->index);
+
+	// Native YUV frame, blend only widget areas
+	if (avframe != NULL) {
+		// Decoder may yet reference the frame buffer
+		if (av_frame_make_writable(avframe) < 0) {
+			log_error("Failed to make video frame writable");
+			return;
+		}
+
+		for (YUVOverlayPtr &overlay : job->overlays)
+			overlay->blend(avframe);
+
+		job->overlays.clear();
+
+		return;
+	}
+
+	// Wrap video frame data (no copy)
+	OIIO::ImageBuf frame_buffer = job->frame->toImageBuf();
+
+	// Image over (one thread per frame, workers run in parallel)
+	for (std::shared_ptr<OIIO::ImageBuf> &buf : job->layers)
+		Blend::over(frame_buffer, *buf, buf->roi());
+
+	// Overlay only, alpha codecs expect straight (not premultiplied) colors
+	if (rendererSettings().renderOverlay() && !job->layers.empty()) {
+		OIIO::ROI roi = job->layers.front()->roi();
+
+		// Layer areas may overlap, unpremult each pixel only once
+		for (std::shared_ptr<OIIO::ImageBuf> &buf : job->layers)
+			roi = OIIO::roi_union(roi, buf->roi());
+
+		frame_buffer.specmod().alpha_channel = 3;
+
+		OIIO::ImageBufAlgo::unpremult(frame_buffer, frame_buffer, OIIO::roi_intersection(roi, frame_buffer.roi()), 1);
+	}
+
+	// Upate video frame (no-op if frame data is wrapped)
+	job->frame->fromImageBuf(frame_buffer);
+
+	job->layers.clear();
+}
+
+
+/**
+ * Encoder stage
+ *
+ * Composite workers complete the frames in any order, frames are
+ * written as soon as the next one is available.
+ */
+
+void VideoRenderer::encode(void) {
+	JobPtr job;
+
+	std::map<int64_t, JobPtr> pending;
+	std::map<int64_t, JobPtr>::iterator it;
+
+	log_call();
+
+	if (profiler_)
+		profiler_->setThreadName("encode");
+
+	while (encode_queue_.pop(job)) {
+		pending[job->index] = job;
+
+		while ((it = pending.find(frame_time_)) != pending.end()) {
+			if (!encode(it->second))
+				goto error;
+
+			pending.erase(it);
+		}
+	}
+
+	if (!pending.empty())
+		log_warn("%lu frame(s) dropped", pending.size());
+
+	if (!is_aborted_)
+		complete();
+
+	return;
+
+error:
+	log_error("Video encoding failure, rendering aborted");
+
+	// Stop the other pipeline threads
+	is_aborted_ = true;
+
+	decode_queue_.abort();
+	composite_queue_.abort();
+	encode_queue_.abort();
+
+	fail();
+}
+
+
+bool VideoRenderer::encode(JobPtr job) {
+	FramePtr frame;
+
+	int duration;
+
+	AVRational video_time;
+
+	VideoStreamPtr video_stream = container_->getVideoStream();
+
+	video_time = job->video_time;
+
+	// Read audio data
+	if (decoder_audio_) {
+		Profiler::Scope scope(profiler_, "audio", job->index);
+
+		duration = round(av_q2d(av_div_q(av_make_q(1000 * (frame_offset_ + frame_time_ + 1), 1), encoder_->settings().videoParams().frameRate())));
+		duration -= round(av_q2d(video_time));
+
+		if (encoder_->isAudioCopy()) {
+			AVPacket *packet;
+
+			while ((packet = decoder_audio_->retrieveAudioPacket(video_time, duration)) != NULL) {
+				bool success = encoder_->writeAudioPacket(packet);
+
+				av_packet_free(&packet);
+
+				if (!success)
+					return false;
+			}
+		}
+		else {
+			do {
+				frame = decoder_audio_->retrieveAudio(encoder_->settings().audioParams(), video_time, duration);
+
+				if ((frame != NULL) && !encoder_->writeAudio(frame, video_time))
+					return false;
+			} while (frame != NULL);
+		}
 	}
 
 	// Dump frame info
@@ -422,15 +1403,15 @@ bool VideoRenderer::run(void) {
 
 		if (app_.progressInfo()) {
 			printf("FRAME: %ld - PTS: %ld - TIMESTAMP: %ld ms - TIME: %s (x %.01f)\n", 
-				frame_time_, timecode, timecode_ms, Datetime::timestamp2string(datetime).c_str(), time_factor);
+				frame_time_, job->timecode, job->timecode_ms, Datetime::timestamp2string(job->datetime).c_str(), job->time_factor);
 		}
 		else {
-			int percent = 100 * timecode_ms / duration_ms_;
-			int remaining = (timecode_ms > 0) ? (now - started_at_) * (duration_ms_ - timecode_ms) / timecode_ms : -1;
+			int percent = 100 * job->timecode_ms / duration_ms_;
+			int remaining = (job->timecode_ms > 0) ? (now - started_at_) * (duration_ms_ - job->timecode_ms) / job->timecode_ms : -1;
 
 			printf("\r[FRAME %5ld] %02d:%02d:%02d.%03d / %s | %3d%% - Remaining time: %02d:%02d:%02d", 
 				frame_time_, 
-				(int) (timecode_ms / 3600000), (int) ((timecode_ms / 60000) % 60), (int) ((timecode_ms / 1000) % 60), (int) (timecode_ms % 1000),
+				(int) (job->timecode_ms / 3600000), (int) ((job->timecode_ms / 60000) % 60), (int) ((job->timecode_ms / 1000) % 60), (int) (job->timecode_ms % 1000),
 				duration_,
 				percent,
 				(remaining / 3600), (remaining / 60) % 60, (remaining) % 60
@@ -439,34 +1420,22 @@ bool VideoRenderer::run(void) {
 		}
 	}
 
-	// Compute real time by step, since time_factor is variable
-	real_duration_ms = timecode_ms - last_timecode_ms_;
-	real_duration_ms_ += time_factor * real_duration_ms;
-
 	// Dump GPMF data
 	if (decoder_gpmf_ && app_.progressInfo())
-		gpmf_data_.dump();
+		job->gpmf_data.dump();
 
 	// Dump telemetry data
 	if (source_ && app_.progressInfo())
-		data_.dump();
+		job->data.dump();
 
-	video_time = av_mul_q(av_make_q(timecode, 1), video_stream->timeBase());
+	video_time = av_mul_q(av_make_q(job->timecode, 1), video_stream->timeBase());
 
-	encoder_->writeFrame(frame, video_time);
+	if (!encoder_->writeFrame(job->frame, video_time))
+		return false;
 
 	// Next frame
 	frame_time_++;
 
-	last_timecode_ms_ = timecode_ms;
-
-	schedule();
-
-	return true;
-
-done:
-	complete();
-
 	return true;
 }
 
@@ -474,7 +1443,13 @@ done:
 bool VideoRenderer::stop(void) {
 	int working;
 
-	time_t now = ::time(NULL);
+	time_t now;
+
+	// Wait for pipeline threads or segment renderers
+	stopPipeline();
+	stopSegments();
+
+	now = ::time(NULL);
 
 	if (!app_.progressInfo())
 		printf("\n");
@@ -485,7 +1460,13 @@ bool VideoRenderer::stop(void) {
 	// Sum-up
 	working = now - started_at_;
 
-	if (started_at_ > 0) 
+	if (isSegmented() && (started_at_ > 0))
+		printf("%d segments %dx%d to %dx%d proceed in %02d:%02d:%02d\n",
+			rendererSettings().renderSegments(),
+			video_stream->width(), video_stream->height(),
+			encoder_->settings().videoParams().width(), encoder_->settings().videoParams().height(),
+			(working / 3600), (working / 60) % 60, (working) % 60);
+	else if (started_at_ > 0) 
 		printf("%ld frames %dx%d to %dx%d proceed in %02d:%02d:%02d\n",
 			frame_time_,
 			video_stream->width(), video_stream->height(),
@@ -494,7 +1475,20 @@ bool VideoRenderer::stop(void) {
 	else
 		printf("None frame proceed\n");
 
-	encoder_->close();
+	log_info("Overlay cache: %lu layer(s) reused, %lu composited", nb_layers_reused_, nb_layers_updated_);
+	log_info("Icon cache: %lu hit(s), %lu miss(es)", IconCache::hits(), IconCache::misses());
+	log_info("Widget atlas: %lu hit(s), %lu miss(es)", WidgetAtlas::hits(), WidgetAtlas::misses());
+
+	if (frame_pool_ != NULL)
+		log_info("Frame pool: %lu hit(s), %lu miss(es), %lu MB allocated",
+			frame_pool_->hits(), frame_pool_->misses(), frame_pool_->size() / (1024 * 1024));
+
+	// Output file incomplete, exit with failure
+	if (!encoder_->close()) {
+		log_error("Output video write failure");
+		app_.setExitStatus(EXIT_FAILURE);
+	}
+
 	if (decoder_audio_)
 		decoder_audio_->close();
 	decoder_video_->close();
@@ -508,6 +1502,32 @@ bool VideoRenderer::stop(void) {
 	decoder_audio_ = NULL;
 	decoder_video_ = NULL;
 
+	// Per stage timings report
+	if (profiler_) {
+		profiler_->setCounter("icons.hits", IconCache::hits());
+		profiler_->setCounter("icons.misses", IconCache::misses());
+		profiler_->setCounter("atlas.hits", WidgetAtlas::hits());
+		profiler_->setCounter("atlas.misses", WidgetAtlas::misses());
+		profiler_->setCounter("layers.reused", nb_layers_reused_);
+		profiler_->setCounter("layers.composited", nb_layers_updated_);
+
+		if (frame_pool_ != NULL) {
+			profiler_->setCounter("framepool.hits", frame_pool_->hits());
+			profiler_->setCounter("framepool.misses", frame_pool_->misses());
+		}
+
+		profiler_->dump();
+
+		if (!rendererSettings().renderProfile().empty())
+			profiler_->save(profileFilename(rendererSettings().renderProfile()));
+
+		if (!rendererSettings().renderTrace().empty())
+			profiler_->saveTrace(profileFilename(rendererSettings().renderTrace()));
+
+		delete profiler_;
+		profiler_ = NULL;
+	}
+
 	// Register task status
 	Renderer::stop();
 
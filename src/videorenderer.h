@@ -1,12 +1,60 @@
 #ifndef __GPX2VIDEO__VIDEORENDERER_H__
 #define __GPX2VIDEO__VIDEORENDERER_H__
 
+#include <map>
+#include <list>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <string>
+
+#include <sys/types.h>
+
 #include "gpmf.h"
+#include "framepool.h"
+#include "profiler.h"
 #include "renderer.h"
+#include "workqueue.h"
+#include "yuvoverlay.h"
 
 
 class VideoRenderer : public Renderer {
 public:
+	class Job {
+	public:
+		Job() {
+			index = 0;
+			video_time = av_make_q(0, 1);
+			timecode = 0;
+			timecode_ms = 0;
+			datetime = 0;
+			time_factor = 1.0;
+		}
+
+		int64_t index;
+
+		FramePtr frame;
+
+		AVRational video_time;
+
+		int64_t timecode;
+		uint64_t timecode_ms;
+		uint64_t datetime;
+
+		double time_factor;
+
+		// Widget bitmaps to blend (read only)
+		std::list<std::shared_ptr<OIIO::ImageBuf> > layers;
+		std::list<YUVOverlayPtr> overlays;
+
+		// Progress info dump
+		TelemetryData data;
+		GPMFData gpmf_data;
+	};
+
+	using JobPtr = std::shared_ptr<Job>;
+
 	virtual ~VideoRenderer();
 
 	static VideoRenderer * create(GPXApplication &app, 
@@ -34,11 +82,82 @@ protected:
 
 	GPMFData gpmf_data_;
 
+	// Recycled frame buffers, shared by decoder, pipeline & encoder
+	FramePoolPtr frame_pool_;
+
+	// Per stage timings (NULL if disabled)
+	Profiler *profiler_;
+
+	// Pipeline: decode -> render -> composite (x N) -> encode
+	std::thread *thread_decode_;
+	std::thread *thread_render_;
+	std::thread *thread_encode_;
+	std::vector<std::thread *> threads_composite_;
+
+	WorkQueue<JobPtr> decode_queue_;
+	WorkQueue<JobPtr> composite_queue_;
+	WorkQueue<JobPtr> encode_queue_;
+
+	std::atomic<int> nb_composite_running_;
+	std::atomic<bool> is_aborted_;
+
+	// Skip-render cache: widgets drawn on the previous frame are
+	// pre-composited per overlapping area. Only areas with a dirty widget
+	// are composited again, the others are shared as is by the next jobs.
+	class Layer {
+	public:
+		OIIO::ROI roi;
+		std::vector<size_t> widgets;
+
+		std::shared_ptr<OIIO::ImageBuf> buf;
+		YUVOverlayPtr overlay;
+	};
+
+	std::vector<VideoWidget *> drawn_widgets_;
+	std::vector<OIIO::ImageBuf *> drawn_bufs_;
+	std::vector<OIIO::ROI> drawn_rois_;
+	std::vector<Layer> layers_;
+
+	uint64_t nb_layers_reused_;
+	uint64_t nb_layers_updated_;
+
+	// Segments: rendered in parallel by child processes, then concatenated
+	std::thread *thread_segments_;
+	std::vector<pid_t> segments_pid_;
+	std::vector<std::string> segments_file_;
+
+	// Segment renderer: index of the first frame
+	int64_t frame_offset_;
+
 	VideoRenderer(GPXApplication &app, 
 			RendererSettings &rendererSettings, TelemetrySettings &telemetrySettings); //, Map *map);
 
 	bool init(MediaContainer *container);
 	void computeWidgetsPosition(void);
+
+	void startPipeline(void);
+	void stopPipeline(void);
+
+	bool isSegmented(void);
+	bool segmentsRealTime(const std::vector<uint64_t> &bounds, std::vector<uint64_t> &reals);
+	bool startSegments(void);
+	void waitSegments(void);
+	void stopSegments(void);
+
+	std::string profileFilename(const std::string &filename);
+
+	void decode(void);
+	void render(void);
+	void composite(void);
+	void encode(void);
+
+	FramePtr createOverlayFrame(int64_t index);
+
+	bool render(JobPtr job);
+	void updateLayers(const std::vector<VideoWidget *> &widgets, const std::vector<OIIO::ImageBuf *> &bufs,
+		const std::vector<bool> &updates, AVColorSpace color_space);
+	void composite(JobPtr job);
+	bool encode(JobPtr job);
 };
 
 #endif
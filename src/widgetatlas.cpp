@@ -0,0 +1,178 @@
+#include <iostream>
+#include <cstring>
+
+#include "log_i.h"
+#include "widgetatlas.h"
+
+
+std::mutex WidgetAtlas::mutex_;
+
+size_t WidgetAtlas::capacity_ = 0;
+
+std::map<std::string, WidgetAtlas::Frame> WidgetAtlas::frames_;
+std::list<std::string> WidgetAtlas::lru_;
+size_t WidgetAtlas::size_ = 0;
+
+uint64_t WidgetAtlas::nb_hits_ = 0;
+uint64_t WidgetAtlas::nb_misses_ = 0;
+
+
+std::string WidgetAtlas::id(const void *owner, const std::string &key) {
+	char s[32];
+
+	snprintf(s, sizeof(s), "%p|", owner);
+
+	return std::string(s) + key;
+}
+
+
+void WidgetAtlas::setSize(size_t size) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	capacity_ = size;
+
+	// Drop least recently used frames
+	while (!lru_.empty() && (size_ > capacity_)) {
+		auto last = frames_.find(lru_.back());
+
+		size_ -= last->second.pixels.size();
+
+		frames_.erase(last);
+		lru_.pop_back();
+	}
+}
+
+
+bool WidgetAtlas::isEnabled(void) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	return (capacity_ > 0);
+}
+
+
+bool WidgetAtlas::load(const void *owner, const std::string &key, OIIO::ImageBuf *buf) {
+	const OIIO::ImageSpec &spec = buf->spec();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (capacity_ == 0)
+		return false;
+
+	auto it = frames_.find(id(owner, key));
+
+	if (it == frames_.end()) {
+		nb_misses_++;
+		return false;
+	}
+
+	Frame &frame = it->second;
+
+	// Bitmap changed (resized, rotated...)
+	if ((frame.width != spec.width) || (frame.height != spec.height) || (frame.nchannels != spec.nchannels)
+		|| (spec.format != OIIO::TypeDesc::UINT8) || (buf->localpixels() == NULL)) {
+		nb_misses_++;
+		return false;
+	}
+
+	nb_hits_++;
+
+	memcpy(buf->localpixels(), frame.pixels.data(), frame.pixels.size());
+
+	// Most recently used
+	lru_.splice(lru_.begin(), lru_, frame.lru);
+
+	return true;
+}
+
+
+void WidgetAtlas::save(const void *owner, const std::string &key, const OIIO::ImageBuf *buf) {
+	size_t size;
+
+	Frame frame;
+
+	const OIIO::ImageSpec &spec = buf->spec();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if ((spec.format != OIIO::TypeDesc::UINT8) || (buf->localpixels() == NULL))
+		return;
+
+	size = (size_t) spec.width * spec.height * spec.nchannels;
+
+	if ((capacity_ == 0) || (size > capacity_))
+		return;
+
+	std::string s = id(owner, key);
+
+	// Replace previous frame
+	auto it = frames_.find(s);
+
+	if (it != frames_.end()) {
+		size_ -= it->second.pixels.size();
+
+		lru_.erase(it->second.lru);
+		frames_.erase(it);
+	}
+
+	// Drop least recently used frames
+	while (!lru_.empty() && (size_ + size > capacity_)) {
+		auto last = frames_.find(lru_.back());
+
+		size_ -= last->second.pixels.size();
+
+		frames_.erase(last);
+		lru_.pop_back();
+	}
+
+	frame.width = spec.width;
+	frame.height = spec.height;
+	frame.nchannels = spec.nchannels;
+	frame.pixels.assign((const uint8_t *) buf->localpixels(), (const uint8_t *) buf->localpixels() + size);
+
+	lru_.push_front(s);
+	frame.lru = lru_.begin();
+
+	size_ += size;
+
+	frames_[s] = std::move(frame);
+}
+
+
+void WidgetAtlas::drop(const void *owner) {
+	std::string prefix = id(owner, "");
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto it = frames_.lower_bound(prefix);
+
+	while ((it != frames_.end()) && (it->first.compare(0, prefix.size(), prefix) == 0)) {
+		size_ -= it->second.pixels.size();
+
+		lru_.erase(it->second.lru);
+		it = frames_.erase(it);
+	}
+}
+
+
+uint64_t WidgetAtlas::hits(void) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	return nb_hits_;
+}
+
+
+uint64_t WidgetAtlas::misses(void) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	return nb_misses_;
+}
+
+
+void WidgetAtlas::clear(void) {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	frames_.clear();
+	lru_.clear();
+
+	size_ = 0;
+}
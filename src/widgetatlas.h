@@ -0,0 +1,67 @@
+#ifndef __GPX2VIDEO__WIDGETATLAS_H__
+#define __GPX2VIDEO__WIDGETATLAS_H__
+
+#include <map>
+#include <list>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "oiio.h"
+
+
+/**
+ * Process wide widget frame atlas
+ *
+ * Widget bitmaps are kept per shape & displayed value (ie: "32.4" km/h),
+ * a value displayed again is copied from the atlas, without any cairo or
+ * pango call. Least recently used frames are dropped over the budget.
+ */
+class WidgetAtlas {
+public:
+	// Budget in bytes, 0 => disabled
+	static void setSize(size_t size);
+
+	static bool isEnabled(void);
+
+	// Copy frame in buf (same size), false if not rendered yet
+	static bool load(const void *owner, const std::string &key, OIIO::ImageBuf *buf);
+
+	static void save(const void *owner, const std::string &key, const OIIO::ImageBuf *buf);
+
+	// Drop frames of a shape (size or theme changed)
+	static void drop(const void *owner);
+
+	static uint64_t hits(void);
+	static uint64_t misses(void);
+
+	static void clear(void);
+
+private:
+	class Frame {
+	public:
+		int width;
+		int height;
+		int nchannels;
+
+		std::vector<uint8_t> pixels;
+
+		std::list<std::string>::iterator lru;
+	};
+
+	static std::string id(const void *owner, const std::string &key);
+
+	static std::mutex mutex_;
+
+	static size_t capacity_;
+
+	static std::map<std::string, Frame> frames_;
+	static std::list<std::string> lru_;
+	static size_t size_;
+
+	static uint64_t nb_hits_;
+	static uint64_t nb_misses_;
+};
+
+#endif
@@ -41,10 +41,6 @@ public:
 		// Format data
 		no_value_ = !data.hasValue(TelemetryData::DataAverageRideSpeed);
 
-		// Refresh dynamic info
-		if (fg_buf_ != NULL)
-			delete fg_buf_;
-
 		// Image buffer
 		this->createBox(&fg_buf_, theme().width(), theme().height());
 
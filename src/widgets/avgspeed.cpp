@@ -144,29 +144,35 @@ void AvgSpeedTextShape::draw(cairo_t *cr, const TelemetryData &data) {
 	else
 		sprintf(s, "%.1f", speed);
 
-	// Draw background
-	background(cr, theme().roundCorner());
-
-	// Draw icon
-	if (theme().hasFlag(VideoWidget::Theme::FlagIcon)) {
-		icon(cr, icon_filename_, theme().iconColor());
-	}
-
-	// Draw label
-	if (theme().hasFlag(VideoWidget::Theme::FlagLabel)) {
-		font = (TextShape::Font) {
-			.size = theme().labelFontSize(),
-			.border = theme().labelBorderWidth(),
-			.shadow_opacity = theme().labelShadowOpacity(),
-			.shadow_distance = theme().labelShadowDistance(),
-			.family = theme().labelFontFamily(),
-			.align = theme().labelHorizontalAlign(),
-			.style = theme().labelFontStyle(),
-			.weight = theme().labelFontWeight(),
-			.linespace = 0.0,
-		};
-
-		label(cr, font, theme().labelColor(), theme().labelBorderColor(), widget_->label().c_str());
+	// Restore surface
+	if (!restoreCairoSurface(cr)) {
+		// Draw background
+		background(cr, theme().roundCorner());
+
+		// Draw icon
+		if (theme().hasFlag(VideoWidget::Theme::FlagIcon)) {
+			icon(cr, icon_filename_, theme().iconColor());
+		}
+
+		// Draw label
+		if (theme().hasFlag(VideoWidget::Theme::FlagLabel)) {
+			font = (TextShape::Font) {
+				.size = theme().labelFontSize(),
+				.border = theme().labelBorderWidth(),
+				.shadow_opacity = theme().labelShadowOpacity(),
+				.shadow_distance = theme().labelShadowDistance(),
+				.family = theme().labelFontFamily(),
+				.align = theme().labelHorizontalAlign(),
+				.style = theme().labelFontStyle(),
+				.weight = theme().labelFontWeight(),
+				.linespace = 0.0,
+			};
+
+			label(cr, font, theme().labelColor(), theme().labelBorderColor(), widget_->label().c_str());
+		}
+
+		// Save surface
+		saveCairoSurface(cr);
 	}
 
 	// Draw value
@@ -23,6 +23,8 @@ public:
 	}
 
 	OIIO::ImageBuf * render(const TelemetryData &data, bool &is_update) {
+		char s[128];
+
 		cairo_t *cairo;
 
 		// Refresh dynamic info
@@ -41,13 +43,21 @@ public:
 		// Format data
 		no_value_ = !data.hasValue(TelemetryData::DataCadence);
 
-		// Refresh dynamic info
-		if (fg_buf_ != NULL)
-			delete fg_buf_;
+		format(data, s, sizeof(s));
+
+		// Same value displayed
+		if ((fg_buf_ != NULL) && this->isLastFrame(s)) {
+			is_update = false;
+			goto skip;
+		}
 
 		// Image buffer
 		this->createBox(&fg_buf_, theme().width(), theme().height());
 
+		// Value rendered yet
+		if (this->loadFrame(fg_buf_, s))
+			goto done;
+
 		// Cairo context
 		cairo = this->createCairoContext(fg_buf_);
 
@@ -60,6 +70,10 @@ public:
 		// Release
 		this->destroyCairoContext(cairo);
 
+		// Keep frame
+		this->saveFrame(fg_buf_, s);
+
+done:
 		is_update = true;
 skip:
 		return fg_buf_;
@@ -88,6 +102,7 @@ private:
 	}
 
 	void initialize(cairo_t *cr);
+	bool format(const TelemetryData &data, char *s, size_t n);
 };
 
 
@@ -45,10 +45,7 @@ public:
 			}
 		}
 
-		// Refresh dynamic info
-		if (fg_buf_ != NULL)
-			delete fg_buf_;
-
+		// Image buffer
 		this->createBox(&fg_buf_, theme().width(), theme().height());
 
 		// Cairo context
@@ -133,29 +133,35 @@ void DistanceTextShape::draw(cairo_t *cr, const TelemetryData &data) {
 	else
 		sprintf(s, "--");
 
-	// Draw background
-	background(cr, theme().roundCorner());
+	// Restore surface
+	if (!restoreCairoSurface(cr)) {
+		// Draw background
+		background(cr, theme().roundCorner());
+
+		// Draw icon
+		if (theme().hasFlag(VideoWidget::Theme::FlagIcon)) {
+			icon(cr, icon_filename_, theme().iconColor());
+		}
 
-	// Draw icon
-	if (theme().hasFlag(VideoWidget::Theme::FlagIcon)) {
-		icon(cr, icon_filename_, theme().iconColor());
-	}
+		// Draw label
+		if (theme().hasFlag(VideoWidget::Theme::FlagLabel)) {
+			font = (TextShape::Font) {
+				.size = theme().labelFontSize(),
+				.border = theme().labelBorderWidth(),
+				.shadow_opacity = theme().labelShadowOpacity(),
+				.shadow_distance = theme().labelShadowDistance(),
+				.family = theme().labelFontFamily(),
+				.align = theme().labelHorizontalAlign(),
+				.style = theme().labelFontStyle(),
+				.weight = theme().labelFontWeight(),
+				.linespace = 0.0,
+			};
 
-	// Draw label
-	if (theme().hasFlag(VideoWidget::Theme::FlagLabel)) {
-		font = (TextShape::Font) {
-			.size = theme().labelFontSize(),
-			.border = theme().labelBorderWidth(),
-			.shadow_opacity = theme().labelShadowOpacity(),
-			.shadow_distance = theme().labelShadowDistance(),
-			.family = theme().labelFontFamily(),
-			.align = theme().labelHorizontalAlign(),
-			.style = theme().labelFontStyle(),
-			.weight = theme().labelFontWeight(),
-			.linespace = 0.0,
-		};
+			label(cr, font, theme().labelColor(), theme().labelBorderColor(), widget_->label().c_str());
+		}
 
-		label(cr, font, theme().labelColor(), theme().labelBorderColor(), widget_->label().c_str());
+		// Save surface
+		saveCairoSurface(cr);
 	}
 
 	// Draw value
@@ -428,13 +434,19 @@ void DistanceBarShape::draw(cairo_t *cr, const TelemetryData &data) {
 	// Compute gauge position
 	setOffset(theme().gaugeOffset());
 
-	// Draw background
-	background(cr, theme().roundCorner());
+	// Restore surface
+	if (!restoreCairoSurface(cr)) {
+		// Draw background
+		background(cr, theme().roundCorner());
 
-	// Draw gauge background
-	if (theme().hasFlag(VideoWidget::Theme::FlagGauge)) {
-		bar(cr, 0, 1, theme().gaugeWidth(), theme().gaugeBorder(),
-				theme().gaugeBackgroundColor(), theme().gaugeBorderColor());
+		// Draw gauge background
+		if (theme().hasFlag(VideoWidget::Theme::FlagGauge)) {
+			bar(cr, 0, 1, theme().gaugeWidth(), theme().gaugeBorder(),
+					theme().gaugeBackgroundColor(), theme().gaugeBorderColor());
+		}
+
+		// Save surface
+		saveCairoSurface(cr);
 	}
 
 	// Draw gauge
@@ -449,72 +461,81 @@ void DistanceBarShape::draw(cairo_t *cr, const TelemetryData &data) {
 				theme().gaugePrimaryColor());
 	}
 
-	// Draw tick lines on bar
-	if (theme().hasFlag(VideoWidget::Theme::FlagTick)) {
-		for (int value = dmin; value < dmax + tick_step_; value = value + tick_step_) {
-			double ticklen;
-			double tickwidth;
-			double tickoffset;
+	// Restore static foreground
+	if ((theme().hasFlag(VideoWidget::Theme::FlagTick) || theme().hasFlag(VideoWidget::Theme::FlagTickLabel))
+		&& !restoreCairoSurface(cr, LayerForeground)) {
+		cairo_t *layer = createLayerContext(cr);
+
+		// Draw tick lines on bar
+		if (theme().hasFlag(VideoWidget::Theme::FlagTick)) {
+			for (int value = dmin; value < dmax + tick_step_; value = value + tick_step_) {
+				double ticklen;
+				double tickwidth;
+				double tickoffset;
 
-			double xb = scale(dmin, dmax, value, rotate);
+				double xb = scale(dmin, dmax, value, rotate);
 
-			ticklenwidth(value / tick_mstep_, &tickoffset, &ticklen, &tickwidth);
+				ticklenwidth(value / tick_mstep_, &tickoffset, &ticklen, &tickwidth);
 
-			line(cr, xb, tickoffset, tickoffset + ticklen, tickwidth, theme().tickColor());
+				line(layer, xb, tickoffset, tickoffset + ticklen, tickwidth, theme().tickColor());
+			}
 		}
-	}
 
-	// Draw tick label
-	if (theme().hasFlag(VideoWidget::Theme::FlagTickLabel)) {
-		int min = dmin;
-		int max = dmax;
+		// Draw tick label
+		if (theme().hasFlag(VideoWidget::Theme::FlagTickLabel)) {
+			int min = dmin;
+			int max = dmax;
 
-		bool first = true;
+			bool first = true;
 
-		int step = tick_mstep_ * tick_step_;
+			int step = tick_mstep_ * tick_step_;
 
-		min /= step;
-		min *= step;
+			min /= step;
+			min *= step;
 
-		max /= step;
-		max *= step;
+			max /= step;
+			max *= step;
 
-		double distance = theme().tickLabelDistance();
+			double distance = theme().tickLabelDistance();
 
-		int tick_width = theme().hasFlag(VideoWidget::Theme::FlagTick) ? theme().tickSize() : 0;
-		int gauge_width = theme().hasFlag(VideoWidget::Theme::FlagGauge) ? theme().gaugeWidth() : 0;
+			int tick_width = theme().hasFlag(VideoWidget::Theme::FlagTick) ? theme().tickSize() : 0;
+			int gauge_width = theme().hasFlag(VideoWidget::Theme::FlagGauge) ? theme().gaugeWidth() : 0;
 
-		distance += std::max(tick_width / 2, gauge_width / 2);
+			distance += std::max(tick_width / 2, gauge_width / 2);
 
-		for (int value = min; value < max + step; value = value + step) {
-			double xb = scale(dmin, dmax, value, rotate);
+			for (int value = min; value < max + step; value = value + step) {
+				double xb = scale(dmin, dmax, value, rotate);
 
-			double factor = (double) theme().tickLabelFontSize() / (double) theme().valueFontSize();
+				double factor = (double) theme().tickLabelFontSize() / (double) theme().valueFontSize();
 
-			if (theme().hasFlag(VideoWidget::Theme::FlagUnit) && (first || (value >= max)))
-				sprintf(s, "%d %s", value, unit.c_str());
-			else
-				sprintf(s, "%d", value);
+				if (theme().hasFlag(VideoWidget::Theme::FlagUnit) && (first || (value >= max)))
+					sprintf(s, "%d %s", value, unit.c_str());
+				else
+					sprintf(s, "%d", value);
 
-			if (value < dmin)
-				continue;
+				if (value < dmin)
+					continue;
 
-			font = (TextShape::Font) {
-				.size = theme().valueFontSize() * factor,
-				.border = theme().valueBorderWidth(),
-				.shadow_opacity = theme().valueShadowOpacity(),
-				.shadow_distance = theme().valueShadowDistance(),
-				.family = theme().valueFontFamily(),
-				.align = VideoWidget::Theme::AlignCenter,
-				.style = theme().valueFontStyle(),
-				.weight = theme().valueFontWeight(),
-				.linespace = 0.0,
-			};
+				font = (TextShape::Font) {
+					.size = theme().valueFontSize() * factor,
+					.border = theme().valueBorderWidth(),
+					.shadow_opacity = theme().valueShadowOpacity(),
+					.shadow_distance = theme().valueShadowDistance(),
+					.family = theme().valueFontFamily(),
+					.align = VideoWidget::Theme::AlignCenter,
+					.style = theme().valueFontStyle(),
+					.weight = theme().valueFontWeight(),
+					.linespace = 0.0,
+				};
 
-			ticklabel(cr, xb, distance, font, theme().tickLabelColor(), theme().tickLabelBorderColor(), s);
+				ticklabel(layer, xb, distance, font, theme().tickLabelColor(), theme().tickLabelBorderColor(), s);
 
-			first = false;
+				first = false;
+			}
 		}
+
+		// Save & paint foreground
+		saveLayerContext(cr, layer);
 	}
 
 	// Draw cursor
@@ -468,72 +468,81 @@ void ElevationBarShape::draw(cairo_t *cr, const TelemetryData &data) {
 				theme().gaugePrimaryColor());
 	}
 
-	// Draw tick lines on bar
-	if (theme().hasFlag(VideoWidget::Theme::FlagTick)) {
-		for (int value = amin; value < amax + tick_step_; value = value + tick_step_) {
-			double ticklen;
-			double tickwidth;
-			double tickoffset;
+	// Restore static foreground
+	if ((theme().hasFlag(VideoWidget::Theme::FlagTick) || theme().hasFlag(VideoWidget::Theme::FlagTickLabel))
+		&& !restoreCairoSurface(cr, LayerForeground)) {
+		cairo_t *layer = createLayerContext(cr);
 
-			double xb = scale(amin, amax, value, rotate);
+		// Draw tick lines on bar
+		if (theme().hasFlag(VideoWidget::Theme::FlagTick)) {
+			for (int value = amin; value < amax + tick_step_; value = value + tick_step_) {
+				double ticklen;
+				double tickwidth;
+				double tickoffset;
 
-			ticklenwidth(value / tick_mstep_, &tickoffset, &ticklen, &tickwidth);
+				double xb = scale(amin, amax, value, rotate);
 
-			line(cr, xb, tickoffset, tickoffset + ticklen, tickwidth, theme().tickColor());
+				ticklenwidth(value / tick_mstep_, &tickoffset, &ticklen, &tickwidth);
+
+				line(layer, xb, tickoffset, tickoffset + ticklen, tickwidth, theme().tickColor());
+			}
 		}
-	}
 
-	// Draw tick label
-	if (theme().hasFlag(VideoWidget::Theme::FlagTickLabel)) {
-		int min = amin;
-		int max = amax;
+		// Draw tick label
+		if (theme().hasFlag(VideoWidget::Theme::FlagTickLabel)) {
+			int min = amin;
+			int max = amax;
 
-		bool first = true;
+			bool first = true;
 
-		int step = tick_mstep_ * tick_step_;
+			int step = tick_mstep_ * tick_step_;
 
-		min /= step;
-		min *= step;
+			min /= step;
+			min *= step;
 
-		max /= step;
-		max *= step;
+			max /= step;
+			max *= step;
 
-		double distance = theme().tickLabelDistance();
+			double distance = theme().tickLabelDistance();
 
-		int tick_width = theme().hasFlag(VideoWidget::Theme::FlagTick) ? theme().tickSize() : 0;
-		int gauge_width = theme().hasFlag(VideoWidget::Theme::FlagGauge) ? theme().gaugeWidth() : 0;
+			int tick_width = theme().hasFlag(VideoWidget::Theme::FlagTick) ? theme().tickSize() : 0;
+			int gauge_width = theme().hasFlag(VideoWidget::Theme::FlagGauge) ? theme().gaugeWidth() : 0;
 
-		distance += std::max(tick_width / 2, gauge_width / 2);
+			distance += std::max(tick_width / 2, gauge_width / 2);
 
-		for (int value = min; value < max + step; value = value + step) {
-			double xb = scale(amin, amax, value, rotate);
+			for (int value = min; value < max + step; value = value + step) {
+				double xb = scale(amin, amax, value, rotate);
 
-			double factor = (double) theme().tickLabelFontSize() / (double) theme().valueFontSize();
+				double factor = (double) theme().tickLabelFontSize() / (double) theme().valueFontSize();
 
-			if (theme().hasFlag(VideoWidget::Theme::FlagUnit) && (first || (value >= max)))
-				sprintf(s, "%d %s", value, unit.c_str());
-			else
-				sprintf(s, "%d", value);
+				if (theme().hasFlag(VideoWidget::Theme::FlagUnit) && (first || (value >= max)))
+					sprintf(s, "%d %s", value, unit.c_str());
+				else
+					sprintf(s, "%d", value);
 
-			if (value < amin)
-				continue;
+				if (value < amin)
+					continue;
 
-			font = (BarShape::Font) {
-				.size = theme().valueFontSize() * factor,
-				.border = theme().valueBorderWidth(),
-				.shadow_opacity = theme().valueShadowOpacity(),
-				.shadow_distance = theme().valueShadowDistance(),
-				.family = theme().valueFontFamily(),
-				.align = VideoWidget::Theme::AlignCenter,
-				.style = theme().valueFontStyle(),
-				.weight = theme().valueFontWeight(),
-				.linespace = 0.0,
-			};
+				font = (BarShape::Font) {
+					.size = theme().valueFontSize() * factor,
+					.border = theme().valueBorderWidth(),
+					.shadow_opacity = theme().valueShadowOpacity(),
+					.shadow_distance = theme().valueShadowDistance(),
+					.family = theme().valueFontFamily(),
+					.align = VideoWidget::Theme::AlignCenter,
+					.style = theme().valueFontStyle(),
+					.weight = theme().valueFontWeight(),
+					.linespace = 0.0,
+				};
 
-			ticklabel(cr, xb, distance, font, theme().tickLabelColor(), theme().tickLabelBorderColor(), s);
+				ticklabel(layer, xb, distance, font, theme().tickLabelColor(), theme().tickLabelBorderColor(), s);
 
-			first = false;
+				first = false;
+			}
 		}
+
+		// Save & paint foreground
+		saveLayerContext(cr, layer);
 	}
 
 	// Draw cursor
@@ -43,10 +43,6 @@ public:
 		// Format data
 		no_value_ = !data.hasValue(TelemetryData::DataElevation);
 
-		// Refresh dynamic info
-		if (fg_buf_ != NULL)
-			delete fg_buf_;
-
 		// Image buffer
 		this->createBox(&fg_buf_, theme().width(), theme().height());
 
@@ -131,10 +127,6 @@ public:
 		// Format data
 		no_value_ = !data.hasValue(TelemetryData::DataElevation);
 
-		// Refresh dynamic info
-		if (fg_buf_ != NULL)
-			delete fg_buf_;
-
 		// Image buffer
 		this->createBox(&fg_buf_, theme().width(), theme().height());
 
@@ -227,10 +219,6 @@ public:
 		// Format data
 		no_value_ = !data.hasValue(TelemetryData::DataElevation);
 
-		// Refresh dynamic info
-		if (fg_buf_ != NULL)
-			delete fg_buf_;
-
 		// Image buffer
 		this->createBox(&fg_buf_, theme().width(), theme().height());
 
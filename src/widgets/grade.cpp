@@ -105,6 +105,18 @@ void GradeTextShape::initialize(cairo_t *cr) {
 }
 
 
+bool GradeTextShape::format(const TelemetryData &data, char *s, size_t n) {
+	if (!data.hasValue(TelemetryData::DataGrade)) {
+		snprintf(s, n, "--");
+		return false;
+	}
+
+	snprintf(s, n, "%d", (int) std::round(data.grade()));
+
+	return true;
+}
+
+
 void GradeTextShape::draw(cairo_t *cr, const TelemetryData &data) {
 	char s[128];
 
@@ -114,12 +126,7 @@ void GradeTextShape::draw(cairo_t *cr, const TelemetryData &data) {
 	initialize(cr);
 
 	// Format data
-	no_value_ = !data.hasValue(TelemetryData::DataGrade);
-
-	if (!no_value_)
-		sprintf(s, "%d", (int) std::round(data.grade()));
-	else
-		sprintf(s, "--");
+	no_value_ = !format(data, s, sizeof(s));
 
 	// Restore surface
 	if (!restoreCairoSurface(cr)) {
@@ -105,47 +105,60 @@ void HeartRateTextShape::initialize(cairo_t *cr) {
 }
 
 
+bool HeartRateTextShape::format(const TelemetryData &data, char *s, size_t n) {
+	int heartrate = data.heartrate(widget_->valueUnit());
+
+	if (!data.hasValue(TelemetryData::DataHeartrate)) {
+		snprintf(s, n, "--");
+		return false;
+	}
+
+	snprintf(s, n, "%d", heartrate);
+
+	return true;
+}
+
+
 void HeartRateTextShape::draw(cairo_t *cr, const TelemetryData &data) {
 	char s[128];
 
 	TextShape::Font font;
 
-	int heartrate = data.heartrate(widget_->valueUnit());
-
 	// Initialize
 	initialize(cr);
 
 	// Format data
-	no_value_ = !data.hasValue(TelemetryData::DataHeartrate);
-
-	if (!no_value_)
-		sprintf(s, "%d", heartrate);
-	else
-		sprintf(s, "--");
-
-	// Draw background
-	background(cr, theme().roundCorner());
-
-	// Draw icon
-	if (theme().hasFlag(VideoWidget::Theme::FlagIcon)) {
-		icon(cr, icon_filename_, theme().iconColor());
-	}
-
-	// Draw label
-	if (theme().hasFlag(VideoWidget::Theme::FlagLabel)) {
-		font = (TextShape::Font) {
-			.size = theme().labelFontSize(),
-			.border = theme().labelBorderWidth(),
-			.shadow_opacity = theme().labelShadowOpacity(),
-			.shadow_distance = theme().labelShadowDistance(),
-			.family = theme().labelFontFamily(),
-			.align = theme().labelHorizontalAlign(),
-			.style = theme().labelFontStyle(),
-			.weight = theme().labelFontWeight(),
-			.linespace = 0.0,
-		};
-
-		label(cr, font, theme().labelColor(), theme().labelBorderColor(), widget_->label().c_str());
+	no_value_ = !format(data, s, sizeof(s));
+
+	// Restore surface
+	if (!restoreCairoSurface(cr)) {
+		// Draw background
+		background(cr, theme().roundCorner());
+
+		// Draw icon
+		if (theme().hasFlag(VideoWidget::Theme::FlagIcon)) {
+			icon(cr, icon_filename_, theme().iconColor());
+		}
+
+		// Draw label
+		if (theme().hasFlag(VideoWidget::Theme::FlagLabel)) {
+			font = (TextShape::Font) {
+				.size = theme().labelFontSize(),
+				.border = theme().labelBorderWidth(),
+				.shadow_opacity = theme().labelShadowOpacity(),
+				.shadow_distance = theme().labelShadowDistance(),
+				.family = theme().labelFontFamily(),
+				.align = theme().labelHorizontalAlign(),
+				.style = theme().labelFontStyle(),
+				.weight = theme().labelFontWeight(),
+				.linespace = 0.0,
+			};
+
+			label(cr, font, theme().labelColor(), theme().labelBorderColor(), widget_->label().c_str());
+		}
+
+		// Save surface
+		saveCairoSurface(cr);
 	}
 
 	// Draw value
@@ -47,7 +47,7 @@ public:
 	OIIO::ImageBuf * render(const TelemetryData &data, bool &is_update) {
 		cairo_t *cairo;
 
-		OIIO::ImageBuf *img;
+		OIIO::ImageBuf *img = NULL;
 
 		(void) data;
 
@@ -57,10 +57,6 @@ public:
 			goto skip;
 		}
 
-		// Refresh dynamic info
-		if (fg_buf_ != NULL)
-			delete fg_buf_;
-
 		// Image buffer
 		this->createBox(&fg_buf_, theme().width(), theme().height());
 
@@ -74,7 +70,7 @@ public:
 		this->renderCairoContext(fg_buf_, cairo);
 
 		// Draw image
-		this->createBox(&img, theme().width(), theme().height());
+		img = new OIIO::ImageBuf(this->boxSpec(theme().width(), theme().height()));
 		this->drawImage(img, theme().border(), theme().border(), this->source().c_str(), this->zoom());
 
 		// Apply mask
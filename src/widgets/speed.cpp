@@ -105,19 +105,11 @@ void SpeedTextShape::initialize(cairo_t *cr) {
 }
 
 
-void SpeedTextShape::draw(cairo_t *cr, const TelemetryData &data) {
-	char s[128];
-
-	TextShape::Font font;
-
+bool SpeedTextShape::format(const TelemetryData &data, char *s, size_t n) {
 	bool pace_unit = false;
-	double speed = data.speed(widget_->valueUnit());
-
-	// Initialize
-	initialize(cr);
+	bool no_value = !data.hasValue(TelemetryData::DataSpeed);
 
-	// Format data
-	no_value_ = !data.hasValue(TelemetryData::DataSpeed);
+	double speed = data.speed(widget_->valueUnit());
 
 	switch (widget_->valueUnit()) {
 	case TelemetryData::UnitMinPerMile:
@@ -131,19 +123,34 @@ void SpeedTextShape::draw(cairo_t *cr, const TelemetryData &data) {
 
 	if (pace_unit) {
 		if (speed <= 0.0)
-			no_value_ = true;
+			no_value = true;
 	}
 
-	if (no_value_)
-		sprintf(s, "--");
+	if (no_value)
+		snprintf(s, n, "--");
 	else if (pace_unit) {
 		int min = (int) speed;
 		int sec = (int) round((speed - min) * 60) % 60;
 
-		sprintf(s, "%d:%02d", min, sec);
+		snprintf(s, n, "%d:%02d", min, sec);
 	} 
 	else
-		sprintf(s, "%.1f", speed);
+		snprintf(s, n, "%.1f", speed);
+
+	return !no_value;
+}
+
+
+void SpeedTextShape::draw(cairo_t *cr, const TelemetryData &data) {
+	char s[128];
+
+	TextShape::Font font;
+
+	// Initialize
+	initialize(cr);
+
+	// Format data
+	no_value_ = !format(data, s, sizeof(s));
 
 	// Restore surface
 	if (!restoreCairoSurface(cr)) {
@@ -410,11 +417,29 @@ void SpeedArcShape::draw(cairo_t *cr, const TelemetryData &data) {
 			no_value_ = true;
 	}
 
-	// Draw arc background
-	pieslice(cr, 0, 360, theme().border(),
-			theme().backgroundColor(), theme().borderColor());
+	// Restore surface
+	if (!restoreCairoSurface(cr)) {
+		// Draw arc background
+		pieslice(cr, 0, 360, theme().border(),
+				theme().backgroundColor(), theme().borderColor());
+
+		// Draw gauge background
+		if (theme().hasFlag(VideoWidget::Theme::FlagGauge)) {
+			double width = theme().gaugeWidth();
+			double border = theme().gaugeBorder();
+
+			xa1 = scale(vmin, vmax, 0, rotate);
+			xa2 = scale(vmin, vmax, vmax, rotate);
+
+			arc(cr, xa1, xa2, border / 2.0, width, border,
+					theme().gaugeBackgroundColor(), theme().gaugeBorderColor());
+		}
 
-	// Draw gauge background
+		// Save surface
+		saveCairoSurface(cr);
+	}
+
+	// Draw color gauges
 	if (theme().hasFlag(VideoWidget::Theme::FlagGauge)) {
 		double width = theme().gaugeWidth();
 		double border = theme().gaugeBorder();
@@ -423,18 +448,11 @@ void SpeedArcShape::draw(cairo_t *cr, const TelemetryData &data) {
 
 		VideoWidget::Theme::GaugeCap cap = theme().gaugeCap();
 
-		xa1 = scale(vmin, vmax, 0, rotate);
-		xa2 = scale(vmin, vmax, vmax, rotate);
-
 		switch (cap) {
 		case VideoWidget::Theme::GaugeCapRound:
 			width1 = (theme().gaugePrimaryColor()[3] > 0) ? width - border : 0;
 			width2 = (theme().gaugeSecondaryColor()[3] > 0) ? width - border : 0;
 
-			// Draw background
-			arc(cr, xa1, xa2, border / 2.0, width, border,
-					theme().gaugeBackgroundColor(), theme().gaugeBorderColor());
-
 			// Draw color gauge (max speed) - width / 2.6
 			if ((width2 > 0) && data.hasValue(TelemetryData::DataMaxSpeed)) {
 				xa1 = scale(vmin, vmax, 0, rotate);
@@ -486,10 +504,6 @@ void SpeedArcShape::draw(cairo_t *cr, const TelemetryData &data) {
 				width2 = 0;
 			}
 
-			// Draw background
-			arc(cr, xa1, xa2, (border / 2.0), width, border,
-					theme().gaugeBackgroundColor(), theme().gaugeBorderColor());
-
 			if (theme().hasFlag(VideoWidget::Theme::FlagNeedle)) {
 				// Draw color gauge (avg speed) - width / 1.625
 				if ((width1 > 0) && data.hasValue(TelemetryData::DataAverageRideSpeed)) {
@@ -524,53 +538,62 @@ void SpeedArcShape::draw(cairo_t *cr, const TelemetryData &data) {
 		}
 	}
 
-	// Draw tick lines around arc line
-	if (theme().hasFlag(VideoWidget::Theme::FlagTick)) {
-		for (int value = vmin; value < vmax + tick_step_; value = value + tick_step_) {
-			double ticklen;
-			double tickwidth;
+	// Restore static foreground
+	if ((theme().hasFlag(VideoWidget::Theme::FlagTick) || theme().hasFlag(VideoWidget::Theme::FlagTickLabel))
+		&& !restoreCairoSurface(cr, LayerForeground)) {
+		cairo_t *layer = createLayerContext(cr);
 
-			double xa = scale(vmin, vmax, value, rotate);
+		// Draw tick lines around arc line
+		if (theme().hasFlag(VideoWidget::Theme::FlagTick)) {
+			for (int value = vmin; value < vmax + tick_step_; value = value + tick_step_) {
+				double ticklen;
+				double tickwidth;
 
-			if (xa > (end() + rotate))
-				break;
+				double xa = scale(vmin, vmax, value, rotate);
 
-			ticklenwidth(value, &ticklen, &tickwidth);
+				if (xa > (end() + rotate))
+					break;
 
-			line(cr, xa, 0, ticklen, tickwidth, theme().tickColor());
+				ticklenwidth(value, &ticklen, &tickwidth);
+
+				line(layer, xa, 0, ticklen, tickwidth, theme().tickColor());
+			}
 		}
-	}
 
-	// Draw tick label
-	if (theme().hasFlag(VideoWidget::Theme::FlagTickLabel)) {
-		double distance = std::max(theme().gaugeWidth() / 2.0, theme().tickSize() / 2.0);
-		
-		distance += theme().tickLabelDistance();
+		// Draw tick label
+		if (theme().hasFlag(VideoWidget::Theme::FlagTickLabel)) {
+			double distance = std::max(theme().gaugeWidth() / 2.0, theme().tickSize() / 2.0);
 
-		for (int value = vmin; value < vmax + (tick_mstep_ * tick_step_); value = value + (tick_mstep_ * tick_step_)) {
-			double xa = scale(vmin, vmax, value, rotate);
+			distance += theme().tickLabelDistance();
 
-			double factor = (double) theme().tickLabelFontSize() / (double) theme().valueFontSize();
+			for (int value = vmin; value < vmax + (tick_mstep_ * tick_step_); value = value + (tick_mstep_ * tick_step_)) {
+				double xa = scale(vmin, vmax, value, rotate);
 
-			if (xa > (end() + rotate))
-				break;
+				double factor = (double) theme().tickLabelFontSize() / (double) theme().valueFontSize();
 
-			std::string str = std::to_string(value);
+				if (xa > (end() + rotate))
+					break;
 
-			font = (ArcShape::Font) {
-				.size = theme().valueFontSize() * factor,
-				.border = theme().valueBorderWidth(),
-				.shadow_opacity = theme().valueShadowOpacity(),
-				.shadow_distance = theme().valueShadowDistance(),
-				.family = theme().valueFontFamily(),
-				.align = VideoWidget::Theme::AlignCenter,
-				.style = theme().valueFontStyle(),
-				.weight = theme().valueFontWeight(),
-				.linespace = 0.0,
-			};
+				std::string str = std::to_string(value);
 
-			ticklabel(cr, xa, distance, font, theme().tickLabelColor(), theme().tickLabelBorderColor(), str.c_str());
+				font = (ArcShape::Font) {
+					.size = theme().valueFontSize() * factor,
+					.border = theme().valueBorderWidth(),
+					.shadow_opacity = theme().valueShadowOpacity(),
+					.shadow_distance = theme().valueShadowDistance(),
+					.family = theme().valueFontFamily(),
+					.align = VideoWidget::Theme::AlignCenter,
+					.style = theme().valueFontStyle(),
+					.weight = theme().valueFontWeight(),
+					.linespace = 0.0,
+				};
+
+				ticklabel(layer, xa, distance, font, theme().tickLabelColor(), theme().tickLabelBorderColor(), str.c_str());
+			}
 		}
+
+		// Save & paint foreground
+		saveLayerContext(cr, layer);
 	}
 
 	// Write speed value
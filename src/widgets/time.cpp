@@ -118,29 +118,35 @@ void TimeTextShape::draw(cairo_t *cr, const TelemetryData &data) {
 				s[i] = '-';
 	}
 
-	// Draw background
-	background(cr, theme().roundCorner());
+	// Restore surface
+	if (!restoreCairoSurface(cr)) {
+		// Draw background
+		background(cr, theme().roundCorner());
+
+		// Draw icon
+		if (theme().hasFlag(VideoWidget::Theme::FlagIcon)) {
+			icon(cr, icon_filename_, theme().iconColor());
+		}
 
-	// Draw icon
-	if (theme().hasFlag(VideoWidget::Theme::FlagIcon)) {
-		icon(cr, icon_filename_, theme().iconColor());
-	}
+		// Draw label
+		if (theme().hasFlag(VideoWidget::Theme::FlagLabel)) {
+			font = (TextShape::Font) {
+				.size = theme().labelFontSize(),
+				.border = theme().labelBorderWidth(),
+				.shadow_opacity = theme().labelShadowOpacity(),
+				.shadow_distance = theme().labelShadowDistance(),
+				.family = theme().labelFontFamily(),
+				.align = theme().labelHorizontalAlign(),
+				.style = theme().labelFontStyle(),
+				.weight = theme().labelFontWeight(),
+				.linespace = 0.0,
+			};
 
-	// Draw label
-	if (theme().hasFlag(VideoWidget::Theme::FlagLabel)) {
-		font = (TextShape::Font) {
-			.size = theme().labelFontSize(),
-			.border = theme().labelBorderWidth(),
-			.shadow_opacity = theme().labelShadowOpacity(),
-			.shadow_distance = theme().labelShadowDistance(),
-			.family = theme().labelFontFamily(),
-			.align = theme().labelHorizontalAlign(),
-			.style = theme().labelFontStyle(),
-			.weight = theme().labelFontWeight(),
-			.linespace = 0.0,
-		};
+			label(cr, font, theme().labelColor(), theme().labelBorderColor(), widget_->label().c_str());
+		}
 
-		label(cr, font, theme().labelColor(), theme().labelBorderColor(), widget_->label().c_str());
+		// Save surface
+		saveCairoSurface(cr);
 	}
 
 	// Draw value
@@ -322,62 +328,68 @@ void TimeArcShape::draw(cairo_t *cr, const TelemetryData &data) {
 	// Tick init
 	tickinit(tmin, tmax);
 
-	// Draw background
-	pieslice(cr, 0, 360, theme().border(),
-			theme().backgroundColor(), theme().borderColor());
+	// Restore surface
+	if (!restoreCairoSurface(cr)) {
+		// Draw background
+		pieslice(cr, 0, 360, theme().border(),
+				theme().backgroundColor(), theme().borderColor());
 
-	// Draw tick lines around arc line
-	if (theme().hasFlag(VideoWidget::Theme::FlagTick)) {
-		for (int value = tmin; value < tmax + tick_step_; value = value + tick_step_) {
-			double ticklen;
-			double tickwidth;
+		// Draw tick lines around arc line
+		if (theme().hasFlag(VideoWidget::Theme::FlagTick)) {
+			for (int value = tmin; value < tmax + tick_step_; value = value + tick_step_) {
+				double ticklen;
+				double tickwidth;
 
-			xa = scale(tmin, tmax, value, rotate);
+				xa = scale(tmin, tmax, value, rotate);
 
-			if (xa > (end() + rotate))
-				break;
+				if (xa > (end() + rotate))
+					break;
 
-			ticklenwidth(value, &ticklen, &tickwidth);
+				ticklenwidth(value, &ticklen, &tickwidth);
 
-			line(cr, xa, 0, ticklen, tickwidth, theme().tickColor());
+				line(cr, xa, 0, ticklen, tickwidth, theme().tickColor());
+			}
 		}
-	}
 
-	// Draw tick label
-	// 1 2 3 4 5 6...
-	// 1 3 6...
-	// 1 6...
-	if (theme().hasFlag(VideoWidget::Theme::FlagTickLabel)) {
-		int mstep = (tick_mstep_ > 0) ? 3 * tick_mstep_ : 1;
+		// Draw tick label
+		// 1 2 3 4 5 6...
+		// 1 3 6...
+		// 1 6...
+		if (theme().hasFlag(VideoWidget::Theme::FlagTickLabel)) {
+			int mstep = (tick_mstep_ > 0) ? 3 * tick_mstep_ : 1;
 
-		double distance = theme().tickSize() / 2.0;
-		
-		distance += theme().tickLabelDistance();
+			double distance = theme().tickSize() / 2.0;
 
-		for (int value = 0; value < 12; value = value + mstep) {
-			double factor = (double) theme().tickLabelFontSize() / (double) theme().valueFontSize();
+			distance += theme().tickLabelDistance();
 
-			xa = scale(tmin / 5, tmax / 5, value + 1, rotate);
+			for (int value = 0; value < 12; value = value + mstep) {
+				double factor = (double) theme().tickLabelFontSize() / (double) theme().valueFontSize();
 
-			if (xa > (end() + rotate))
-				break;
+				xa = scale(tmin / 5, tmax / 5, value + 1, rotate);
 
-			std::string str = std::to_string(value + 1);
+				if (xa > (end() + rotate))
+					break;
 
-			font = (TextShape::Font) {
-				.size = theme().valueFontSize() * factor,
-				.border = theme().valueBorderWidth(),
-				.shadow_opacity = theme().valueShadowOpacity(),
-				.shadow_distance = theme().valueShadowDistance(),
-				.family = theme().valueFontFamily(),
-				.align = VideoWidget::Theme::AlignCenter,
-				.style = theme().valueFontStyle(),
-				.weight = theme().valueFontWeight(),
-				.linespace = 0.0,
-			};
+				std::string str = std::to_string(value + 1);
+
+				font = (TextShape::Font) {
+					.size = theme().valueFontSize() * factor,
+					.border = theme().valueBorderWidth(),
+					.shadow_opacity = theme().valueShadowOpacity(),
+					.shadow_distance = theme().valueShadowDistance(),
+					.family = theme().valueFontFamily(),
+					.align = VideoWidget::Theme::AlignCenter,
+					.style = theme().valueFontStyle(),
+					.weight = theme().valueFontWeight(),
+					.linespace = 0.0,
+				};
 
-			ticklabel(cr, xa, distance, font, theme().tickLabelColor(), theme().tickLabelBorderColor(), str.c_str());
+				ticklabel(cr, xa, distance, font, theme().tickLabelColor(), theme().tickLabelBorderColor(), str.c_str());
+			}
 		}
+
+		// Save surface
+		saveCairoSurface(cr);
 	}
 
 	// Write time value
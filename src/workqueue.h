@@ -0,0 +1,119 @@
+#ifndef __GPX2VIDEO__WORKQUEUE_H__
+#define __GPX2VIDEO__WORKQUEUE_H__
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+
+/**
+ * Bounded blocking queue
+ *
+ * push() blocks while the queue is full (back-pressure) and pop() blocks
+ * while it's empty. Once closed, pop() drains the remaining items then
+ * fails. abort() wakes up everybody and drops pending items.
+ */
+template <typename T>
+class WorkQueue {
+public:
+	WorkQueue(size_t queue_size=8)
+		: queue_size_(queue_size)
+		, is_closed_(false)
+		, is_aborted_(false) {
+	}
+
+	~WorkQueue() {
+	}
+
+	void setQueueSize(size_t queue_size) {
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		queue_size_ = (queue_size > 0) ? queue_size : 1;
+	}
+
+	size_t size(void) const {
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		return queue_.size();
+	}
+
+	bool push(T item) {
+		std::unique_lock<std::mutex> lock(mutex_);
+
+		cond_full_.wait(lock, [this] {
+			return is_aborted_ || is_closed_ || (queue_.size() < queue_size_);
+		});
+
+		if (is_aborted_ || is_closed_)
+			return false;
+
+		queue_.push_back(std::move(item));
+
+		cond_empty_.notify_one();
+
+		return true;
+	}
+
+	bool pop(T &item) {
+		std::unique_lock<std::mutex> lock(mutex_);
+
+		cond_empty_.wait(lock, [this] {
+			return is_aborted_ || is_closed_ || !queue_.empty();
+		});
+
+		if (is_aborted_ || queue_.empty())
+			return false;
+
+		item = std::move(queue_.front());
+		queue_.pop_front();
+
+		cond_full_.notify_one();
+
+		return true;
+	}
+
+	// No more item will be pushed
+	void close(void) {
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		is_closed_ = true;
+
+		cond_full_.notify_all();
+		cond_empty_.notify_all();
+	}
+
+	// Stop & flush
+	void abort(void) {
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		is_aborted_ = true;
+
+		queue_.clear();
+
+		cond_full_.notify_all();
+		cond_empty_.notify_all();
+	}
+
+	void reset(void) {
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		queue_.clear();
+
+		is_closed_ = false;
+		is_aborted_ = false;
+	}
+
+private:
+	size_t queue_size_;
+
+	bool is_closed_;
+	bool is_aborted_;
+
+	std::deque<T> queue_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable cond_full_;
+	std::condition_variable cond_empty_;
+};
+
+#endif
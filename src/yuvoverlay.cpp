@@ -0,0 +1,327 @@
+#include <iostream>
+#include <memory>
+#include <cmath>
+
+#include "log_i.h"
+#include "blend.h"
+#include "yuvoverlay.h"
+
+
+#define ALPHA_SHIFT 15
+#define ALPHA_ONE (1 << ALPHA_SHIFT)
+
+
+YUVOverlay::YUVOverlay(AVPixelFormat pix_fmt, AVColorSpace color_space, AVColorRange color_range)
+	: pix_fmt_(pix_fmt)
+	, color_space_(color_space)
+	, color_range_(color_range)
+	, depth_(8)
+	, x_(0)
+	, y_(0)
+	, width_(0)
+	, height_(0) {
+}
+
+
+YUVOverlay::~YUVOverlay() {
+}
+
+
+bool YUVOverlay::isSupported(AVPixelFormat pix_fmt) {
+	switch (pix_fmt) {
+	case AV_PIX_FMT_YUV420P:
+	case AV_PIX_FMT_YUVJ420P:
+	case AV_PIX_FMT_NV12:
+	case AV_PIX_FMT_YUV420P10LE:
+	case AV_PIX_FMT_P010LE:
+		return true;
+
+	default:
+		break;
+	}
+
+	return false;
+}
+
+
+YUVOverlayPtr YUVOverlay::create(const OIIO::ImageBuf &buf,
+		AVPixelFormat pix_fmt, AVColorSpace color_space, AVColorRange color_range) {
+	YUVOverlayPtr overlay;
+
+	if (!isSupported(pix_fmt))
+		return NULL;
+
+	overlay = std::make_shared<YUVOverlay>(pix_fmt, color_space, color_range);
+
+	if (!overlay->init(buf))
+		return NULL;
+
+	return overlay;
+}
+
+
+bool YUVOverlay::init(const OIIO::ImageBuf &buf) {
+	int x, y;
+	int dx, dy;
+	int cwidth, cheight;
+
+	double kr, kb;
+	double scale;
+	double y_offset, y_scale;
+	double c_offset, c_scale;
+
+	std::vector<float> pixels;
+
+	const OIIO::ImageSpec &spec = buf.spec();
+
+	if (spec.nchannels != 4) {
+		log_error("YUV overlay expects a RGBA / BGRA buffer");
+		return false;
+	}
+
+	// Bits per component
+	switch (pix_fmt_) {
+	case AV_PIX_FMT_YUV420P10LE:
+	case AV_PIX_FMT_P010LE:
+		depth_ = 10;
+		break;
+
+	default:
+		depth_ = 8;
+		break;
+	}
+
+	// BT.601 / BT.709 coefficients
+	switch (color_space_) {
+	case AVCOL_SPC_BT709:
+		kr = 0.2126;
+		kb = 0.0722;
+		break;
+
+	case AVCOL_SPC_BT2020_NCL:
+	case AVCOL_SPC_BT2020_CL:
+		kr = 0.2627;
+		kb = 0.0593;
+		break;
+
+	case AVCOL_SPC_BT470BG:
+	case AVCOL_SPC_SMPTE170M:
+	default:
+		kr = 0.299;
+		kb = 0.114;
+		break;
+	}
+
+	// Limited / full range
+	scale = (double) (1 << (depth_ - 8));
+
+	if ((color_range_ == AVCOL_RANGE_JPEG) || (pix_fmt_ == AV_PIX_FMT_YUVJ420P)) {
+		y_offset = 0.0;
+		y_scale = (double) ((1 << depth_) - 1);
+		c_offset = 128.0 * scale;
+		c_scale = (double) ((1 << depth_) - 1);
+	}
+	else {
+		y_offset = 16.0 * scale;
+		y_scale = 219.0 * scale;
+		c_offset = 128.0 * scale;
+		c_scale = 224.0 * scale;
+	}
+
+	// Align area on the 2x2 chroma grid
+	x_ = spec.x & ~1;
+	y_ = spec.y & ~1;
+	dx = spec.x - x_;
+	dy = spec.y - y_;
+
+	width_ = (dx + spec.width + 1) & ~1;
+	height_ = (dy + spec.height + 1) & ~1;
+
+	cwidth = width_ / 2;
+	cheight = height_ / 2;
+
+	luma_.assign(width_ * height_, 0);
+	luma_alpha_.assign(width_ * height_, ALPHA_ONE);
+
+	cb_.assign(cwidth * cheight, 0);
+	cr_.assign(cwidth * cheight, 0);
+	chroma_alpha_.assign(cwidth * cheight, ALPHA_ONE);
+
+	// Read widget pixels (premultiplied RGBA)
+	pixels.resize(spec.width * spec.height * 4);
+
+	if (!buf.get_pixels(buf.roi(), OIIO::TypeDesc::FLOAT, pixels.data())) {
+		log_error("YUV overlay fails to read widget pixels");
+		return false;
+	}
+
+	// Accumulate premultiplied components per pixel & 2x2 block.
+	// Since Y'CbCr is a linear combination of R'G'B', premultiplied
+	// values are converted as is, only the offsets are weighted by alpha.
+	std::vector<double> cb(cwidth * cheight, 0.0);
+	std::vector<double> cr(cwidth * cheight, 0.0);
+	std::vector<double> ca(cwidth * cheight, 0.0);
+
+	// Widget bitmap may be stored as BGRA
+	const int ri = Blend::isBGRA(spec) ? 2 : 0;
+	const int bi = Blend::isBGRA(spec) ? 0 : 2;
+
+	for (y=0; y<spec.height; y++) {
+		for (x=0; x<spec.width; x++) {
+			const float *p = &pixels[(y * spec.width + x) * 4];
+
+			double r = p[ri];
+			double g = p[1];
+			double b = p[bi];
+			double a = MIN(1.0, MAX(0.0, p[3]));
+
+			double luma = kr * r + (1.0 - kr - kb) * g + kb * b;
+			double pb = (b - luma) / (2.0 * (1.0 - kb));
+			double pr = (r - luma) / (2.0 * (1.0 - kr));
+
+			int i = (y + dy) * width_ + (x + dx);
+			int j = ((y + dy) / 2) * cwidth + ((x + dx) / 2);
+
+			luma_[i] = lround(a * y_offset + luma * y_scale);
+			luma_alpha_[i] = lround((1.0 - a) * ALPHA_ONE);
+
+			cb[j] += a * c_offset + pb * c_scale;
+			cr[j] += a * c_offset + pr * c_scale;
+			ca[j] += a;
+		}
+	}
+
+	// 4:2:0 subsampling (missing samples are transparent)
+	for (int j=0; j<cwidth*cheight; j++) {
+		cb_[j] = lround(MAX(0.0, cb[j] / 4.0));
+		cr_[j] = lround(MAX(0.0, cr[j] / 4.0));
+		chroma_alpha_[j] = lround((1.0 - ca[j] / 4.0) * ALPHA_ONE);
+	}
+
+	return true;
+}
+
+
+/**
+ * Blend kernels
+ */
+
+template <typename T>
+static inline void blendPixel(T *dst, const uint16_t &value, const uint16_t &alpha, const int &shift, const uint32_t &max) {
+	uint32_t d;
+
+	// Fully transparent
+	if (alpha == ALPHA_ONE)
+		return;
+
+	d = (*dst) >> shift;
+	d = value + ((d * alpha + (ALPHA_ONE >> 1)) >> ALPHA_SHIFT);
+	d = MIN(d, max);
+
+	*dst = (T) (d << shift);
+}
+
+
+template <typename T>
+static void blendPlane(uint8_t *data, int linesize, int step, int shift, uint32_t max,
+		int x, int y, int width, int height,
+		const uint16_t *values, const uint16_t *alphas, int stride) {
+	for (int j=0; j<height; j++) {
+		T *dst = (T *) (data + (y + j) * linesize) + x * step;
+
+		const uint16_t *value = values + j * stride;
+		const uint16_t *alpha = alphas + j * stride;
+
+		for (int i=0; i<width; i++, dst+=step)
+			blendPixel<T>(dst, value[i], alpha[i], shift, max);
+	}
+}
+
+
+bool YUVOverlay::blend(AVFrame *frame) const {
+	int x1, y1, x2, y2;
+	int cx1, cy1, cwidth;
+	int ox, oy;
+
+	uint32_t max = (1 << depth_) - 1;
+
+	if (frame->format != pix_fmt_) {
+		log_error("YUV overlay pixel format mismatch");
+		return false;
+	}
+
+	// Clip overlay area to the frame
+	x1 = MAX(0, x_);
+	y1 = MAX(0, y_);
+	x2 = MIN(frame->width & ~1, x_ + width_);
+	y2 = MIN(frame->height & ~1, y_ + height_);
+
+	if ((x1 >= x2) || (y1 >= y2))
+		return true;
+
+	// Offsets in overlay
+	ox = x1 - x_;
+	oy = y1 - y_;
+
+	cx1 = x1 / 2;
+	cy1 = y1 / 2;
+	cwidth = width_ / 2;
+
+	switch (pix_fmt_) {
+	case AV_PIX_FMT_YUV420P:
+	case AV_PIX_FMT_YUVJ420P:
+		blendPlane<uint8_t>(frame->data[0], frame->linesize[0], 1, 0, max,
+			x1, y1, x2 - x1, y2 - y1,
+			&luma_[oy * width_ + ox], &luma_alpha_[oy * width_ + ox], width_);
+		blendPlane<uint8_t>(frame->data[1], frame->linesize[1], 1, 0, max,
+			cx1, cy1, (x2 - x1) / 2, (y2 - y1) / 2,
+			&cb_[(oy / 2) * cwidth + (ox / 2)], &chroma_alpha_[(oy / 2) * cwidth + (ox / 2)], cwidth);
+		blendPlane<uint8_t>(frame->data[2], frame->linesize[2], 1, 0, max,
+			cx1, cy1, (x2 - x1) / 2, (y2 - y1) / 2,
+			&cr_[(oy / 2) * cwidth + (ox / 2)], &chroma_alpha_[(oy / 2) * cwidth + (ox / 2)], cwidth);
+		break;
+
+	case AV_PIX_FMT_YUV420P10LE:
+		blendPlane<uint16_t>(frame->data[0], frame->linesize[0], 1, 0, max,
+			x1, y1, x2 - x1, y2 - y1,
+			&luma_[oy * width_ + ox], &luma_alpha_[oy * width_ + ox], width_);
+		blendPlane<uint16_t>(frame->data[1], frame->linesize[1], 1, 0, max,
+			cx1, cy1, (x2 - x1) / 2, (y2 - y1) / 2,
+			&cb_[(oy / 2) * cwidth + (ox / 2)], &chroma_alpha_[(oy / 2) * cwidth + (ox / 2)], cwidth);
+		blendPlane<uint16_t>(frame->data[2], frame->linesize[2], 1, 0, max,
+			cx1, cy1, (x2 - x1) / 2, (y2 - y1) / 2,
+			&cr_[(oy / 2) * cwidth + (ox / 2)], &chroma_alpha_[(oy / 2) * cwidth + (ox / 2)], cwidth);
+		break;
+
+	case AV_PIX_FMT_NV12:
+		// Interleaved CbCr plane
+		blendPlane<uint8_t>(frame->data[0], frame->linesize[0], 1, 0, max,
+			x1, y1, x2 - x1, y2 - y1,
+			&luma_[oy * width_ + ox], &luma_alpha_[oy * width_ + ox], width_);
+		blendPlane<uint8_t>(frame->data[1], frame->linesize[1], 2, 0, max,
+			cx1, cy1, (x2 - x1) / 2, (y2 - y1) / 2,
+			&cb_[(oy / 2) * cwidth + (ox / 2)], &chroma_alpha_[(oy / 2) * cwidth + (ox / 2)], cwidth);
+		blendPlane<uint8_t>(frame->data[1] + 1, frame->linesize[1], 2, 0, max,
+			cx1, cy1, (x2 - x1) / 2, (y2 - y1) / 2,
+			&cr_[(oy / 2) * cwidth + (ox / 2)], &chroma_alpha_[(oy / 2) * cwidth + (ox / 2)], cwidth);
+		break;
+
+	case AV_PIX_FMT_P010LE:
+		// 10 bits stored in the MSB, interleaved CbCr plane
+		blendPlane<uint16_t>(frame->data[0], frame->linesize[0], 1, 6, max,
+			x1, y1, x2 - x1, y2 - y1,
+			&luma_[oy * width_ + ox], &luma_alpha_[oy * width_ + ox], width_);
+		blendPlane<uint16_t>(frame->data[1], frame->linesize[1], 2, 6, max,
+			cx1, cy1, (x2 - x1) / 2, (y2 - y1) / 2,
+			&cb_[(oy / 2) * cwidth + (ox / 2)], &chroma_alpha_[(oy / 2) * cwidth + (ox / 2)], cwidth);
+		blendPlane<uint16_t>(frame->data[1] + 2, frame->linesize[1], 2, 6, max,
+			cx1, cy1, (x2 - x1) / 2, (y2 - y1) / 2,
+			&cr_[(oy / 2) * cwidth + (ox / 2)], &chroma_alpha_[(oy / 2) * cwidth + (ox / 2)], cwidth);
+		break;
+
+	default:
+		return false;
+	}
+
+	return true;
+}
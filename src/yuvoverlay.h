@@ -0,0 +1,60 @@
+#ifndef __GPX2VIDEO__YUVOVERLAY_H__
+#define __GPX2VIDEO__YUVOVERLAY_H__
+
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/imagebuf.h>
+
+
+class YUVOverlay;
+
+using YUVOverlayPtr = std::shared_ptr<YUVOverlay>;
+
+
+/**
+ * Widget bitmap pre-converted to the video native YUV format
+ *
+ * Widget RGBA (premultiplied) is converted once, then blended into the
+ * luma & chroma planes of each decoded frame, only on the widget area.
+ */
+class YUVOverlay {
+public:
+	YUVOverlay(AVPixelFormat pix_fmt, AVColorSpace color_space, AVColorRange color_range);
+	virtual ~YUVOverlay();
+
+	static bool isSupported(AVPixelFormat pix_fmt);
+
+	static YUVOverlayPtr create(const OIIO::ImageBuf &buf,
+			AVPixelFormat pix_fmt, AVColorSpace color_space, AVColorRange color_range);
+
+	bool blend(AVFrame *frame) const;
+
+private:
+	bool init(const OIIO::ImageBuf &buf);
+
+	AVPixelFormat pix_fmt_;
+	AVColorSpace color_space_;
+	AVColorRange color_range_;
+
+	int depth_;
+
+	// Overlay area (aligned on chroma subsampling)
+	int x_, y_;
+	int width_, height_;
+
+	// Premultiplied Y, Cb, Cr values & (1 - alpha) factor (1.15 fixed point)
+	std::vector<uint16_t> luma_;
+	std::vector<uint16_t> luma_alpha_;
+	std::vector<uint16_t> cb_;
+	std::vector<uint16_t> cr_;
+	std::vector<uint16_t> chroma_alpha_;
+};
+
+#endif
@@ -0,0 +1,242 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+
+#include "log.h"
+#include "blend.h"
+
+
+// Micro benchmark: widget over 4K frame, Blend kernels vs OIIO
+//
+// Kernels are first checked: SIMD output must be the scalar one, scalar
+// output at most 1 LSB away from OIIO. Exits with 1 on mismatch.
+//
+// Usage: blend-bench [loops]
+
+
+// Random alpha, 1/8 fully transparent & 1/8 opaque
+static unsigned int alpha(unsigned int max) {
+	switch (rand() % 8) {
+	case 0:
+		return 0;
+	case 1:
+		return max;
+	default:
+		return rand() % (max + 1);
+	}
+}
+
+
+// Premultiplied RGBA pixels
+template <typename T>
+static void fill(std::vector<T> &pixels, unsigned int max) {
+	for (size_t i=0; i<pixels.size(); i+=4) {
+		unsigned int a = alpha(max);
+
+		for (int c=0; c<3; c++)
+			pixels[i + c] = rand() % (a + 1);
+		pixels[i + 3] = a;
+	}
+}
+
+
+static void fill(OIIO::ImageBuf &buf, bool premultiplied) {
+	const OIIO::ImageSpec &spec = buf.spec();
+
+	int bpc = spec.format.size();
+
+	for (int y=spec.y; y<spec.y+spec.height; y++) {
+		for (int x=spec.x; x<spec.x+spec.width; x++) {
+			unsigned int a = alpha(255);
+			unsigned int v[4];
+
+			for (int c=0; c<4; c++)
+				v[c] = premultiplied ? (a ? (rand() % (a + 1)) : 0) : (rand() % 256);
+			v[3] = a;
+
+			if (bpc == 1) {
+				uint8_t *p = (uint8_t *) buf.pixeladdr(x, y);
+
+				for (int c=0; c<spec.nchannels; c++)
+					p[c] = v[c];
+			}
+			else {
+				uint16_t *p = (uint16_t *) buf.pixeladdr(x, y);
+
+				for (int c=0; c<spec.nchannels; c++)
+					p[c] = v[c] * 257;
+			}
+		}
+	}
+}
+
+
+static double run(OIIO::ImageBuf &frame, const OIIO::ImageBuf &widget, int loops, bool oiio) {
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i=0; i<loops; i++) {
+		if (oiio)
+			OIIO::ImageBufAlgo::over(frame, widget, frame, widget.roi(), 1);
+		else
+			Blend::over(frame, widget, widget.roi());
+	}
+
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::milli>(end - start).count() / loops;
+}
+
+
+template <typename T>
+static bool checkKernel(void (*over)(T *dst, const T *src, int n), unsigned int max, const char *label) {
+	bool result = true;
+
+	// Row lengths, tails of each vector width
+	const int lengths[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 4099 };
+
+	for (int n : lengths) {
+		std::vector<T> src(n * 4), dst(n * 4), ref, out;
+
+		fill(src, max);
+		fill(dst, max);
+
+		// Reference
+		Blend::setISA(Blend::ISAScalar);
+
+		ref = dst;
+		over(ref.data(), src.data(), n);
+
+		for (int isa=Blend::ISAScalar + 1; isa<Blend::ISACount; isa++) {
+			if (!Blend::setISA((Blend::ISA) isa))
+				continue;
+
+			out = dst;
+			over(out.data(), src.data(), n);
+
+			for (size_t i=0; i<out.size(); i++) {
+				if (out[i] == ref[i])
+					continue;
+
+				printf("  %-8s %s: pixel %lu/%d channel %lu: %u, scalar %u (src %u alpha %u, dst %u)\n",
+					Blend::isa2string((Blend::ISA) isa), label, i / 4, n, i % 4,
+					(unsigned int) out[i], (unsigned int) ref[i],
+					(unsigned int) src[i], (unsigned int) src[i - (i % 4) + 3], (unsigned int) dst[i]);
+
+				result = false;
+				break;
+			}
+		}
+	}
+
+	return result;
+}
+
+
+static bool checkOIIO(OIIO::TypeDesc format) {
+	bool result = true;
+
+	int max = (format == OIIO::TypeDesc::UINT8) ? 255 : 65535;
+	int diff, max_diff = 0;
+
+	OIIO::ImageSpec spec(257, 67, 4, format);
+	spec.alpha_channel = 3;
+
+	OIIO::ImageBuf src(spec), dst(spec), ref(spec);
+
+	fill(src, true);
+	fill(dst, true);
+
+	ref.copy(dst);
+
+	Blend::setISA(Blend::ISAScalar);
+
+	Blend::over(dst, src, src.roi());
+	OIIO::ImageBufAlgo::over(ref, src, ref, src.roi(), 1);
+
+	for (int y=0; y<spec.height; y++) {
+		for (int x=0; x<spec.width; x++) {
+			for (int c=0; c<4; c++) {
+				diff = abs((int) (dst.getchannel(x, y, 0, c) * max + 0.5f) - (int) (ref.getchannel(x, y, 0, c) * max + 0.5f));
+
+				max_diff = std::max(max_diff, diff);
+			}
+		}
+	}
+
+	if (max_diff > 1) {
+		printf("  %-8s %s: scalar differs from OIIO by %d\n", "scalar", format.c_str(), max_diff);
+		result = false;
+	}
+
+	return result;
+}
+
+
+static bool check(void) {
+	bool result = true;
+
+	printf("Check kernels\n");
+
+	result &= checkKernel<uint8_t>(Blend::over8, 255, "uint8");
+	result &= checkKernel<uint16_t>(Blend::over16, 65535, "uint16");
+
+	result &= checkOIIO(OIIO::TypeDesc::UINT8);
+	result &= checkOIIO(OIIO::TypeDesc::UINT16);
+
+	printf("  %s\n", result ? "OK" : "FAIL");
+
+	return result;
+}
+
+
+static void bench(OIIO::TypeDesc format, int loops) {
+	// 4K video frame
+	OIIO::ImageSpec frame_spec(3840, 2160, 4, format);
+	OIIO::ImageBuf frame(frame_spec);
+
+	// Widget sized bitmap
+	OIIO::ImageSpec widget_spec(600, 200, 4, format);
+	widget_spec.x = 100;
+	widget_spec.y = 1800;
+	widget_spec.alpha_channel = 3;
+	OIIO::ImageBuf widget(widget_spec);
+
+	fill(frame, false);
+	fill(widget, true);
+
+	printf("%s - widget %dx%d over %dx%d frame\n", format.c_str(),
+		widget_spec.width, widget_spec.height, frame_spec.width, frame_spec.height);
+
+	printf("  %-8s %8.3f ms\n", "oiio", run(frame, widget, loops, true));
+
+	for (int isa=0; isa<Blend::ISACount; isa++) {
+		if (!Blend::setISA((Blend::ISA) isa))
+			continue;
+
+		printf("  %-8s %8.3f ms\n", Blend::isa2string((Blend::ISA) isa), run(frame, widget, loops, false));
+	}
+}
+
+
+int main(int argc, char *argv[]) {
+	int loops = (argc > 1) ? atoi(argv[1]) : 200;
+
+	gpx2video_log_set_level(0);
+
+	srand(1);
+
+	if (!check())
+		return 1;
+
+	bench(OIIO::TypeDesc::UINT8, loops);
+	bench(OIIO::TypeDesc::UINT16, loops);
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+#!/bin/sh
+#
+# Map download test, against a local tiles server (tileserver.py)
+#
+# - first run downloads each tile once (200), transfers in parallel are
+#   bounded by --map-connections
+# - second run, tiles expired: conditional requests, server answers 304,
+#   map is unchanged
+# - third run, tiles changed on server: tiles downloaded again (200), map
+#   is updated (map mosaic not reused)
+#
+# Usage: map-download.sh [gpx2video binary]
+
+GPX2VIDEO=${1:-build/tools/gpx2video}
+PORT=${PORT:-18123}
+CONNECTIONS=3
+
+DIR=$(dirname "$0")
+TMP=$(mktemp -d)
+
+SERVER=
+
+cleanup() {
+	[ -n "$SERVER" ] && kill $SERVER 2>/dev/null
+	rm -rf "$TMP"
+}
+
+fail() {
+	echo "FAIL: $*"
+	cleanup
+	exit 1
+}
+
+trap cleanup INT TERM
+
+# Private cache
+export HOME="$TMP/home"
+mkdir -p "$HOME" "$TMP/server"
+
+cat > "$TMP/track.gpx" <<EOF
+<?xml version="1.0" encoding="UTF-8"?>
+<gpx version="1.1" creator="gpx2video" xmlns="http://www.topografix.com/GPX/1/1">
+  <trk>
+    <trkseg>
+      <trkpt lat="49.4802" lon="1.1210"><time>2022-09-04T06:42:55.000Z</time></trkpt>
+      <trkpt lat="49.4750" lon="1.1300"><time>2022-09-04T06:44:55.000Z</time></trkpt>
+      <trkpt lat="49.4700" lon="1.1400"><time>2022-09-04T06:46:55.000Z</time></trkpt>
+    </trkseg>
+  </trk>
+</gpx>
+EOF
+
+python3 "$DIR/tileserver.py" $PORT "$TMP/server" &
+SERVER=$!
+sleep 1
+
+# run output
+run() {
+	: > "$TMP/server/requests.log"
+
+	"$GPX2VIDEO" -q -g "$TMP/track.gpx" -o "$1" \
+		--map-source=1 --map-zoom=14 \
+		--map-connections=$CONNECTIONS --map-rate=0 \
+		--map-url=http://127.0.0.1:$PORT \
+		map || fail "gpx2video map"
+
+	[ -f "$1" ] || fail "no map rendered"
+}
+
+# count status conditional
+count() {
+	awk -v s=$1 -v c=$2 '$1 == s && $2 == c { n++ } END { print n + 0 }' "$TMP/server/requests.log"
+}
+
+concurrency() {
+	awk '$3 > n { n = $3 } END { print n + 0 }' "$TMP/server/requests.log"
+}
+
+# 1. Download
+run "$TMP/map1.png"
+
+n=$(count 200 0)
+total=$(wc -l < "$TMP/server/requests.log")
+max=$(concurrency)
+
+[ "$n" -gt 0 ] || fail "no tile downloaded"
+[ "$n" -eq "$total" ] || fail "first run: $total requests, $n plain downloads"
+[ $(sort -k4 "$TMP/server/requests.log" | awk '{ print $4 }' | uniq -d | wc -l) -eq 0 ] || fail "tile downloaded twice"
+[ "$max" -le $CONNECTIONS ] || fail "$max transfers in parallel, limit $CONNECTIONS"
+
+echo "download: $n tiles, $max transfers in parallel"
+
+# 2. Revalidate (max-age=1)
+sleep 2
+run "$TMP/map2.png"
+
+n=$(count 304 1)
+total=$(wc -l < "$TMP/server/requests.log")
+
+[ "$total" -gt 0 ] || fail "expired tiles not revalidated"
+[ "$n" -eq "$total" ] || fail "revalidate: $total requests, $n answered 304"
+cmp -s "$TMP/map1.png" "$TMP/map2.png" || fail "map changed while tiles not modified"
+
+echo "revalidate: $n tiles not modified"
+
+# 3. Tiles modified on server
+echo 1 > "$TMP/server/generation"
+sleep 2
+run "$TMP/map3.png"
+
+n=$(count 200 1)
+total=$(wc -l < "$TMP/server/requests.log")
+
+[ "$n" -eq "$total" ] || fail "modified: $total requests, $n downloaded again"
+cmp -s "$TMP/map1.png" "$TMP/map3.png" && fail "map not updated with modified tiles"
+
+echo "modified: $n tiles downloaded again"
+
+echo "OK"
+
+cleanup
+
+exit 0
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+#
+# Local map tiles server, to test map download (see map-download.sh)
+#
+# Serves a plain color PNG for any /z/x/y.png request, with an ETag & a
+# short max-age. Answers 304 to a matching If-None-Match. Tiles color (and
+# ETag) changes with the generation read from the 'generation' file.
+#
+# Each request is logged to 'requests.log': status, conditional (0/1) and
+# requests in flight.
+#
+# Usage: tileserver.py port statedir
+
+import os
+import sys
+import time
+import zlib
+import struct
+import threading
+
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+TILE_SIZE = 256
+
+COLORS = [ (0xe0, 0xe0, 0xd0), (0x40, 0x80, 0xc0), (0xc0, 0x40, 0x40) ]
+
+lock = threading.Lock()
+inflight = 0
+
+
+def png(color):
+	def chunk(kind, data):
+		body = kind + data
+		return struct.pack('>I', len(data)) + body + struct.pack('>I', zlib.crc32(body) & 0xffffffff)
+
+	row = b'\x00' + bytes(color) * TILE_SIZE
+	raw = row * TILE_SIZE
+
+	return (b'\x89PNG\r\n\x1a\n'
+		+ chunk(b'IHDR', struct.pack('>IIBBBBB', TILE_SIZE, TILE_SIZE, 8, 2, 0, 0, 0))
+		+ chunk(b'IDAT', zlib.compress(raw))
+		+ chunk(b'IEND', b''))
+
+
+class Handler(BaseHTTPRequestHandler):
+	protocol_version = 'HTTP/1.1'
+
+	def log_message(self, format, *args):
+		pass
+
+	def generation(self):
+		try:
+			with open(os.path.join(self.server.statedir, 'generation')) as f:
+				return int(f.read().strip())
+		except (OSError, ValueError):
+			return 0
+
+	def record(self, status, conditional, count):
+		with lock:
+			with open(os.path.join(self.server.statedir, 'requests.log'), 'a') as f:
+				f.write('%d %d %d %s\n' % (status, conditional, count, self.path))
+
+	def do_GET(self):
+		global inflight
+
+		with lock:
+			inflight += 1
+			count = inflight
+
+		try:
+			gen = self.generation()
+			etag = '"tile-%d"' % gen
+			match = self.headers.get('If-None-Match')
+
+			# Slow server, so parallel transfers overlap
+			time.sleep(0.05)
+
+			if match == etag:
+				self.send_response(304)
+				self.send_header('ETag', etag)
+				self.send_header('Cache-Control', 'max-age=1')
+				self.send_header('Content-Length', '0')
+				self.end_headers()
+				status = 304
+			else:
+				body = png(COLORS[gen % len(COLORS)])
+
+				self.send_response(200)
+				self.send_header('Content-Type', 'image/png')
+				self.send_header('ETag', etag)
+				self.send_header('Cache-Control', 'max-age=1')
+				self.send_header('Content-Length', str(len(body)))
+				self.end_headers()
+				self.wfile.write(body)
+				status = 200
+
+			self.record(status, match is not None, count)
+		finally:
+			with lock:
+				inflight -= 1
+
+
+def main():
+	if len(sys.argv) != 3:
+		sys.stderr.write('Usage: %s port statedir\n' % sys.argv[0])
+		return 1
+
+	server = ThreadingHTTPServer(('127.0.0.1', int(sys.argv[1])), Handler)
+	server.statedir = sys.argv[2]
+	server.serve_forever()
+
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -0,0 +1,668 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include <string.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavfilter/avfilter.h>
+#include <libavfilter/buffersink.h>
+}
+
+#include <OpenImageIO/imageio.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+
+#include "log_i.h"
+#include "frame.h"
+#include "encoder.h"
+#include "mapsettings.h"
+
+
+// End-to-end rendering benchmark
+//
+// Synthesizes test videos (lavfi testsrc2) and a tile cache, then renders
+// a matrix of layouts with gpx2video and reports fps, CPU time & peak RSS.
+// No network access is required.
+//
+// Cache is reset before each case (seeded tiles only). Warm cases are
+// rendered once untimed first, so the tile store & map mosaics are built.
+
+#ifndef BENCH_DATA_DIR
+#define BENCH_DATA_DIR "."
+#endif
+
+#define BENCH_RATE 30
+#define BENCH_ZOOM 13
+#define BENCH_START_TIME "2022-09-04 07:00:00Z"
+
+
+namespace bench {
+
+class Resolution {
+public:
+	const char *name;
+	int width;
+	int height;
+};
+
+class Case {
+public:
+	const char *name;
+	const char *telemetry;
+	std::vector<const char *> widgets;
+};
+
+class Result {
+public:
+	std::string name;
+	std::string resolution;
+	std::string cache;
+
+	bool success;
+
+	int frames;
+	double wall;
+	double cpu;
+	long rss;
+};
+
+
+static const Resolution resolutions[] = {
+	{ "1080p", 1920, 1080 },
+	{ "4k", 3840, 2160 },
+};
+
+
+static const char *caches[] = { "cold", "warm" };
+
+
+// Layout widgets
+static const char *widget_text =
+	"\t<widget position=\"left\" orientation=\"vertical\" width=\"400\" height=\"80\">\n"
+	"\t\t<type>speed</type><name>SPEED</name><unit>kph</unit><margin>20</margin><padding>5</padding>\n"
+	"\t</widget>\n"
+	"\t<widget position=\"left\" orientation=\"vertical\" width=\"400\" height=\"80\">\n"
+	"\t\t<type>elevation</type><name>ELEVATION</name><unit>m</unit><margin>20</margin><padding>5</padding>\n"
+	"\t</widget>\n"
+	"\t<widget position=\"left\" orientation=\"vertical\" width=\"400\" height=\"80\">\n"
+	"\t\t<type>distance</type><name>DISTANCE</name><unit>km</unit><margin>20</margin><padding>5</padding>\n"
+	"\t</widget>\n"
+	"\t<widget position=\"left\" orientation=\"vertical\" width=\"400\" height=\"80\">\n"
+	"\t\t<type>time</type><name>TIME</name><margin>20</margin><padding>5</padding>\n"
+	"\t</widget>\n";
+
+static const char *widget_gauges =
+	"\t<widget position=\"right\" orientation=\"vertical\" width=\"300\" height=\"300\">\n"
+	"\t\t<type>speed</type><name>SPEED</name><shape>arc</shape><unit>kph</unit><margin>20</margin>\n"
+	"\t\t<value-min>0</value-min><value-max>60</value-max>\n"
+	"\t</widget>\n"
+	"\t<widget position=\"right\" orientation=\"vertical\" width=\"300\" height=\"300\">\n"
+	"\t\t<type>cadence</type><name>CADENCE</name><shape>arc</shape><margin>20</margin>\n"
+	"\t\t<value-min>0</value-min><value-max>120</value-max>\n"
+	"\t</widget>\n"
+	"\t<widget position=\"right\" orientation=\"vertical\" width=\"300\" height=\"80\">\n"
+	"\t\t<type>grade</type><name>GRADE</name><shape>bar</shape><margin>20</margin>\n"
+	"\t\t<value-min>-10</value-min><value-max>10</value-max>\n"
+	"\t</widget>\n";
+
+static const char *widget_charts =
+	"\t<widget position=\"bottom\" orientation=\"horizontal\" width=\"600\" height=\"200\">\n"
+	"\t\t<type>elevation</type><name>ELEVATION</name><shape>chart</shape><unit>m</unit><margin>20</margin>\n"
+	"\t</widget>\n"
+	"\t<widget position=\"bottom\" orientation=\"horizontal\" width=\"600\" height=\"200\">\n"
+	"\t\t<type>speed</type><name>SPEED</name><shape>chart</shape><unit>kph</unit><margin>20</margin>\n"
+	"\t</widget>\n";
+
+static const char *widget_map =
+	"\t<map position=\"top-right\" width=\"800\" height=\"500\">\n"
+	"\t\t<source>1</source><zoom>13</zoom><margin>20</margin><border>2</border>\n"
+	"\t</map>\n";
+
+
+static const std::vector<Case> cases = {
+	{ "text", "data.gpx", { widget_text } },
+	{ "text-csv", "data.csv", { widget_text } },
+	{ "gauges", "data.gpx", { widget_gauges } },
+	{ "charts", "data.gpx", { widget_charts } },
+	{ "map", "data.gpx", { widget_map } },
+	{ "dashboard", "data.gpx", { widget_text, widget_gauges, widget_charts, widget_map } },
+};
+
+
+static const struct option options[] = {
+	{ "help",                       no_argument,       0, 'h' },
+	{ "binary",                     required_argument, 0, 'b' },
+	{ "workdir",                    required_argument, 0, 'w' },
+	{ "resolution",                 required_argument, 0, 'r' },
+	{ "duration",                   required_argument, 0, 'd' },
+	{ "case",                       required_argument, 0, 'c' },
+	{ "cache",                      required_argument, 0, 'k' },
+	{ "output",                     required_argument, 0, 'o' },
+	{ 0,                            0,                 0, 0 }
+};
+
+
+static void print_usage(const std::string &name) {
+	std::cout << "Usage: " << name << " [options] [-- gpx2video options]" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "\t- b, --binary=file                     : gpx2video binary (default: next to the bench)" << std::endl;
+	std::cout << "\t- w, --workdir=path                    : Work directory (default: ./bench)" << std::endl;
+	std::cout << "\t- r, --resolution=name                 : Video resolution: 1080p, 4k or all (default: all)" << std::endl;
+	std::cout << "\t- d, --duration=value                  : Test video duration in seconds (default: 10)" << std::endl;
+	std::cout << "\t- c, --case=name                       : Run only one layout case" << std::endl;
+	std::cout << "\t- k, --cache=mode                      : Tile & map cache: cold, warm or all (default: cold)" << std::endl;
+	std::cout << "\t- o, --output=file                     : Save report as CSV" << std::endl;
+	std::cout << "\t- h, --help                            : Show this help screen" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Cases:" << std::endl;
+
+	for (const Case &c : cases)
+		std::cout << "\t- " << c.name << std::endl;
+
+	return;
+}
+
+
+static double now(void) {
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+/**
+ * Test video, lavfi testsrc2 encoded in H.264
+ */
+static bool synthesize(const std::string &filename, const Resolution &resolution, int duration) {
+	int result;
+	int64_t index = 0;
+
+	char filters[256];
+
+	bool success = false;
+
+	Encoder *encoder = NULL;
+	EncoderSettings encoderSettings;
+
+	AVFrame *avframe = NULL;
+	AVFilterGraph *graph = NULL;
+	AVFilterInOut *inputs = NULL;
+	AVFilterContext *sink_ctx = NULL;
+
+	if (access(filename.c_str(), F_OK) == 0)
+		return true;
+
+	log_notice("Synthesize %s test video (%d s)...", resolution.name, duration);
+
+	snprintf(filters, sizeof(filters), "testsrc2=size=%dx%d:rate=%d:duration=%d,format=yuv420p",
+		resolution.width, resolution.height, BENCH_RATE, duration);
+
+	// Filter graph: testsrc2 -> buffersink
+	graph = avfilter_graph_alloc();
+
+	result = avfilter_graph_create_filter(&sink_ctx, avfilter_get_by_name("buffersink"), "out", NULL, NULL, graph);
+	if (result < 0) {
+		log_error("Can't create buffer sink");
+		goto fail;
+	}
+
+	inputs = avfilter_inout_alloc();
+	inputs->name = av_strdup("out");
+	inputs->filter_ctx = sink_ctx;
+	inputs->pad_idx = 0;
+	inputs->next = NULL;
+
+	if ((result = avfilter_graph_parse_ptr(graph, filters, &inputs, NULL, NULL)) < 0) {
+		log_error("Can't parse filter graph '%s'", filters);
+		goto fail;
+	}
+
+	if ((result = avfilter_graph_config(graph, NULL)) < 0) {
+		log_error("Can't configure filter graph");
+		goto fail;
+	}
+
+	// Encoder
+	{
+		VideoParams video_params(resolution.width, resolution.height,
+			av_make_q(1, BENCH_RATE),
+			VideoParams::FormatUnsigned8,
+			VideoParams::RGBAChannelCount,
+			0,
+			av_make_q(1, 1),
+			VideoParams::InterlaceNone);
+
+		video_params.setPixelFormat(AV_PIX_FMT_YUV420P);
+
+		encoderSettings.setFilename(filename);
+		encoderSettings.setVideoParams(video_params, ExportCodec::CodecH264);
+		encoderSettings.setVideoOption("preset", "ultrafast");
+		encoderSettings.setVideoOption("crf", "23");
+	}
+
+	encoder = Encoder::create(encoderSettings);
+
+	if (!encoder->open()) {
+		log_error("Can't open test video '%s'", filename.c_str());
+		goto fail;
+	}
+
+	avframe = av_frame_alloc();
+
+	// Encode each frame as is (native frame)
+	while ((result = av_buffersink_get_frame(sink_ctx, avframe)) >= 0) {
+		FramePtr frame = Frame::create();
+
+		frame->setVideoParams(encoderSettings.videoParams());
+		frame->setTimestamp(index);
+		frame->setAVFrame(av_frame_clone(avframe));
+
+		encoder->writeFrame(frame, av_make_q(index, BENCH_RATE));
+
+		av_frame_unref(avframe);
+
+		index++;
+	}
+
+	encoder->close();
+
+	success = (index > 0);
+
+fail:
+	if (!success)
+		unlink(filename.c_str());
+
+	if (encoder)
+		delete encoder;
+
+	av_frame_free(&avframe);
+	avfilter_inout_free(&inputs);
+	avfilter_graph_free(&graph);
+
+	return success;
+}
+
+
+/**
+ * Tile cache, synthetic tiles around the track
+ */
+static int lon2tile(double lon, int zoom) {
+	return (int) floor((lon + 180.0) / 360.0 * (1 << zoom));
+}
+
+
+static int lat2tile(double lat, int zoom) {
+	double rad = lat * M_PI / 180.0;
+
+	return (int) floor((1.0 - asinh(tan(rad)) / M_PI) / 2.0 * (1 << zoom));
+}
+
+
+static bool seedTiles(const std::string &home, const std::string &gpxfile, int zoom, int margin) {
+	int nbr = 0;
+
+	double lat, lon;
+	double lat_min = 90, lat_max = -90;
+	double lon_min = 180, lon_max = -180;
+
+	std::string line;
+	std::string path;
+
+	std::ifstream stream(gpxfile);
+
+	if (!stream.is_open()) {
+		log_error("Can't read '%s'", gpxfile.c_str());
+		return false;
+	}
+
+	// Track bounding box
+	while (std::getline(stream, line)) {
+		const char *s = strstr(line.c_str(), "lat=\"");
+		const char *t = strstr(line.c_str(), "lon=\"");
+
+		if ((s == NULL) || (t == NULL))
+			continue;
+
+		lat = atof(s + 5);
+		lon = atof(t + 5);
+
+		lat_min = MIN(lat_min, lat);
+		lat_max = MAX(lat_max, lat);
+		lon_min = MIN(lon_min, lon);
+		lon_max = MAX(lon_max, lon);
+	}
+
+	if (lat_min > lat_max)
+		return false;
+
+	// $HOME/.gpx2video/cache/<source>/<zoom>/tile_<y>_<x>.png (see Map)
+	path = home + "/.gpx2video/cache/" + std::to_string(MapSettings::SourceOpenStreetMap) + "/" + std::to_string(zoom);
+
+	std::filesystem::create_directories(path);
+
+	for (int y=lat2tile(lat_max, zoom)-margin; y<=lat2tile(lat_min, zoom)+margin; y++) {
+		for (int x=lon2tile(lon_min, zoom)-margin; x<=lon2tile(lon_max, zoom)+margin; x++) {
+			std::string filename = path + "/tile_" + std::to_string(y) + "_" + std::to_string(x) + ".png";
+
+			if (access(filename.c_str(), F_OK) == 0)
+				continue;
+
+			float color[] = { 0.85f, 0.88f, 0.80f };
+			float grid[] = { 0.60f, 0.60f, 0.60f };
+
+			OIIO::ImageBuf tile(OIIO::ImageSpec(256, 256, 3, OIIO::TypeDesc::UINT8));
+
+			OIIO::ImageBufAlgo::fill(tile, color);
+			OIIO::ImageBufAlgo::fill(tile, grid, OIIO::ROI(0, 256, 0, 2));
+			OIIO::ImageBufAlgo::fill(tile, grid, OIIO::ROI(0, 2, 0, 256));
+
+			if (!tile.write(filename)) {
+				log_error("Can't write tile '%s'", filename.c_str());
+				return false;
+			}
+
+			nbr++;
+		}
+	}
+
+	if (nbr > 0)
+		log_notice("Tile cache: %d tile(s) created", nbr);
+
+	return true;
+}
+
+
+// Drop tile store, map mosaics & tiles of the previous case
+static bool resetCache(const std::string &home) {
+	std::error_code ec;
+
+	std::filesystem::remove_all(home + "/.gpx2video/cache", ec);
+
+	if (ec) {
+		log_error("Can't reset cache '%s/.gpx2video/cache'", home.c_str());
+		return false;
+	}
+
+	return seedTiles(home, std::string(BENCH_DATA_DIR) + "/data.gpx", BENCH_ZOOM, 6);
+}
+
+
+static bool writeLayout(const std::string &filename, const Case &c) {
+	std::ofstream stream(filename);
+
+	if (!stream.is_open())
+		return false;
+
+	stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << std::endl;
+	stream << "<layout>" << std::endl;
+
+	for (const char *widget : c.widgets)
+		stream << widget;
+
+	stream << "</layout>" << std::endl;
+
+	return true;
+}
+
+
+/**
+ * Render a case, gpx2video runs in a child process to measure its CPU
+ * time & peak RSS
+ */
+static bool run(const std::string &binary, const std::string &workdir, const std::string &home,
+	const std::string &media, const Case &c, const Resolution &resolution,
+	const std::vector<std::string> &extra, Result &result) {
+	int fd;
+	int status;
+
+	pid_t pid;
+
+	double begin;
+
+	struct rusage usage;
+
+	std::string name = std::string(c.name) + "-" + resolution.name;
+
+	std::string layout = workdir + "/" + name + ".xml";
+	std::string output = workdir + "/" + name + ".mp4";
+	std::string logfile = workdir + "/" + name + ".log";
+
+	std::vector<std::string> args = {
+		binary,
+		"-m", media,
+		"-g", std::string(BENCH_DATA_DIR) + "/" + c.telemetry,
+		"-l", layout,
+		"-o", output,
+		"--start-time", BENCH_START_TIME,
+	};
+
+	args.insert(args.end(), extra.begin(), extra.end());
+	args.push_back("video");
+
+	result.name = c.name;
+	result.resolution = resolution.name;
+	result.success = false;
+
+	if (!writeLayout(layout, c)) {
+		log_error("Can't write layout '%s'", layout.c_str());
+		return false;
+	}
+
+	unlink(output.c_str());
+
+	begin = now();
+
+	if ((pid = fork()) < 0) {
+		log_error("Can't fork gpx2video");
+		return false;
+	}
+
+	if (pid == 0) {
+		std::vector<char *> argv;
+
+		for (std::string &arg : args)
+			argv.push_back((char *) arg.c_str());
+		argv.push_back(NULL);
+
+		// Offline tile cache
+		setenv("HOME", home.c_str(), 1);
+
+		if ((fd = ::open(logfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0) {
+			dup2(fd, STDOUT_FILENO);
+			dup2(fd, STDERR_FILENO);
+			close(fd);
+		}
+
+		execv(argv[0], argv.data());
+		_exit(127);
+	}
+
+	if (wait4(pid, &status, 0, &usage) < 0) {
+		log_error("Can't wait gpx2video");
+		return false;
+	}
+
+	result.wall = now() - begin;
+	result.cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0
+		+ usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+	result.rss = usage.ru_maxrss;
+	result.success = WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+
+	if (!result.success)
+		log_warn("Case %s failed, see %s", name.c_str(), logfile.c_str());
+
+	return result.success;
+}
+
+}
+
+
+int main(int argc, char *argv[]) {
+	int c;
+	int index = 0;
+
+	int duration = 10;
+
+	std::string binary;
+	std::string output;
+	std::string only;
+	std::string resolution = "all";
+	std::string cache = "cold";
+	std::string workdir = "bench";
+
+	std::vector<std::string> extra;
+	std::vector<bench::Result> results;
+
+	const std::string name(argv[0]);
+
+	for (;;) {
+		c = getopt_long(argc, argv, "hb:w:r:d:c:k:o:", bench::options, &index);
+
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'b':
+			binary = std::string(optarg);
+			break;
+		case 'w':
+			workdir = std::string(optarg);
+			break;
+		case 'r':
+			resolution = std::string(optarg);
+			break;
+		case 'd':
+			duration = MAX(1, atoi(optarg));
+			break;
+		case 'c':
+			only = std::string(optarg);
+			break;
+		case 'k':
+			cache = std::string(optarg);
+			break;
+		case 'o':
+			output = std::string(optarg);
+			break;
+		case 'h':
+		default:
+			bench::print_usage(name);
+			return (c == 'h') ? 0 : -1;
+		}
+	}
+
+	// Extra gpx2video options
+	for (int i=optind; i<argc; i++)
+		extra.push_back(argv[i]);
+
+	// gpx2video binary, built next to the bench
+	if (binary.empty())
+		binary = std::filesystem::canonical("/proc/self/exe").parent_path().string() + "/gpx2video";
+
+	if (access(binary.c_str(), X_OK) != 0) {
+		log_error("gpx2video binary '%s' not found", binary.c_str());
+		return -1;
+	}
+
+	std::filesystem::create_directories(workdir);
+	workdir = std::filesystem::canonical(workdir).string();
+
+	if ((cache != "cold") && (cache != "warm") && (cache != "all")) {
+		log_error("Unknown cache mode '%s'", cache.c_str());
+		return -1;
+	}
+
+	std::string home = workdir + "/home";
+
+	for (const bench::Resolution &res : bench::resolutions) {
+		if ((resolution != "all") && (resolution != res.name))
+			continue;
+
+		std::string media = workdir + "/testsrc-" + res.name + "-" + std::to_string(duration) + "s.mp4";
+
+		if (!bench::synthesize(media, res, duration))
+			return -1;
+
+		for (const bench::Case &c : bench::cases) {
+			if (!only.empty() && (only != c.name))
+				continue;
+
+			for (const char *mode : bench::caches) {
+				bench::Result result;
+
+				if ((cache != "all") && (cache != mode))
+					continue;
+
+				if (!bench::resetCache(home))
+					return -1;
+
+				// Build tile store & mosaics
+				if (!strcmp(mode, "warm")) {
+					log_notice("Warm up %s @ %s...", c.name, res.name);
+
+					bench::run(binary, workdir, home, media, c, res, extra, result);
+				}
+
+				log_notice("Render %s @ %s (%s cache)...", c.name, res.name, mode);
+
+				bench::run(binary, workdir, home, media, c, res, extra, result);
+
+				result.cache = mode;
+				result.frames = duration * BENCH_RATE;
+
+				results.push_back(result);
+			}
+		}
+	}
+
+	// Report
+	printf("\n%-12s %-6s %-5s %8s %8s %8s %10s\n", "case", "res", "cache", "fps", "wall(s)", "cpu(s)", "rss(MB)");
+
+	for (const bench::Result &result : results) {
+		if (!result.success) {
+			printf("%-12s %-6s %-5s %8s\n", result.name.c_str(), result.resolution.c_str(), result.cache.c_str(), "FAILED");
+			continue;
+		}
+
+		printf("%-12s %-6s %-5s %8.2f %8.2f %8.2f %10.1f\n", result.name.c_str(), result.resolution.c_str(), result.cache.c_str(),
+			result.frames / result.wall, result.wall, result.cpu, result.rss / 1024.0);
+	}
+
+	if (!output.empty()) {
+		FILE *fp = fopen(output.c_str(), "w");
+
+		if (fp == NULL) {
+			log_error("Can't write report '%s'", output.c_str());
+			return -1;
+		}
+
+		fprintf(fp, "case,resolution,cache,success,frames,fps,wall_s,cpu_s,rss_kb\n");
+
+		for (const bench::Result &result : results) {
+			fprintf(fp, "%s,%s,%s,%d,%d,%.3f,%.3f,%.3f,%ld\n",
+				result.name.c_str(), result.resolution.c_str(), result.cache.c_str(), result.success ? 1 : 0,
+				result.frames, result.success ? result.frames / result.wall : 0.0,
+				result.wall, result.cpu, result.rss);
+		}
+
+		fclose(fp);
+	}
+
+	return 0;
+}
@@ -49,6 +49,9 @@ static const struct option options[] = {
 	{ "map-factor",                 required_argument, 0, 0 },
 	{ "map-zoom",                   required_argument, 0, 0 },
 	{ "map-source-list",            no_argument,       0, 0 },
+	{ "map-connections",            required_argument, 0, 0 },
+	{ "map-rate",                   required_argument, 0, 0 },
+	{ "map-url",                    required_argument, 0, 0 },
 	{ "extract-format",             required_argument, 0, 0 },
 	{ "extract-format-list",        no_argument,       0, 0 },
 	{ "gpx-begin",                  required_argument, 0, 0 },
@@ -73,6 +76,16 @@ static const struct option options[] = {
 	{ "video-bitrate",              required_argument, 0, 0 },
 	{ "video-min-bitrate",          required_argument, 0, 0 },
 	{ "video-max-bitrate",          required_argument, 0, 0 },
+	{ "audio-reencode",             no_argument,       0, 0 },
+	{ "render-threads",             required_argument, 0, 0 },
+	{ "render-scale-threads",       required_argument, 0, 0 },
+	{ "render-yuv",                 no_argument,       0, 0 },
+	{ "render-overlay",             no_argument,       0, 0 },
+	{ "render-profile",             required_argument, 0, 0 },
+	{ "render-trace",               required_argument, 0, 0 },
+	{ "render-atlas",               required_argument, 0, 0 },
+	{ "render-segments",            required_argument, 0, 0 },
+	{ "render-segment",             required_argument, 0, 0 },	// Internal: segment renderer
 	{ 0,                            0,                 0, 0 }
 };
 
@@ -107,6 +120,9 @@ static void print_usage(const std::string &name) {
 	std::cout << "\t-    --map-factor                      : Map factor (default: 1.0)" << std::endl;
 	std::cout << "\t-    --map-source                      : Map source" << std::endl;
 	std::cout << "\t-    --map-zoom                        : Map zoom" << std::endl;
+	std::cout << "\t-    --map-connections                 : Map tiles downloaded in parallel (default: 4)" << std::endl;
+	std::cout << "\t-    --map-rate                        : Map tiles requests per second (default: 10, 0 = no limit)" << std::endl;
+	std::cout << "\t-    --map-url=url                     : Map tiles server, overrides map source URL (base URL or #Z/#X/#Y template)" << std::endl;
 	std::cout << "\t-    --path-thick                      : Path thick (default: 3.0)" << std::endl;
 	std::cout << "\t-    --path-border                     : Path border (default: 1.4)" << std::endl;
 	std::cout << "\t- v, --verbose                         : Show trace" << std::endl;
@@ -129,6 +145,17 @@ static void print_usage(const std::string &name) {
 	std::cout << "\t-    --video-bitrate                   : Video encoder bitrate" << std::endl;
 	std::cout << "\t-    --video-min-bitrate               : Video encoder min bitrate" << std::endl;
 	std::cout << "\t-    --video-max-bitrate               : Video encoder max bitrate" << std::endl;
+	std::cout << "\t-    --audio-reencode                  : Encode audio in AAC (default: copy input audio)" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Render options:" << std::endl;
+	std::cout << "\t-    --render-threads                  : Number of compositing threads (default: 0 = auto)" << std::endl;
+	std::cout << "\t-    --render-scale-threads            : Number of colour conversion threads (default: 0 = auto)" << std::endl;
+	std::cout << "\t-    --render-yuv                      : Blend widgets in native YUV frames (yuv420p, nv12, p010)" << std::endl;
+	std::cout << "\t-    --render-overlay                  : Render only widgets in an alpha video (prores, vp9, qtrle or png)" << std::endl;
+	std::cout << "\t-    --render-profile=file             : Save per stage timings (p50, p95, p99) report (.json or .csv)" << std::endl;
+	std::cout << "\t-    --render-trace=file               : Save per frame timings in Chrome trace format (.json)" << std::endl;
+	std::cout << "\t-    --render-atlas=size               : Widget frames cache size in MB (default: 64, 0 = disabled)" << std::endl;
+	std::cout << "\t-    --render-segments                 : Split video at keyframes & render segments in parallel (default: 1)" << std::endl;
 	std::cout << std::endl;
 	std::cout << "Command:" << std::endl;
 	std::cout << "\t extract: Extract GPS sensor data from media stream" << std::endl;
@@ -369,6 +396,9 @@ Map * GPX2Video::buildMap(void) {
 	// Map settings
 	MapSettings mapSettings;
 	mapSettings.setSource(settings().mapsource());
+	mapSettings.setDownloadConnections(settings().mapConnections());
+	mapSettings.setDownloadRate(settings().mapRate());
+	mapSettings.setURI(settings().mapURL());
 	mapSettings.setZoom(settings().mapzoom());
 	mapSettings.setDivider(settings().mapfactor());
 	mapSettings.setBoundingBox(p1.latitude(), p1.longitude(), p2.latitude(), p2.longitude());
@@ -541,6 +571,28 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 	int64_t video_min_bit_rate = 0;						// 0
 	int64_t video_max_bit_rate = 2 * 1000 * 1000 * 16;	// 32MB
 
+	// Audio settings
+	bool audio_copy = true;
+
+	// Render settings
+	int render_threads = 0;	// Auto
+	int render_scale_threads = 0;	// Auto
+	bool render_yuv = false;
+	bool render_overlay = false;
+	std::string render_profile;
+	std::string render_trace;
+	int render_atlas_size = 64;
+	int render_segments = 1;
+	bool render_segment = false;
+	uint64_t render_segment_from = 0;
+	uint64_t render_segment_to = 0;
+	int64_t render_segment_real = -1;
+
+	// Map download settings
+	int map_connections = 4;
+	int map_rate = 10;
+	std::string map_url;
+
 	const char *s;
 
 	MapSettings::Source map_source = MapSettings::SourceNull;
@@ -611,6 +663,15 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 			else if (s && !strcmp(s, "map-source")) {
 				map_source = (MapSettings::Source) atoi(optarg);
 			}
+			else if (s && !strcmp(s, "map-connections")) {
+				map_connections = atoi(optarg);
+			}
+			else if (s && !strcmp(s, "map-rate")) {
+				map_rate = atoi(optarg);
+			}
+			else if (s && !strcmp(s, "map-url")) {
+				map_url = optarg;
+			}
 			else if (s && !strcmp(s, "path-thick")) {
 				path_thick = strtod(optarg, NULL);
 			}
@@ -786,6 +847,12 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 					std::cout << "\t- h264_vaapi" << std::endl;
 					std::cout << std::endl;
 					std::cout << "VAAPI video codec required video-hwdevice option." << std::endl;
+					std::cout << std::endl;
+					std::cout << "Alpha video codecs list (--render-overlay):" << std::endl;
+					std::cout << "\t- prores (ProRes 4444, mov)" << std::endl;
+					std::cout << "\t- vp9 (webm)" << std::endl;
+					std::cout << "\t- qtrle (QuickTime Animation, mov)" << std::endl;
+					std::cout << "\t- png (image sequence, ie: output-%06d.png)" << std::endl;
 					return -2;
 				}
 				else if (!strcasecmp(optarg, "h264") || !strcasecmp(optarg, "x264")) {
@@ -815,6 +882,18 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 				else if (!strcasecmp(optarg, "h265_qsv") || !strcasecmp(optarg, "hevc_qsv")) {
 					video_codec = ExportCodec::CodecQSVHEVC;
 				}
+				else if (!strcasecmp(optarg, "prores") || !strcasecmp(optarg, "prores_ks")) {
+					video_codec = ExportCodec::CodecProRes;
+				}
+				else if (!strcasecmp(optarg, "vp9") || !strcasecmp(optarg, "libvpx-vp9")) {
+					video_codec = ExportCodec::CodecVP9;
+				}
+				else if (!strcasecmp(optarg, "qtrle")) {
+					video_codec = ExportCodec::CodecQTRLE;
+				}
+				else if (!strcasecmp(optarg, "png")) {
+					video_codec = ExportCodec::CodecPNG;
+				}
 				else {
 					std::cout << "Video codec not supported!" << std::endl;
 					return -1;
@@ -858,6 +937,46 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 			else if (s && !strcmp(s, "video-max-bitrate")) {
 				video_max_bit_rate = atoll(optarg);
 			}
+			else if (s && !strcmp(s, "audio-reencode")) {
+				audio_copy = false;
+			}
+			else if (s && !strcmp(s, "render-threads")) {
+				render_threads = atoi(optarg);
+			}
+			else if (s && !strcmp(s, "render-scale-threads")) {
+				render_scale_threads = atoi(optarg);
+			}
+			else if (s && !strcmp(s, "render-yuv")) {
+				render_yuv = true;
+			}
+			else if (s && !strcmp(s, "render-overlay")) {
+				render_overlay = true;
+			}
+			else if (s && !strcmp(s, "render-profile")) {
+				render_profile = std::string(optarg);
+			}
+			else if (s && !strcmp(s, "render-trace")) {
+				render_trace = std::string(optarg);
+			}
+			else if (s && !strcmp(s, "render-atlas")) {
+				render_atlas_size = atoi(optarg);
+			}
+			else if (s && !strcmp(s, "render-segments")) {
+				render_segments = atoi(optarg);
+			}
+			else if (s && !strcmp(s, "render-segment")) {
+				char *end = NULL;
+
+				// FROM:TO[:REAL] in ms, TO empty => end of video
+				render_segment = true;
+				render_segment_from = strtoull(optarg, &end, 10);
+				render_segment_to = 0;
+
+				if (end && (*end == ':'))
+					render_segment_to = strtoull(end + 1, &end, 10);
+				if (end && (*end == ':'))
+					render_segment_real = strtoll(end + 1, NULL, 10);
+			}
 			else {
 				std::cout << "option " << s;
 				if (optarg)
@@ -996,6 +1115,33 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 		return -1;
 	}
 
+	if (render_overlay && (ExportCodec::getAlphaPixelFormat(video_codec) == AV_PIX_FMT_NONE)) {
+		std::string ext = std::filesystem::path(outputfile).extension().string();
+
+		// Alpha codec from output file extension
+		if (!strcasecmp(ext.c_str(), ".webm"))
+			video_codec = ExportCodec::CodecVP9;
+		else if (!strcasecmp(ext.c_str(), ".png"))
+			video_codec = ExportCodec::CodecPNG;
+		else
+			video_codec = ExportCodec::CodecProRes;
+
+		std::cout << name << ": overlay rendering requires an alpha video codec, use "
+			<< ExportCodec::getCodecName(video_codec) << std::endl;
+	}
+
+	if (render_overlay && (video_codec == ExportCodec::CodecPNG) && (render_segments > 1)) {
+		std::cout << name << ": can't render PNG sequence in segments" << std::endl;
+		std::cout << std::endl;
+		return -1;
+	}
+
+	if (render_overlay && render_yuv) {
+		std::cout << name << ": options '--render-overlay' and '--render-yuv' are exclusive" << std::endl;
+		std::cout << std::endl;
+		return -1;
+	}
+
 	if (mediafile_required && mediafile.empty()) {
 		std::cout << name << ": option '--media' is required" << std::endl;
 		std::cout << std::endl;
@@ -1094,6 +1240,26 @@ int GPX2Video::parseCommandLine(int argc, char *argv[]) {
 		video_max_bit_rate)
 	);
 
+	settings().setAudioCopy(audio_copy);
+	settings().setRenderThreads(render_threads);
+	settings().setRenderScaleThreads(render_scale_threads);
+	settings().setRenderYUV(render_yuv);
+	settings().setRenderOverlay(render_overlay);
+	settings().setRenderProfile(render_profile);
+	settings().setRenderTrace(render_trace);
+	settings().setRenderAtlasSize(render_atlas_size);
+	settings().setRenderSegments(render_segments);
+	settings().setMapConnections(map_connections);
+	settings().setMapRate(map_rate);
+	settings().setMapURL(map_url);
+
+	// Real time at the segment start, if not given by the main process
+	if (render_segment && (render_segment_real < 0))
+		render_segment_real = time_factor_value * render_segment_from;
+
+	if (render_segment)
+		settings().setRenderSegment(render_segment_from, render_segment_to, render_segment_real);
+
 	return 0;
 }
 
@@ -1130,6 +1296,8 @@ int main(int argc, char *argv[], char *envp[]) {
 	app.setLogLevel(AV_LOG_INFO);
 
 	// Parse args
+	app.setArguments(argc, argv);
+
 	result = app.parseCommandLine(argc, argv);
 	if (result < 0) {
 		if (result == -1)
@@ -1316,6 +1484,10 @@ int main(int argc, char *argv[], char *envp[]) {
 					app.settings().isTimeFactorAuto(),
 					app.settings().timeFactor());
 
+			rendererSettings.setMapConnections(app.settings().mapConnections());
+			rendererSettings.setMapRate(app.settings().mapRate());
+			rendererSettings.setMapURL(app.settings().mapURL());
+
 			// Telemetry settings
 			telemetrySettings = TelemetrySettings(
 					app.settings().telemetryOffset(),
@@ -1399,6 +1571,23 @@ int main(int argc, char *argv[], char *envp[]) {
 					app.settings().videoMinBitrate(),
 					app.settings().videoMaxBitrate());
 
+			rendererSettings.setAudioCopy(app.settings().audioCopy());
+			rendererSettings.setRenderThreads(app.settings().renderThreads());
+			rendererSettings.setRenderScaleThreads(app.settings().renderScaleThreads());
+			rendererSettings.setRenderYUV(app.settings().renderYUV());
+			rendererSettings.setRenderOverlay(app.settings().renderOverlay());
+			rendererSettings.setRenderProfile(app.settings().renderProfile());
+			rendererSettings.setRenderTrace(app.settings().renderTrace());
+			rendererSettings.setRenderAtlasSize(app.settings().renderAtlasSize());
+			rendererSettings.setRenderSegments(app.settings().renderSegments());
+			rendererSettings.setMapConnections(app.settings().mapConnections());
+			rendererSettings.setMapRate(app.settings().mapRate());
+			rendererSettings.setMapURL(app.settings().mapURL());
+
+			if (app.settings().isRenderSegment())
+				rendererSettings.setRenderSegment(app.settings().renderSegmentFrom(), app.settings().renderSegmentTo(),
+					app.settings().renderSegmentReal());
+
 			// Telemetry settings
 			telemetrySettings = TelemetrySettings(
 					app.settings().telemetryOffset(),
@@ -1490,6 +1679,6 @@ exit:
 
 	event_base_free(evbase);
 
-	exit(EXIT_SUCCESS);
+	exit(app.exitStatus());
 }
 